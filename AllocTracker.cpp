@@ -0,0 +1,345 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    AllocTracker.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+// Counts every allocation and free made by the game. With glibc we replace  //
+// malloc and friends, which also catches SDL and SDL_ttf. With Visual C++   //
+// we can only replace operator new and delete, so C++ allocations are all   //
+// we see there. Any thread may allocate, so the counts are atomic adds, and //
+// each thread charges its allocations to the subsystem it set itself.       //
+
+#include "AllocTracker.h"
+#include "Atomic.h"       // For AtomicAdd() and THREAD_LOCAL
+
+#ifdef ALLOC_TRACKING
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>   // malloc_usable_size
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(_MSC_VER)
+#include <malloc.h>   // _msize
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+// A frame's counts, added to from any thread //
+struct FrameAllocCounts
+{
+	volatile int allocs;
+	volatile int frees;
+	volatile int bytes_allocated;
+	volatile int bytes_freed;
+};
+
+struct AllocCounts
+{
+	unsigned int       allocs;
+	unsigned int       frees;
+	unsigned long long bytes_allocated;
+	unsigned long long bytes_freed;
+};
+
+struct StateAllocStats
+{
+	const char*  name;
+	unsigned int frames;
+	unsigned int frames_with_allocs;
+	unsigned int max_frame_allocs;
+	AllocCounts  total;
+	size_t       peak_resident;   // largest resident size seen at the end of a frame
+};
+
+static const char* g_SubsystemNames[NUM_ALLOC_SUBSYSTEMS] =
+{
+	"other", "input", "simulation", "render", "text", "levels"
+};
+
+static THREAD_LOCAL int g_Subsystem = ALLOC_OTHER;
+static FrameAllocCounts g_FrameCounts[NUM_ALLOC_SUBSYSTEMS];
+static AllocCounts     g_TotalCounts[NUM_ALLOC_SUBSYSTEMS];
+static StateAllocStats g_StateStats[MAX_TRACKED_STATES];
+static int             g_NumStates = 0;
+
+static void CountAlloc(size_t bytes)
+{
+	AtomicAdd(&g_FrameCounts[g_Subsystem].allocs, 1);
+	AtomicAdd(&g_FrameCounts[g_Subsystem].bytes_allocated, (int)bytes);
+}
+
+static void CountFree(size_t bytes)
+{
+	AtomicAdd(&g_FrameCounts[g_Subsystem].frees, 1);
+	AtomicAdd(&g_FrameCounts[g_Subsystem].bytes_freed, (int)bytes);
+}
+
+// Moves a count out of the frame, keeping anything added while we read it //
+static unsigned int TakeCount(volatile int* count)
+{
+	int taken = AtomicLoad(count);
+	AtomicAdd(count, -taken);
+	return (unsigned int)taken;
+}
+
+static void AddCounts(AllocCounts* total, const AllocCounts& counts)
+{
+	total->allocs          += counts.allocs;
+	total->frees           += counts.frees;
+	total->bytes_allocated += counts.bytes_allocated;
+	total->bytes_freed     += counts.bytes_freed;
+}
+
+#if defined(__GLIBC__)
+
+// Every malloc in the process, SDL's included, comes through here. The //
+// aligned ones too, as their blocks go back through our free and would  //
+// otherwise count as frees with no alloc.                               //
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t count, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void  __libc_free(void* ptr);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void* __libc_valloc(size_t size);
+	void* __libc_pvalloc(size_t size);
+
+	void* malloc(size_t size) __THROW
+	{
+		void* ptr = __libc_malloc(size);
+		if (ptr)
+			CountAlloc(malloc_usable_size(ptr));
+		return ptr;
+	}
+
+	void* calloc(size_t count, size_t size) __THROW
+	{
+		void* ptr = __libc_calloc(count, size);
+		if (ptr)
+			CountAlloc(malloc_usable_size(ptr));
+		return ptr;
+	}
+
+	void* realloc(void* ptr, size_t size) __THROW
+	{
+		if (ptr)
+			CountFree(malloc_usable_size(ptr));
+		void* new_ptr = __libc_realloc(ptr, size);
+		if (new_ptr)
+			CountAlloc(malloc_usable_size(new_ptr));
+		return new_ptr;
+	}
+
+	void free(void* ptr) __THROW
+	{
+		if (ptr)
+			CountFree(malloc_usable_size(ptr));
+		__libc_free(ptr);
+	}
+
+	void* memalign(size_t alignment, size_t size) __THROW
+	{
+		void* ptr = __libc_memalign(alignment, size);
+		if (ptr)
+			CountAlloc(malloc_usable_size(ptr));
+		return ptr;
+	}
+
+	void* aligned_alloc(size_t alignment, size_t size) __THROW
+	{
+		return memalign(alignment, size);
+	}
+
+	// glibc has no __libc_ version of this one, so check the alignment here //
+	int posix_memalign(void** ptr, size_t alignment, size_t size) __THROW
+	{
+		if (alignment == 0 || alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+			return EINVAL;
+
+		void* new_ptr = memalign(alignment, size);
+		if (!new_ptr)
+			return ENOMEM;
+
+		*ptr = new_ptr;
+		return 0;
+	}
+
+	void* valloc(size_t size) __THROW
+	{
+		void* ptr = __libc_valloc(size);
+		if (ptr)
+			CountAlloc(malloc_usable_size(ptr));
+		return ptr;
+	}
+
+	void* pvalloc(size_t size) __THROW
+	{
+		void* ptr = __libc_pvalloc(size);
+		if (ptr)
+			CountAlloc(malloc_usable_size(ptr));
+		return ptr;
+	}
+}
+
+// Read the resident page count without going through stdio, which would allocate //
+static size_t GetResidentBytes()
+{
+	int fd = open("/proc/self/statm", O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	char buffer[128];
+	int length = read(fd, buffer, sizeof(buffer) - 1);
+	close(fd);
+	if (length <= 0)
+		return 0;
+	buffer[length] = 0;
+
+	// The second number is the resident size in pages //
+	char* resident = strchr(buffer, ' ');
+	if (!resident)
+		return 0;
+
+	return strtoul(resident + 1, NULL, 10) * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+#elif defined(_MSC_VER)
+
+void* operator new(size_t size)
+{
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	CountAlloc(_msize(ptr));
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+	if (ptr)
+	{
+		CountFree(_msize(ptr));
+		free(ptr);
+	}
+}
+
+void operator delete[](void* ptr) throw()
+{
+	operator delete(ptr);
+}
+
+static size_t GetResidentBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	if ( !GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) )
+		return 0;
+	return counters.WorkingSetSize;
+}
+
+#else
+
+// No way to see allocations or memory use here, the report will be all zeros //
+static size_t GetResidentBytes()
+{
+	return 0;
+}
+
+#endif
+
+int SetAllocSubsystem(int subsystem)
+{
+	int previous = g_Subsystem;
+	g_Subsystem = subsystem;
+	return previous;
+}
+
+int AllocFrameEnd(const char* state_name)
+{
+	// Find the stats for this state, adding them if this is its first frame //
+	StateAllocStats* stats = NULL;
+	for (int i=0; i < g_NumStates; i++)
+	{
+		if (strcmp(g_StateStats[i].name, state_name) == 0)
+			stats = &g_StateStats[i];
+	}
+	if (!stats && g_NumStates < MAX_TRACKED_STATES)
+	{
+		stats = &g_StateStats[g_NumStates++];
+		memset(stats, 0, sizeof(StateAllocStats));
+		stats->name = state_name;
+	}
+
+	int frame_allocs = 0;
+
+	for (int i=0; i < NUM_ALLOC_SUBSYSTEMS; i++)
+	{
+		AllocCounts counts;
+		counts.allocs          = TakeCount(&g_FrameCounts[i].allocs);
+		counts.frees           = TakeCount(&g_FrameCounts[i].frees);
+		counts.bytes_allocated = TakeCount(&g_FrameCounts[i].bytes_allocated);
+		counts.bytes_freed     = TakeCount(&g_FrameCounts[i].bytes_freed);
+
+		frame_allocs += counts.allocs;
+
+		AddCounts(&g_TotalCounts[i], counts);
+		if (stats)
+			AddCounts(&stats->total, counts);
+	}
+
+	if (stats)
+	{
+		stats->frames++;
+		if (frame_allocs > 0)
+			stats->frames_with_allocs++;
+		if ((unsigned int)frame_allocs > stats->max_frame_allocs)
+			stats->max_frame_allocs = frame_allocs;
+
+		size_t resident = GetResidentBytes();
+		if (resident > stats->peak_resident)
+			stats->peak_resident = resident;
+	}
+
+	return frame_allocs;
+}
+
+void PrintAllocReport()
+{
+	printf("allocations by game state:\n");
+	for (int i=0; i < g_NumStates; i++)
+	{
+		const StateAllocStats& stats = g_StateStats[i];
+		double frames = stats.frames > 0 ? stats.frames : 1;
+
+		printf("  %-10s %6u frames, %6u with allocations, %.2f allocs/frame (max %u), "
+		       "%.0f bytes/frame, %u frees, peak resident %u KB\n",
+		       stats.name, stats.frames, stats.frames_with_allocs,
+		       stats.total.allocs / frames, stats.max_frame_allocs,
+		       stats.total.bytes_allocated / frames, stats.total.frees,
+		       (unsigned int)(stats.peak_resident / 1024));
+	}
+
+	printf("allocations by subsystem:\n");
+	for (int i=0; i < NUM_ALLOC_SUBSYSTEMS; i++)
+	{
+		const AllocCounts& counts = g_TotalCounts[i];
+
+		printf("  %-10s %8u allocs %10llu bytes, %8u frees %10llu bytes\n",
+		       g_SubsystemNames[i], counts.allocs, counts.bytes_allocated,
+		       counts.frees, counts.bytes_freed);
+	}
+}
+
+#endif
@@ -0,0 +1,30 @@
+//////////////////////////////////////////////////////////////////////////////////
+// AllocTracker.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Defines.h" // For ALLOC_TRACKING
+#include "Enums.h"   // For AllocSubsystem
+
+#ifdef ALLOC_TRACKING
+
+// Charges allocations made from now on to the given AllocSubsystem. //
+// Returns the subsystem that was being charged before.              //
+int  SetAllocSubsystem(int subsystem);
+
+// Adds the allocations since the last call to the totals of the named //
+// game state. Returns how many allocations were made in that frame.   //
+int  AllocFrameEnd(const char* state_name);
+
+// Prints allocation counts and peak resident memory for each game state //
+void PrintAllocReport();
+
+#else
+
+// Without ALLOC_TRACKING these do nothing and cost nothing //
+inline int  SetAllocSubsystem(int)         { return ALLOC_OTHER; }
+inline int  AllocFrameEnd(const char*)     { return 0; }
+inline void PrintAllocReport()             {}
+
+#endif
@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Atomic.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// SDL 1.2 has no atomic operations, so these wrap the compiler's own. Loads   //
+// acquire and stores release: anything written before an AtomicStore() is   //
+// visible to a thread that sees the stored value through AtomicLoad().       //
+
+#ifdef _MSC_VER
+
+#include <intrin.h>
+
+// A global each thread has its own copy of //
+#define THREAD_LOCAL __declspec(thread)
+
+inline int AtomicLoad(volatile int* value)
+{
+	int result = *value;
+	_ReadWriteBarrier();
+	return result;
+}
+
+inline void AtomicStore(volatile int* value, int new_value)
+{
+	_InterlockedExchange((volatile long*)value, new_value);
+}
+
+// Returns the value after the add //
+inline int AtomicAdd(volatile int* value, int amount)
+{
+	return _InterlockedExchangeAdd((volatile long*)value, amount) + amount;
+}
+
+#else
+
+#define THREAD_LOCAL __thread
+
+inline int AtomicLoad(volatile int* value)
+{
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+inline void AtomicStore(volatile int* value, int new_value)
+{
+	__atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+// Returns the value after the add //
+inline int AtomicAdd(volatile int* value, int amount)
+{
+	return __atomic_add_fetch(value, amount, __ATOMIC_ACQ_REL);
+}
+
+#endif
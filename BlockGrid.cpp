@@ -0,0 +1,131 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    BlockGrid.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "BlockGrid.h"
+
+static inline int GetGridColumn(int x)
+{
+	if (x < 0)
+		return 0;
+	int column = x / BLOCK_WIDTH;
+	return column < GRID_COLUMNS ? column : GRID_COLUMNS - 1;
+}
+
+static inline int GetGridRow(int y)
+{
+	if (y < 0)
+		return 0;
+	int row = y / BLOCK_HEIGHT;
+	return row < GRID_ROWS ? row : GRID_ROWS - 1;
+}
+
+static inline int GetGridCell(const SDL_Rect& location)
+{
+	return GetGridRow(location.y) * GRID_COLUMNS + GetGridColumn(location.x);
+}
+
+void ClearBlockGrid(BlockGrid* grid)
+{
+	for (int i=0; i < GRID_CELLS; i++)
+		grid->heads[i] = -1;
+
+	for (int i=0; i < MAX_BLOCKS; i++)
+	{
+		grid->next[i]  = -1;
+		grid->prev[i]  = -1;
+		grid->cells[i] = -1;
+	}
+
+	grid->refiles = 0;
+}
+
+static void LinkBlock(BlockGrid* grid, int block, int cell)
+{
+	int head = grid->heads[cell];
+
+	grid->next[block]  = (Sint16)head;
+	grid->prev[block]  = -1;
+	grid->cells[block] = (Sint16)cell;
+	if (head >= 0)
+		grid->prev[head] = (Sint16)block;
+	grid->heads[cell] = (Sint16)block;
+}
+
+static void UnlinkBlock(BlockGrid* grid, int block)
+{
+	int next = grid->next[block];
+	int prev = grid->prev[block];
+
+	if (prev >= 0)
+		grid->next[prev] = (Sint16)next;
+	else
+		grid->heads[grid->cells[block]] = (Sint16)next;
+	if (next >= 0)
+		grid->prev[next] = (Sint16)prev;
+
+	grid->next[block]  = -1;
+	grid->prev[block]  = -1;
+	grid->cells[block] = -1;
+}
+
+void InsertGridBlock(BlockGrid* grid, int block, const SDL_Rect& location)
+{
+	if (grid->cells[block] >= 0)
+		UnlinkBlock(grid, block);
+
+	LinkBlock(grid, block, GetGridCell(location));
+}
+
+void RemoveGridBlock(BlockGrid* grid, int block)
+{
+	if (grid->cells[block] >= 0)
+		UnlinkBlock(grid, block);
+}
+
+void MoveGridBlock(BlockGrid* grid, int block, const SDL_Rect& location)
+{
+	int cell = GetGridCell(location);
+	if (grid->cells[block] < 0 || grid->cells[block] == cell)
+		return;
+
+	UnlinkBlock(grid, block);
+	LinkBlock(grid, block, cell);
+	grid->refiles++;
+}
+
+int QueryBlockGrid(const BlockGrid* grid, const SDL_Rect& area, int* found, int max_found)
+{
+	// A block filed one cell up or left of the area can still reach into it //
+	int left   = GetGridColumn(area.x) - 1;
+	int top    = GetGridRow(area.y) - 1;
+	int right  = GetGridColumn(area.x + area.w);
+	int bottom = GetGridRow(area.y + area.h);
+	if (left < 0)
+		left = 0;
+	if (top < 0)
+		top = 0;
+
+	int num_found = 0;
+
+	for (int row = top; row <= bottom; row++)
+	{
+		for (int column = left; column <= right; column++)
+		{
+			for (int block = grid->heads[row * GRID_COLUMNS + column]; block >= 0; block = grid->next[block])
+			{
+				if (num_found == max_found)
+					break;
+
+				// Keep them sorted as they go in, there are only ever a few //
+				int i = num_found++;
+				for (; i > 0 && found[i - 1] > block; i--)
+					found[i] = found[i - 1];
+				found[i] = block;
+			}
+		}
+	}
+
+	return num_found;
+}
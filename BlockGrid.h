@@ -0,0 +1,38 @@
+//////////////////////////////////////////////////////////////////////////////////
+// BlockGrid.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Rect
+#include "Defines.h" // Our defines header
+
+// Files the blocks by where they are, so the ball only has to look at the //
+// ones near it. The cells are a block in size, and each block is filed    //
+// under the cell its top left corner is in (clamped to the screen), so a  //
+// block can only reach into that cell and the ones right and below it.    //
+// Each cell is a doubly linked list of block indices, which makes moving a //
+// block to another cell constant time, and moving it within one free.     //
+// Like the rest of GameState there are no pointers, so copies work.        //
+struct BlockGrid
+{
+	Sint16 heads[GRID_CELLS];   // first block in each cell, -1 for none
+	Sint16 next[MAX_BLOCKS];    // -1 at the end of a cell
+	Sint16 prev[MAX_BLOCKS];    // -1 at the start
+	Sint16 cells[MAX_BLOCKS];   // cell each block is filed under, -1 if it isn't
+	Uint32 refiles;             // blocks that moved to another cell, for -moverbench
+};
+
+// Empties every cell //
+void ClearBlockGrid(BlockGrid* grid);
+
+// Files a block that isn't in the grid, takes one out, or refiles one that //
+// moved. Moving only touches the lists when the block changes cells.        //
+void InsertGridBlock(BlockGrid* grid, int block, const SDL_Rect& location);
+void RemoveGridBlock(BlockGrid* grid, int block);
+void MoveGridBlock(BlockGrid* grid, int block, const SDL_Rect& location);
+
+// Finds every block that could touch area, edges included, and puts up to //
+// max_found of them in found in increasing order. Blocks no bigger than a  //
+// cell are all found; the caller still has to check which really touch.    //
+int  QueryBlockGrid(const BlockGrid* grid, const SDL_Rect& area, int* found, int max_found);
@@ -0,0 +1,275 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Collision.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "Collision.h"
+#include "Viewport.h"   // For GetSpriteLocation()
+#include "Simulation.h" // For CheckPointInRect()
+#include "LevelGen.h"   // For NextRandom()
+#include "Timing.h"     // For GetMicroseconds()
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static inline int LowestBit(Uint32 bits)  { unsigned long index; _BitScanForward(&index, bits); return (int)index; }
+static inline int HighestBit(Uint32 bits) { unsigned long index; _BitScanReverse(&index, bits); return (int)index; }
+#else
+static inline int LowestBit(Uint32 bits)  { return __builtin_ctz(bits); }
+static inline int HighestBit(Uint32 bits) { return 31 - __builtin_clz(bits); }
+#endif
+
+static CollisionMasks g_CollisionMasks;
+static bool           g_MasksLoaded = false;
+static bool           g_MasksFromBitmap = false;
+
+static Uint32 GetPixel(SDL_Surface* surface, int x, int y)
+{
+	const Uint8* pixel = (const Uint8*)surface->pixels + y * surface->pitch +
+	                     x * surface->format->BytesPerPixel;
+
+	switch (surface->format->BytesPerPixel)
+	{
+	case 4:  return *(const Uint32*)pixel;
+	case 2:  return *(const Uint16*)pixel;
+	case 1:  return *pixel;
+	}
+
+	Uint32 color = 0;
+	memcpy(&color, pixel, 3);  // little endian
+	return color;
+}
+
+void BuildCollisionMask(CollisionMask* mask, SDL_Surface* bitmap, const SDL_Rect& location)
+{
+	memset(mask, 0, sizeof(CollisionMask));
+	mask->width  = location.w > MASK_MAX_WIDTH  ? MASK_MAX_WIDTH  : location.w;
+	mask->height = location.h > MASK_MAX_HEIGHT ? MASK_MAX_HEIGHT : location.h;
+
+	Uint32 key = (bitmap->flags & SDL_SRCCOLORKEY) ? bitmap->format->colorkey :
+	             SDL_MapRGB(bitmap->format, 255, 0, 255);
+
+	SDL_LockSurface(bitmap);
+
+	for (int y=0; y < mask->height; y++)
+	{
+		for (int x=0; x < mask->width; x++)
+		{
+			if ( GetPixel(bitmap, location.x + x, location.y + y) != key )
+				mask->rows[y][x >> 5] |= 1u << (x & 31);
+		}
+	}
+
+	SDL_UnlockSurface(bitmap);
+}
+
+// For when there's no bitmap to go by //
+static void BuildDefaultMask(CollisionMask* mask, int sprite)
+{
+	SDL_Rect location = GetSpriteLocation(sprite);
+
+	memset(mask, 0, sizeof(CollisionMask));
+	mask->width  = location.w;
+	mask->height = location.h;
+
+	for (int y=0; y < mask->height; y++)
+	{
+		for (int x=0; x < mask->width; x++)
+		{
+			// Pixel centers inside the circle, measured in half pixels //
+			int dx = 2*x + 1 - mask->width;
+			int dy = 2*y + 1 - mask->height;
+			if ( sprite != SPRITE_BALL || dx*dx + dy*dy <= mask->width * mask->width )
+				mask->rows[y][x >> 5] |= 1u << (x & 31);
+		}
+	}
+}
+
+void BuildCollisionMasks(CollisionMasks* masks, SDL_Surface* bitmap)
+{
+	for (int i=0; i < NUM_SPRITES; i++)
+	{
+		if (bitmap)
+			BuildCollisionMask(&masks->sprites[i], bitmap, GetSpriteLocation(i));
+		else
+			BuildDefaultMask(&masks->sprites[i], i);
+	}
+}
+
+const CollisionMasks* LoadCollisionMasks()
+{
+	if (!g_MasksLoaded)
+	{
+		SDL_Surface* bitmap = SDL_LoadBMP("data/BlockBreaker.bmp");
+		BuildCollisionMasks(&g_CollisionMasks, bitmap);
+		if (bitmap)
+			SDL_FreeSurface(bitmap);
+
+		g_MasksFromBitmap = bitmap != NULL;
+
+		g_MasksLoaded = true;
+	}
+
+	return &g_CollisionMasks;
+}
+
+void InitCollisionMasks(SDL_Surface* bitmap)
+{
+	BuildCollisionMasks(&g_CollisionMasks, bitmap);
+
+	g_MasksFromBitmap = bitmap != NULL;
+	g_MasksLoaded     = true;
+}
+
+// The 32 bits of a row starting at bit start. Rows are zero past the //
+// sprite's width, so this can read past the end of the part we want. //
+static inline Uint32 GetMaskBits(const Uint32* row, int start)
+{
+	int    word  = start >> 5;
+	int    shift = start & 31;
+	Uint32 bits  = row[word] >> shift;
+
+	if (shift != 0 && word + 1 < MASK_WORDS)
+		bits |= row[word + 1] << (32 - shift);
+
+	return bits;
+}
+
+bool CheckMasksOverlap(const CollisionMask& a, int a_x, int a_y,
+                       const CollisionMask& b, int b_x, int b_y, SDL_Rect* contact)
+{
+	// The box the two rects share, if any //
+	int left   = a_x > b_x ? a_x : b_x;
+	int top    = a_y > b_y ? a_y : b_y;
+	int right  = a_x + a.width  < b_x + b.width  ? a_x + a.width  : b_x + b.width;
+	int bottom = a_y + a.height < b_y + b.height ? a_y + a.height : b_y + b.height;
+
+	if (left >= right || top >= bottom)
+		return false;
+
+	int contact_left = right, contact_right = left;
+	int contact_top  = bottom, contact_bottom = top;
+
+	for (int y=top; y < bottom; y++)
+	{
+		const Uint32* row_a = a.rows[y - a_y];
+		const Uint32* row_b = b.rows[y - b_y];
+
+		for (int x=left; x < right; x += 32)
+		{
+			Uint32 bits = GetMaskBits(row_a, x - a_x) & GetMaskBits(row_b, x - b_x);
+			if (right - x < 32)
+				bits &= (1u << (right - x)) - 1;
+
+			if (bits == 0)
+				continue;
+			if (!contact)
+				return true;
+
+			if (x + LowestBit(bits) < contact_left)
+				contact_left = x + LowestBit(bits);
+			if (x + HighestBit(bits) + 1 > contact_right)
+				contact_right = x + HighestBit(bits) + 1;
+			if (y < contact_top)
+				contact_top = y;
+			contact_bottom = y + 1;
+		}
+	}
+
+	if (contact_left >= contact_right)
+		return false;
+
+	contact->x = (Sint16)contact_left;
+	contact->y = (Sint16)contact_top;
+	contact->w = (Uint16)(contact_right - contact_left);
+	contact->h = (Uint16)(contact_bottom - contact_top);
+	return true;
+}
+
+// What CheckBlockCollisions() used to do: test the middle of each side of //
+// the ball's box, edges included //
+static bool CheckProbes(int ball_x, int ball_y, const SDL_Rect& rect)
+{
+	int x[4] = { ball_x + BALL_DIAMETER/2, ball_x + BALL_DIAMETER/2, ball_x, ball_x + BALL_DIAMETER };
+	int y[4] = { ball_y, ball_y + BALL_DIAMETER, ball_y + BALL_DIAMETER/2, ball_y + BALL_DIAMETER/2 };
+
+	bool hit = false;
+	for (int i=0; i < 4; i++)
+	{
+		if ( CheckPointInRect(x[i], y[i], rect) )
+			hit = true;
+	}
+
+	return hit;
+}
+
+static Sint16 g_BenchX[COLLISIONBENCH_TESTS];
+static Sint16 g_BenchY[COLLISIONBENCH_TESTS];
+
+int RunCollisionBench()
+{
+	const CollisionMasks* masks = LoadCollisionMasks();
+	const CollisionMask&  ball  = masks->sprites[SPRITE_BALL];
+
+	const int targets[2] = { SPRITE_RED, SPRITE_PADDLE };
+	Uint32    seed       = 0x2545F491;
+
+	printf("%d ball positions touching each sprite's box, masks %s\n", COLLISIONBENCH_TESTS,
+	       g_MasksFromBitmap ? "from the bitmap" : "made up (no bitmap)");
+	printf("%-10s %10s %10s %10s %10s %10s %10s %10s\n", "target", "probes ns", "masks ns", "contact ns",
+	       "probe hits", "pixel hits", "phantom", "missed");
+
+	for (int t=0; t < 2; t++)
+	{
+		const CollisionMask& target = masks->sprites[targets[t]];
+		SDL_Rect rect = { 100, 100, (Uint16)target.width, (Uint16)target.height };
+
+		// Anywhere the ball's box touches the target's, edges included //
+		for (int i=0; i < COLLISIONBENCH_TESTS; i++)
+		{
+			g_BenchX[i] = (Sint16)(rect.x - BALL_DIAMETER + (int)(NextRandom(&seed) % (rect.w + BALL_DIAMETER + 1)));
+			g_BenchY[i] = (Sint16)(rect.y - BALL_DIAMETER + (int)(NextRandom(&seed) % (rect.h + BALL_DIAMETER + 1)));
+		}
+
+		int probe_hits = 0;
+		Uint64 start = GetMicroseconds();
+		for (int i=0; i < COLLISIONBENCH_TESTS; i++)
+			probe_hits += CheckProbes(g_BenchX[i], g_BenchY[i], rect);
+		Uint64 probe_time = GetMicroseconds() - start;
+
+		int mask_hits = 0;
+		start = GetMicroseconds();
+		for (int i=0; i < COLLISIONBENCH_TESTS; i++)
+			mask_hits += CheckMasksOverlap(ball, g_BenchX[i], g_BenchY[i], target, rect.x, rect.y, NULL);
+		Uint64 mask_time = GetMicroseconds() - start;
+
+		// Blocks also need to know where they were hit, to bounce the ball //
+		int contact_hits = 0;
+		SDL_Rect contact;
+		start = GetMicroseconds();
+		for (int i=0; i < COLLISIONBENCH_TESTS; i++)
+			contact_hits += CheckMasksOverlap(ball, g_BenchX[i], g_BenchY[i], target, rect.x, rect.y, &contact);
+		Uint64 contact_time = GetMicroseconds() - start;
+
+		int phantom = 0, missed = 0;
+		for (int i=0; i < COLLISIONBENCH_TESTS; i++)
+		{
+			bool probe = CheckProbes(g_BenchX[i], g_BenchY[i], rect);
+			bool pixel = CheckMasksOverlap(ball, g_BenchX[i], g_BenchY[i], target, rect.x, rect.y, NULL);
+			if (probe && !pixel)
+				phantom++;
+			if (pixel && !probe)
+				missed++;
+		}
+
+		if (mask_hits != contact_hits)
+			printf("Masks and contacts disagree: %d vs %d hits\n", mask_hits, contact_hits);
+
+		printf("%-10s %10.2f %10.2f %10.2f %10d %10d %10d %10d\n", t == 0 ? "block" : "paddle",
+		       probe_time * 1000.0 / COLLISIONBENCH_TESTS, mask_time * 1000.0 / COLLISIONBENCH_TESTS,
+		       contact_time * 1000.0 / COLLISIONBENCH_TESTS, probe_hits, mask_hits, phantom, missed);
+	}
+
+	return 0;
+}
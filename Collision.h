@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Collision.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Surface and SDL_Rect
+#include "Defines.h" // Our defines header
+#include "Enums.h"   // For Sprite
+
+// The solid pixels of a sprite, one bit each. Bit x of a row is pixel x, //
+// 32 to a word, and the bits past the sprite's width are always clear.  //
+struct CollisionMask
+{
+	int    width;
+	int    height;
+	Uint32 rows[MASK_MAX_HEIGHT][MASK_WORDS];
+};
+
+// The shape of every sprite, indexed by Sprite //
+struct CollisionMasks
+{
+	CollisionMask sprites[NUM_SPRITES];
+};
+
+// Marks the pixels in location that aren't the bitmap's transparent color. //
+// Bitmaps without a color key are taken to use magenta, like ours.         //
+void BuildCollisionMask(CollisionMask* mask, SDL_Surface* bitmap, const SDL_Rect& location);
+
+// Cuts every sprite's mask out of the bitmap. Without one, the sprites are //
+// taken to fill their rects, except the ball, which is a plain disc.       //
+void BuildCollisionMasks(CollisionMasks* masks, SDL_Surface* bitmap);
+
+// Builds the game's masks from "data/BlockBreaker.bmp" the first time it's  //
+// called. That isn't thread safe, so call it before starting any threads. //
+const CollisionMasks* LoadCollisionMasks();
+
+// Builds the game's masks from the bitmap already loaded at startup, so //
+// LoadCollisionMasks() doesn't have to read it again. Not thread safe.  //
+void InitCollisionMasks(SDL_Surface* bitmap);
+
+// Checks whether two masks at the given screen positions share a solid pixel. //
+// The rects are tested first, so most misses never look at the bits. If       //
+// contact isn't NULL it's set to the box around every shared pixel.           //
+bool CheckMasksOverlap(const CollisionMask& a, int a_x, int a_y,
+                       const CollisionMask& b, int b_x, int b_y, SDL_Rect* contact);
+
+// Times the masks against the four probe points the ball used to use, and //
+// counts how often the probes get it wrong //
+int RunCollisionBench();
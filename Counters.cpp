@@ -0,0 +1,412 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Counters.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include "Counters.h"
+#include "Atomic.h"     // For AtomicAdd()
+#include "Timing.h"     // For GetMicroseconds()
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/un.h>
+#include <unistd.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // a collector hanging up early shouldn't kill the game
+#endif
+#endif
+
+struct CounterInfo
+{
+	const char* name;
+	int         type;   // CounterType
+	const char* help;
+};
+
+static const CounterInfo g_CounterInfo[NUM_COUNTERS] =
+{
+	{ "ticks",              COUNTER_TOTAL,     "game ticks played, fast forwarded ones included, rollback replays not" },
+	{ "mover_steps",        COUNTER_TOTAL,     "blocks moved by level scripts" },
+	{ "fastforward_ticks",  COUNTER_TOTAL,     "ticks run ahead without being drawn" },
+	{ "dropped_ticks",      COUNTER_TOTAL,     "ticks given up on when too far behind" },
+	{ "blocks_left",        COUNTER_GAUGE,     "blocks left in the game being played" },
+	{ "governor_level",     COUNTER_GAUGE,     "0 draws everything, 1 leaves out the text, 2 every other frame too" },
+	{ "tick_us",            COUNTER_HISTOGRAM, "microseconds of input, simulation and drawing in each tick" },
+	{ "collision_checks",   COUNTER_HISTOGRAM, "blocks the ball was tested against in each tick" },
+	{ "blits",              COUNTER_HISTOGRAM, "draw commands in each frame" },
+	{ "text_renders",       COUNTER_HISTOGRAM, "text SDL_ttf had to render for each frame" },
+};
+
+THREAD_LOCAL CounterShard* g_ThreadCounters = NULL;
+
+static CounterShard    g_CounterShards[MAX_COUNTER_SHARDS];
+static volatile int    g_NumCounterShards = 0;
+static volatile Uint64 g_CounterGauges[NUM_COUNTERS];
+
+CounterShard* JoinCounters()
+{
+	int index = AtomicAdd(&g_NumCounterShards, 1) - 1;
+	if (index >= MAX_COUNTER_SHARDS - 1)
+	{
+		index = MAX_COUNTER_SHARDS - 1;
+		g_CounterShards[index].shared = true;
+	}
+
+	g_ThreadCounters = &g_CounterShards[index];
+	return g_ThreadCounters;
+}
+
+void SetCounter(int counter, Uint64 value)
+{
+	CounterStore(&g_CounterGauges[counter], value);
+}
+
+Uint64 ReadCounter(int counter)
+{
+	if (g_CounterInfo[counter].type == COUNTER_GAUGE)
+		return CounterLoad(&g_CounterGauges[counter]);
+
+	Uint64 total = 0;
+	for (int i=0; i < MAX_COUNTER_SHARDS; i++)
+		total += CounterLoad(&g_CounterShards[i].values[counter]);
+
+	return total;
+}
+
+// Adds to the end of buffer, as much as fits //
+static void AppendText(char* buffer, int size, int* length, const char* format, ...)
+{
+	if (*length >= size - 1)
+		return;
+
+	va_list args;
+	va_start(args, format);
+	int written = vsnprintf(buffer + *length, size - *length, format, args);
+	va_end(args);
+
+	if (written > 0)
+		*length += written;
+	if (*length > size - 1)
+		*length = size - 1;
+}
+
+// Writes every counter in the line based text format collectors scrape: a //
+// TYPE and HELP comment for each, then "name value" lines, histograms as   //
+// cumulative buckets with a sum and count. Totals also get a rate since   //
+// the last snapshot. Returns the length, which is less than size.         //
+static int WriteCounterSnapshot(CounterServer* server, char* buffer, int size)
+{
+	Uint64 now     = GetMicroseconds();
+	double seconds = (now - server->last_time) / 1000000.0;
+	int    length  = 0;
+
+	AppendText(buffer, size, &length, "# blockbreaker counters, up %.3f s, snapshot %d\n",
+	           (now - server->start) / 1000000.0, server->scrapes + 1);
+
+	for (int c=0; c < NUM_COUNTERS; c++)
+	{
+		const CounterInfo& info = g_CounterInfo[c];
+
+		static const char* type_names[3] = { "counter", "gauge", "histogram" };
+		AppendText(buffer, size, &length, "# TYPE %s %s\n# HELP %s %s\n", info.name, type_names[info.type],
+		           info.name, info.help);
+
+		Uint64 value = ReadCounter(c);
+		if (info.type == COUNTER_TOTAL)
+		{
+			AppendText(buffer, size, &length, "%s %llu\n", info.name, (unsigned long long)value);
+			AppendText(buffer, size, &length, "%s_per_second %.1f\n", info.name,
+			           seconds > 0 ? (value - server->last_values[c]) / seconds : 0.0);
+			server->last_values[c] = value;
+		}
+		else if (info.type == COUNTER_GAUGE)
+		{
+			AppendText(buffer, size, &length, "%s %llu\n", info.name, (unsigned long long)value);
+		}
+		else
+		{
+			Uint64 count = 0;
+			for (int b=0; b < COUNTER_BUCKETS; b++)
+			{
+				for (int i=0; i < MAX_COUNTER_SHARDS; i++)
+					count += CounterLoad(&g_CounterShards[i].buckets[c][b]);
+
+				if (b < COUNTER_BUCKETS - 1)
+					AppendText(buffer, size, &length, "%s_bucket{le=\"%u\"} %llu\n", info.name, (1u << b) - 1,
+					           (unsigned long long)count);
+				else
+					AppendText(buffer, size, &length, "%s_bucket{le=\"+Inf\"} %llu\n", info.name, (unsigned long long)count);
+			}
+			AppendText(buffer, size, &length, "%s_sum %llu\n%s_count %llu\n", info.name,
+			           (unsigned long long)value, info.name, (unsigned long long)count);
+		}
+	}
+
+	AppendText(buffer, size, &length, "# EOF\n");
+
+	server->last_time = now;
+	return length;
+}
+
+#ifdef _WIN32
+
+bool StartCounterServer(CounterServer* server, const char*)
+{
+	memset(server, 0, sizeof(CounterServer));
+	server->handle = -1;
+	printf("counters: Unix domain sockets aren't supported here\n");
+	return false;
+}
+
+void StopCounterServer(CounterServer*)
+{
+}
+
+static int ReadCounterSocket(const char*, char*, int)
+{
+	return 0;
+}
+
+#else
+
+static int CounterServerThread(void* data)
+{
+	CounterServer* server = (CounterServer*)data;
+
+	while ( !AtomicLoad(&server->stop) )
+	{
+		// Wait a little for a collector, then check whether we're done //
+		fd_set waiting;
+		FD_ZERO(&waiting);
+		FD_SET(server->handle, &waiting);
+		timeval timeout = { 0, COUNTER_POLL_MS * 1000 };
+
+		if (select(server->handle + 1, &waiting, NULL, NULL, &timeout) <= 0)
+			continue;
+
+		int client = accept(server->handle, NULL, NULL);
+		if (client < 0)
+			continue;
+
+		int length = WriteCounterSnapshot(server, server->buffer, COUNTER_SNAPSHOT_SIZE);
+		for (int sent=0; sent < length; )
+		{
+			int written = (int)send(client, server->buffer + sent, length - sent, MSG_NOSIGNAL);
+			if (written <= 0)
+				break;
+			sent += written;
+		}
+
+		close(client);
+		server->scrapes++;
+	}
+
+	return 0;
+}
+
+bool StartCounterServer(CounterServer* server, const char* path)
+{
+	memset(server, 0, sizeof(CounterServer));
+	server->handle = -1;
+
+	if (strlen(path) >= COUNTER_MAX_PATH)
+	{
+		printf("counters: %s is too long for a socket path\n", path);
+		return false;
+	}
+	strcpy(server->path, path);
+
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	// A socket left behind by a game that didn't shut down would stop us binding //
+	unlink(path);
+
+	server->handle = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ( server->handle < 0 || bind(server->handle, (sockaddr*)&address, sizeof(address)) != 0 ||
+	     listen(server->handle, 4) != 0 )
+	{
+		printf("counters: couldn't listen on %s\n", path);
+		StopCounterServer(server);
+		return false;
+	}
+
+	// The first rates count from now, not from when the game started //
+	server->start     = GetMicroseconds();
+	server->last_time = server->start;
+	for (int c=0; c < NUM_COUNTERS; c++)
+		server->last_values[c] = ReadCounter(c);
+
+	server->thread = SDL_CreateThread(CounterServerThread, server);
+	if (!server->thread)
+	{
+		StopCounterServer(server);
+		return false;
+	}
+
+	return true;
+}
+
+void StopCounterServer(CounterServer* server)
+{
+	AtomicStore(&server->stop, 1);
+	if (server->thread)
+		SDL_WaitThread(server->thread, NULL);
+	server->thread = NULL;
+
+	if (server->handle >= 0)
+	{
+		close(server->handle);
+		unlink(server->path);
+	}
+	server->handle = -1;
+}
+
+// Connects to a counter server the way a collector would and reads a //
+// snapshot. Returns its length, or 0 if there was no answer.         //
+static int ReadCounterSocket(const char* path, char* buffer, int size)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	int handle = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (handle < 0)
+		return 0;
+
+	int length = 0;
+	if (connect(handle, (sockaddr*)&address, sizeof(address)) == 0)
+	{
+		int got;
+		while ( length < size - 1 && (got = (int)recv(handle, buffer + length, size - 1 - length, 0)) > 0 )
+			length += got;
+	}
+	buffer[length] = '\0';
+
+	close(handle);
+	return length;
+}
+
+#endif
+
+// Each bench thread adds this many, some into the shared shard //
+#define BENCH_THREAD_UPDATES 1000000
+#define BENCH_THREADS        (MAX_COUNTER_SHARDS + 4)
+
+static volatile int g_BenchShared = 0;
+
+static int CounterBenchThread(void*)
+{
+	for (int i=0; i < BENCH_THREAD_UPDATES; i++)
+		AddCounter(COUNTER_MOVER_STEPS, 1);
+	return 0;
+}
+
+static int AtomicBenchThread(void*)
+{
+	for (int i=0; i < BENCH_THREAD_UPDATES; i++)
+		AtomicAdd(&g_BenchShared, 1);
+	return 0;
+}
+
+// Runs BENCH_THREADS threads through function and returns the ns per update //
+static double TimeBenchThreads(int (*function)(void*))
+{
+	SDL_Thread* threads[BENCH_THREADS];
+
+	Uint64 start = GetMicroseconds();
+	for (int i=0; i < BENCH_THREADS; i++)
+		threads[i] = SDL_CreateThread(function, NULL);
+	for (int i=0; i < BENCH_THREADS; i++)
+	{
+		if (threads[i])
+			SDL_WaitThread(threads[i], NULL);
+		else
+			function(NULL);
+	}
+
+	return (GetMicroseconds() - start) * 1000.0 / ((double)BENCH_THREADS * BENCH_THREAD_UPDATES);
+}
+
+int RunCounterBench()
+{
+	SDL_Init(SDL_INIT_TIMER);
+
+	// One thread: our counters against an atomic add and a mutex //
+	Uint64 start = GetMicroseconds();
+	for (int i=0; i < COUNTERBENCH_UPDATES; i++)
+		AddCounter(COUNTER_TICKS, 1);
+	double counter_ns = (GetMicroseconds() - start) * 1000.0 / COUNTERBENCH_UPDATES;
+
+	start = GetMicroseconds();
+	for (int i=0; i < COUNTERBENCH_UPDATES; i++)
+		AddCounterSample(COUNTER_TICK_TIME, (Uint32)i & 0xFFFF);
+	double sample_ns = (GetMicroseconds() - start) * 1000.0 / COUNTERBENCH_UPDATES;
+
+	start = GetMicroseconds();
+	for (int i=0; i < COUNTERBENCH_UPDATES; i++)
+		AtomicAdd(&g_BenchShared, 1);
+	double atomic_ns = (GetMicroseconds() - start) * 1000.0 / COUNTERBENCH_UPDATES;
+
+	SDL_mutex* lock = SDL_CreateMutex();
+	start = GetMicroseconds();
+	for (int i=0; i < COUNTERBENCH_UPDATES / 10; i++)
+	{
+		SDL_mutexP(lock);
+		g_BenchShared++;
+		SDL_mutexV(lock);
+	}
+	double mutex_ns = (GetMicroseconds() - start) * 10000.0 / COUNTERBENCH_UPDATES;
+	SDL_DestroyMutex(lock);
+
+	printf("one thread, ns per update: counter %.2f, histogram %.2f, atomic add %.2f, mutex %.2f\n",
+	       counter_ns, sample_ns, atomic_ns, mutex_ns);
+
+	// Many threads at once, more than there are shards, so some share one //
+	double threads_ns = TimeBenchThreads(CounterBenchThread);
+	g_BenchShared = 0;
+	double shared_ns  = TimeBenchThreads(AtomicBenchThread);
+
+	Uint64 expected = (Uint64)BENCH_THREADS * BENCH_THREAD_UPDATES;
+	Uint64 counted  = ReadCounter(COUNTER_MOVER_STEPS);
+	bool   exact    = (counted == expected) && ReadCounter(COUNTER_TICKS) == COUNTERBENCH_UPDATES;
+
+	printf("%d threads, ns per update: counters %.2f, one atomic add %.2f; %llu of %llu updates counted\n",
+	       BENCH_THREADS, threads_ns, shared_ns, (unsigned long long)counted, (unsigned long long)expected);
+
+	// Read a snapshot back the way a collector would //
+	static CounterServer server;
+	static char snapshot[COUNTER_SNAPSHOT_SIZE];
+
+	bool served = false;
+	if ( StartCounterServer(&server, COUNTERBENCH_SOCKET) )
+	{
+		Uint64 read_start = GetMicroseconds();
+		int    length     = ReadCounterSocket(COUNTERBENCH_SOCKET, snapshot, COUNTER_SNAPSHOT_SIZE);
+		Uint64 read_time  = GetMicroseconds() - read_start;
+		StopCounterServer(&server);
+
+		char expected_line[64];
+		sprintf(expected_line, "\nmover_steps %llu\n", (unsigned long long)expected);
+		served = length > 0 && strstr(snapshot, expected_line) && strstr(snapshot, "\n# EOF\n");
+
+		printf("%s", snapshot);
+		printf("snapshot of %d bytes read in %llu us\n", length, (unsigned long long)read_time);
+	}
+
+	bool passed = exact && served && counter_ns <= COUNTER_BUDGET_NS;
+	printf("%s: %.2f ns per update against a budget of %d ns, counts %s, snapshot %s\n",
+	       passed ? "PASSED" : "FAILED", counter_ns, COUNTER_BUDGET_NS, exact ? "exact" : "wrong",
+	       served ? "read back" : "missing");
+
+	SDL_Quit();
+
+	return passed ? 0 : 1;
+}
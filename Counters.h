@@ -0,0 +1,139 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Counters.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h"   // For Uint32, Uint64 and SDL_Thread
+#include "Defines.h"   // Our defines header
+#include "Enums.h"     // For CounterId and CounterType
+#include "Atomic.h"    // For THREAD_LOCAL
+
+// One thread's share of every counter. Only that thread writes to it, so an //
+// update is a plain add with no lock or bus-locked instruction; a snapshot  //
+// adds the shards up. Threads past MAX_COUNTER_SHARDS - 1 all use the last  //
+// shard, which is marked shared and updated with atomic adds instead.      //
+struct CounterShard
+{
+	volatile Uint64 values[NUM_COUNTERS];                    // totals, or a histogram's sum
+	volatile Uint64 buckets[NUM_COUNTERS][COUNTER_BUCKETS];  // histogram samples in each bucket
+	bool            shared;
+	Uint8           padding[64];                             // keeps the next shard off our cache lines
+};
+
+// A Unix domain socket that answers each connection with a text snapshot //
+// of the counters and hangs up, served from its own thread.             //
+struct CounterServer
+{
+	int          handle;
+	char         path[COUNTER_MAX_PATH];
+	SDL_Thread*  thread;
+	volatile int stop;
+
+	Uint64       start;                       // microseconds, when the server started
+	Uint64       last_time;                   // when the last snapshot was taken
+	Uint64       last_values[NUM_COUNTERS];   // the totals then, for the rates
+	int          scrapes;
+	char         buffer[COUNTER_SNAPSHOT_SIZE];
+};
+
+// This thread's shard, NULL until its first update //
+extern THREAD_LOCAL CounterShard* g_ThreadCounters;
+
+// Gives this thread a shard of its own, or the shared one if they've run out //
+CounterShard* JoinCounters();
+
+// 64-bit loads and stores that can't be split, and an atomic add for the //
+// shared shard. The order they're seen in doesn't matter to a snapshot.  //
+#if defined(_MSC_VER) && defined(_M_IX86)
+// 32-bit x86 does a plain 64-bit access as two 32-bit ones, so everything //
+// goes through cmpxchg8b, which reads and writes all 8 bytes at once.     //
+inline Uint64 CounterLoad(volatile Uint64* value)
+{
+	return (Uint64)_InterlockedCompareExchange64((volatile __int64*)value, 0, 0);
+}
+inline void CounterStore(volatile Uint64* value, Uint64 total)
+{
+	__int64 seen = (__int64)CounterLoad(value);
+	__int64 last;
+	while ( (last = _InterlockedCompareExchange64((volatile __int64*)value, (__int64)total, seen)) != seen )
+		seen = last;
+}
+inline void CounterAtomicAdd(volatile Uint64* value, Uint64 amount)
+{
+	__int64 seen = (__int64)CounterLoad(value);
+	__int64 last;
+	while ( (last = _InterlockedCompareExchange64((volatile __int64*)value, seen + (__int64)amount, seen)) != seen )
+		seen = last;
+}
+#elif defined(_MSC_VER)
+// An aligned 8-byte access is a single one on 64-bit targets //
+inline Uint64 CounterLoad(volatile Uint64* value)                { return *value; }
+inline void   CounterStore(volatile Uint64* value, Uint64 total) { *value = total; }
+inline void   CounterAtomicAdd(volatile Uint64* value, Uint64 amount)
+{
+	_InterlockedExchangeAdd64((volatile __int64*)value, (__int64)amount);
+}
+#else
+inline Uint64 CounterLoad(volatile Uint64* value)                { return __atomic_load_n(value, __ATOMIC_RELAXED); }
+inline void   CounterStore(volatile Uint64* value, Uint64 total) { __atomic_store_n(value, total, __ATOMIC_RELAXED); }
+inline void   CounterAtomicAdd(volatile Uint64* value, Uint64 amount)
+{
+	__atomic_add_fetch(value, amount, __ATOMIC_RELAXED);
+}
+#endif
+
+inline void AddToShard(CounterShard* shard, volatile Uint64* value, Uint64 amount)
+{
+	if (shard->shared)
+		CounterAtomicAdd(value, amount);
+	else
+		CounterStore(value, CounterLoad(value) + amount);
+}
+
+// Bucket 0 holds zeros and bucket i values below 2 to the i, down to half //
+// that. The last bucket holds everything bigger.                          //
+inline int GetCounterBucket(Uint32 value)
+{
+	if (value == 0)
+		return 0;
+
+#ifdef _MSC_VER
+	unsigned long highest;
+	_BitScanReverse(&highest, value);
+	int bits = (int)highest + 1;
+#else
+	int bits = 32 - __builtin_clz(value);
+#endif
+
+	return bits < COUNTER_BUCKETS - 1 ? bits : COUNTER_BUCKETS - 1;
+}
+
+// Adds to a COUNTER_TOTAL //
+inline void AddCounter(int counter, Uint64 amount)
+{
+	CounterShard* shard = g_ThreadCounters ? g_ThreadCounters : JoinCounters();
+	AddToShard(shard, &shard->values[counter], amount);
+}
+
+// Records one value of a COUNTER_HISTOGRAM //
+inline void AddCounterSample(int counter, Uint32 value)
+{
+	CounterShard* shard = g_ThreadCounters ? g_ThreadCounters : JoinCounters();
+	AddToShard(shard, &shard->values[counter], value);
+	AddToShard(shard, &shard->buckets[counter][GetCounterBucket(value)], 1);
+}
+
+// Sets a COUNTER_GAUGE. Only one thread should set each gauge. //
+void SetCounter(int counter, Uint64 value);
+
+// A total, histogram sum or gauge, added up across the shards //
+Uint64 ReadCounter(int counter);
+
+// Starts serving snapshots on a socket at path. Returns false if it can't. //
+bool StartCounterServer(CounterServer* server, const char* path);
+void StopCounterServer(CounterServer* server);
+
+// Times counter updates against an atomic add and a mutex, checks every //
+// thread's updates add up, and reads a snapshot back through the socket. //
+int RunCounterBench();
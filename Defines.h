@@ -64,17 +64,171 @@
 // Number of levels, increase this value to add new levels //
 #define NUM_LEVELS 3
 
+// Where level N is read from, for the game and the level tools alike. Forward //
+// slashes and the directory's own case work everywhere, Windows included.     //
+// Data/moving_demo.txt shows off level scripts and isn't part of the game;    //
+// give it to the level tools by name.                                         //
+#define LEVEL_FILE_NAME "Data/level%d.txt"
+
 // Locations of output text //
 #define LIVES_X 5
 #define LIVES_Y 5
 #define LEVEL_X 75
 #define LEVEL_Y 5
 
-
-
-
-
-
-
-
-
+// Highest hit count a block can have //
+#define MAX_HITS 4
+
+// Number of threads used to run headless simulations //
+#define NUM_WORKER_THREADS 4
+
+// Level generator and difficulty estimator //
+#define ESTIMATOR_MAX_TICKS   36000  // give up on a simulated game after 20 minutes
+#define ESTIMATOR_AIM_RANGE   40     // max distance from paddle center the AI aims for
+#define ESTIMATOR_REACTION    3      // ticks the AI lags behind the ball (100 ms)
+#define BULK_LEVEL_MAGIC      "BBLV" // first four bytes of a bulk level file
+#define BULK_LEVEL_VERSION    1
+
+// Text rendering caches, so drawing the same text every frame allocates nothing //
+#define FONT_CACHE_SIZE 4   // number of font sizes kept open
+#define TEXT_CACHE_SIZE 16  // number of rendered strings kept around
+#define MAX_TEXT_LENGTH 64  // longer strings are rendered every time
+
+// Uncomment to count allocations per frame, per subsystem and per game state //
+//#define ALLOC_TRACKING
+#define MAX_TRACKED_STATES  8    // game states the allocation tracker reports on
+#define ALLOC_WARMUP_FRAMES 30   // frames -alloctest runs before checking
+#define ALLOC_TEST_FRAMES   300  // frames -alloctest checks for allocations
+
+// Headless frame benchmark (-framebench) //
+#define FRAMEBENCH_FRAMES  300                      // frames played on each level
+#define FRAME_STATS_SIZE   (FRAMEBENCH_FRAMES * NUM_LEVELS)  // most frame times kept
+#define GOLDEN_FRAMES_FILE "data/golden_frames.txt" // expected framebuffer hashes, made by -framebench record
+
+// Two player versus mode over UDP //
+#define MAX_PLAYERS          2
+#define INPUT_PLAYER_SHIFT   4      // bits between each player's InputFlags
+#define INPUT_PLAYER_MASK    0xF    // one player's InputFlags
+#define ROLLBACK_WINDOW      16     // most frames we'll run ahead of the other player
+#define INPUT_HISTORY        128    // frames of inputs and state hashes kept
+#define NET_INPUT_DELAY      2      // frames local input is held back to hide latency
+#define NET_INPUT_REDUNDANCY 8      // past inputs resent in every packet
+#define NET_MAX_PACKET       64     // largest packet we send or accept
+#define NET_DELAY_QUEUE_SIZE 256    // packets the latency injector can hold
+#define NET_TEST_TICKS       3000   // ticks -nettest plays
+#define NET_TEST_PORT        27960  // first of the two ports -nettest uses
+#define NET_FINISH_TIMEOUT   3000   // ms we keep answering the other player after the game ends
+
+// Recording gameplay to disk //
+#define CAPTURE_POOL_SIZE    8      // frames that can wait for the writer before we drop some
+#define CAPTURE_MAX_PATH     256    // longest capture directory name
+
+// Debris and sparks //
+#define MAX_PARTICLES        20480  // must be a multiple of 4
+#define PARTICLE_SIZE        2      // pixels across
+#define PARTICLE_LIFE        45     // most frames a particle lasts
+#define PARTICLE_GRAVITY     0.15f  // pixels per frame per frame
+#define PARTICLE_COLORS      4      // colors picked out of a block for its debris
+#define DEBRIS_PER_BLOCK     48     // particles when a block is destroyed
+#define SPARKS_PER_HIT       12     // particles when a block is only damaged
+#define PARTICLE_BENCH_COUNT  20000 // particles kept alive by -particlebench
+#define PARTICLE_BENCH_FRAMES 300
+#define PARTICLE_BUDGET       2000  // microseconds particles may take each frame
+
+// Entities and power-ups //
+#define MAX_ENTITIES         128    // at most 65535, handles keep the slot in 16 bits
+#define POWERUP_CHANCE       6      // one in this many destroyed blocks drops a power-up
+#define POWERUP_SIZE         16
+#define POWERUP_SPEED        3      // pixels per tick, straight down
+#define POWERUP_BONUS_POINTS 5
+#define ENTITY_BENCH_ITERATIONS 200000
+
+// Scaling the game to other window sizes. The game itself always works in //
+// WINDOW_WIDTH x WINDOW_HEIGHT, which is stretched evenly to fit the window. //
+#define SCALEBENCH_FRAMES    300
+#define SCALEBENCH_WIDTH     3840   // the size compared against WINDOW_WIDTH x WINDOW_HEIGHT
+#define SCALEBENCH_HEIGHT    2160
+
+// Collisions are recorded as events and applied once the ball has moved. A tick //
+// has at most a paddle hit or a lost life, every block one look in the grid     //
+// finds hit and destroyed, and a level cleared. GRID_MAX_FOUND is below.        //
+#define MAX_GAME_EVENTS      (2 * GRID_MAX_FOUND + 2)
+
+// Tile-parallel rendering. Each frame is recorded as a list of draws, which //
+// are sorted into a fixed grid of tiles that the render threads share out.   //
+#define RENDER_TILE_COLUMNS  8
+#define RENDER_TILE_ROWS     8
+#define RENDER_TILES         (RENDER_TILE_COLUMNS * RENDER_TILE_ROWS)
+#define RENDER_THREADS       NUM_WORKER_THREADS  // threads drawing the game's frames
+#define MAX_RENDER_THREADS   16
+#define MAX_DRAW_COMMANDS    512
+#define MAX_DRAW_TEMPORARIES 16    // surfaces freed once the frame is drawn
+#define MAX_PALETTE_MAPS     16    // 8-bit surfaces (text) drawn in a frame
+
+// Pixel-accurate collisions. Each sprite's shape is kept as a bit per pixel, //
+// a row of 32-bit words per scanline, big enough for the widest sprite.       //
+#define MASK_MAX_WIDTH       128   // a multiple of 32
+#define MASK_MAX_HEIGHT      32
+#define MASK_WORDS           (MASK_MAX_WIDTH / 32)
+#define COLLISIONBENCH_TESTS 1000000
+
+// The frame governor, which draws less of each frame when the game falls //
+// behind, so ticks keep coming FRAMES_PER_SECOND times a second.          //
+#define GOVERNOR_HIGH_WATER     90   // percent of a frame's time; more and we draw less
+#define GOVERNOR_LOW_WATER      60   // percent; less for a while and we draw more again
+#define GOVERNOR_SETTLE_FRAMES  15   // frames to wait after a change before judging it
+#define GOVERNOR_RECOVER_FRAMES 60   // frames in a row under the low water before drawing more
+#define GOVERNOR_MAX_LAG        (5 * (FRAME_RATE))  // ms behind before we give up on catching up
+#define GOVERNORBENCH_PHASE_TICKS 180   // ticks with no load, then heavy load, then none
+#define GOVERNORBENCH_LOAD      40000   // microseconds added to each frame drawn under load
+
+// Drawing in 8 bits (-indexed). Frames are put together in 256 colors and //
+// only expanded to the window's format when they're presented.            //
+#define PALETTE_TEXT_SHADES  16    // shades of the HUD green, for the edges of its text
+
+// Fast-forwarding while the ball is stuck above the blocks. Ticks are run //
+// ahead without being drawn, for up to a budget of each frame.            //
+#define FASTFORWARD_MAX_TICKS  300     // ticks run in one frame at most
+#define FASTFORWARD_BUDGET     15000   // microseconds of a frame spent on them at most
+#define FASTFORWARD_X          150     // where "Fast forward" is shown
+#define FASTFORWARD_Y          5
+#define WARPBENCH_MAX_TICKS    20000   // ticks played by -warpbench at most
+#define WARPBENCH_AFTER_TICKS  60      // ticks played after the ball comes down
+
+// Moving blocks //
+#define GRID_COLUMNS         (WINDOW_WIDTH / BLOCK_WIDTH)    // the block grid's cells are a block in size
+#define GRID_ROWS            (WINDOW_HEIGHT / BLOCK_HEIGHT)
+#define GRID_CELLS           (GRID_COLUMNS * GRID_ROWS)
+#define GRID_MAX_FOUND       32     // most blocks one look in the grid finds
+#define MAX_LEVEL_MOVES      16     // script lines a level can have
+#define MAX_MOVERS           MAX_BLOCKS
+#define MOVER_STEPS          64     // places along a mover's path, a power of two
+#define MOVER_WHEEL_SIZE     64     // ticks the mover schedule sorts ahead
+#define MOVERBENCH_BOARDS    12
+#define MOVERBENCH_TICKS     3000
+#define MOVERBENCH_QUERIES   200000
+
+// Startup //
+#define MAX_STARTUP_STAGES   16
+#define PRELOAD_FONT_SIZE    12     // the size DisplayText() is given, before it's scaled to the window
+#define TIMELINE_BAR_WIDTH   40     // characters across the startup timeline's bars
+#define STARTUP_BUDGET       250    // milliseconds -startuptest allows from Init() to the first frame
+#define STARTUPTEST_RUNS     3      // starts each way, keeping the fastest
+
+// Par solver //
+#define SOLVER_MAX_HITS      256    // paddle hits a solution can take
+#define SOLVER_MAX_NODES     200000 // paddle hits -par searches from before settling for the best found
+#define SOLVER_MAX_CHOICES   24     // different bounces tried at one paddle hit
+#define SOLVER_DEQUE_SIZE    1024   // nodes each solver thread can have waiting
+#define SOLVER_TABLE_SIZE    (1 << 20)  // states remembered, a power of two
+#define SOLVER_TABLE_LOCKS   64
+
+// Counters //
+#define MAX_COUNTER_SHARDS    16     // threads with counters of their own, the last shared by the rest
+#define COUNTER_BUCKETS       20     // histogram buckets, each twice as wide as the last
+#define COUNTER_MAX_PATH      104    // the shortest sun_path there is
+#define COUNTER_SNAPSHOT_SIZE 16384  // bytes of text a snapshot can take
+#define COUNTER_POLL_MS       100    // how often the counter server checks whether to stop
+#define COUNTERBENCH_UPDATES  20000000
+#define COUNTERBENCH_SOCKET   "counterbench.sock"
+#define COUNTER_BUDGET_NS     5      // what -counterbench allows an update on the game thread
@@ -0,0 +1,229 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Entities.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "Entities.h"
+#include "Timing.h"   // For GetMicroseconds()
+
+void ClearEntities(EntityStore* store)
+{
+	memset(store, 0, sizeof(EntityStore));
+
+	// The stack is upside down so slot 0 gets handed out first //
+	for (int i=0; i < MAX_ENTITIES; i++)
+	{
+		store->generations[i] = 1;
+		store->free_slots[i]  = (Uint16)(MAX_ENTITIES - 1 - i);
+	}
+	store->num_free = MAX_ENTITIES;
+}
+
+EntityHandle CreateEntity(EntityStore* store)
+{
+	if (store->num_free == 0)
+		return NULL_ENTITY;
+
+	int slot = store->free_slots[--store->num_free];
+	store->alive[slot]      = 1;
+	store->components[slot] = 0;
+
+	return GetEntityHandle(store, slot);
+}
+
+void DestroyEntity(EntityStore* store, EntityHandle entity)
+{
+	if ( !IsEntityAlive(store, entity) )
+		return;
+
+	int slot = EntitySlot(entity);
+
+	for (int c=0; c < NUM_COMPONENTS; c++)
+		RemoveComponent(store, entity, c);
+
+	store->alive[slot] = 0;
+
+	// Skip generation 0 when it wraps, so NULL_ENTITY stays invalid //
+	if (++store->generations[slot] == 0)
+		store->generations[slot] = 1;
+
+	store->free_slots[store->num_free++] = (Uint16)slot;
+}
+
+bool IsEntityAlive(const EntityStore* store, EntityHandle entity)
+{
+	int slot = EntitySlot(entity);
+
+	return slot < MAX_ENTITIES && store->alive[slot] && store->generations[slot] == (entity >> 16);
+}
+
+EntityHandle GetEntityHandle(const EntityStore* store, int slot)
+{
+	return ((Uint32)store->generations[slot] << 16) | slot;
+}
+
+void AddComponent(EntityStore* store, EntityHandle entity, int component)
+{
+	int slot = EntitySlot(entity);
+
+	if ( !IsEntityAlive(store, entity) || (store->components[slot] & COMPONENT_BIT(component)) )
+		return;
+
+	ComponentList& list = store->lists[component];
+	list.index[slot]            = (Uint16)list.count;
+	list.entities[list.count++] = (Uint16)slot;
+
+	store->components[slot] |= COMPONENT_BIT(component);
+}
+
+void RemoveComponent(EntityStore* store, EntityHandle entity, int component)
+{
+	int slot = EntitySlot(entity);
+
+	if ( !IsEntityAlive(store, entity) || !(store->components[slot] & COMPONENT_BIT(component)) )
+		return;
+
+	// Move the last entity in the list into the gap //
+	ComponentList& list = store->lists[component];
+	int gap  = list.index[slot];
+	int last = list.entities[--list.count];
+
+	list.entities[gap] = (Uint16)last;
+	list.index[last]   = (Uint16)gap;
+
+	store->components[slot] &= ~COMPONENT_BIT(component);
+}
+
+const ComponentList* GetSystemList(const EntityStore* store, int mask)
+{
+	const ComponentList* shortest = NULL;
+
+	for (int c=0; c < NUM_COMPONENTS; c++)
+	{
+		if ( (mask & COMPONENT_BIT(c)) &&
+			 (!shortest || store->lists[c].count < shortest->count) )
+			shortest = &store->lists[c];
+	}
+
+	return shortest;
+}
+
+// What the game would look like with every entity in one struct //
+struct NaiveEntity
+{
+	bool     alive;
+	int      components;
+	SDL_Rect position;
+	int      x_speed;
+	int      y_speed;
+	int      powerup_type;
+};
+
+// This function fills a store and a vector of structs with the same entities: //
+// every one has a position, and one in eight moves, like a few power-ups      //
+// falling among things that don't. It then times the movement system on both, //
+// and how long making and destroying an entity takes.                         //
+int RunEntityBench()
+{
+	static EntityStore store;
+	std::vector<NaiveEntity> naive(MAX_ENTITIES);
+
+	ClearEntities(&store);
+
+	for (int i=0; i < MAX_ENTITIES; i++)
+	{
+		EntityHandle entity = CreateEntity(&store);
+		AddComponent(&store, entity, COMPONENT_POSITION);
+		store.positions[i].x = (Sint16)i;
+
+		NaiveEntity& e = naive[i];
+		e.alive        = true;
+		e.components   = COMPONENT_BIT(COMPONENT_POSITION);
+		e.position     = store.positions[i];
+		e.x_speed      = 0;
+		e.y_speed      = 0;
+		e.powerup_type = 0;
+
+		// Speeds flip every tick so positions never run off //
+		if (i % 8 == 0)
+		{
+			AddComponent(&store, entity, COMPONENT_VELOCITY);
+			store.x_speeds[i] = e.x_speed = 1;
+			store.y_speeds[i] = e.y_speed = -1;
+			e.components |= COMPONENT_BIT(COMPONENT_VELOCITY);
+		}
+	}
+
+	int moving = COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_VELOCITY);
+
+	Uint64 start = GetMicroseconds();
+	for (int n=0; n < ENTITY_BENCH_ITERATIONS; n++)
+	{
+		const ComponentList* list = GetSystemList(&store, moving);
+		for (int i=0; i < list->count; i++)
+		{
+			int slot = list->entities[i];
+			if ( !HasComponents(&store, slot, moving) )
+				continue;
+
+			store.positions[slot].x += store.x_speeds[slot];
+			store.positions[slot].y += store.y_speeds[slot];
+			store.x_speeds[slot] = -store.x_speeds[slot];
+			store.y_speeds[slot] = -store.y_speeds[slot];
+		}
+	}
+	Uint64 store_time = GetMicroseconds() - start;
+
+	start = GetMicroseconds();
+	for (int n=0; n < ENTITY_BENCH_ITERATIONS; n++)
+	{
+		for (size_t i=0; i < naive.size(); i++)
+		{
+			NaiveEntity& e = naive[i];
+			if ( !e.alive || (e.components & moving) != moving )
+				continue;
+
+			e.position.x += e.x_speed;
+			e.position.y += e.y_speed;
+			e.x_speed = -e.x_speed;
+			e.y_speed = -e.y_speed;
+		}
+	}
+	Uint64 naive_time = GetMicroseconds() - start;
+
+	// Both sides must have done the same work //
+	bool same = true;
+	for (int i=0; i < MAX_ENTITIES; i++)
+	{
+		if ( store.positions[i].x != naive[i].position.x || store.positions[i].y != naive[i].position.y )
+			same = false;
+	}
+
+	// Churn through a power-up's lifetime: make it, give it parts, destroy it //
+	ClearEntities(&store);
+	start = GetMicroseconds();
+	for (int n=0; n < ENTITY_BENCH_ITERATIONS; n++)
+	{
+		EntityHandle entity = CreateEntity(&store);
+		AddComponent(&store, entity, COMPONENT_POSITION);
+		AddComponent(&store, entity, COMPONENT_VELOCITY);
+		AddComponent(&store, entity, COMPONENT_POWERUP);
+		DestroyEntity(&store, entity);
+	}
+	Uint64 churn_time = GetMicroseconds() - start;
+
+	double updates = (double)ENTITY_BENCH_ITERATIONS * MAX_ENTITIES;
+	printf("%d entities, %d of them moving, %d passes\n",
+	       MAX_ENTITIES, (MAX_ENTITIES + 7) / 8, ENTITY_BENCH_ITERATIONS);
+	printf("entity store:      %8.2f ms  %6.2f ns per entity\n", store_time / 1000.0, store_time * 1000.0 / updates);
+	printf("vector of structs: %8.2f ms  %6.2f ns per entity\n", naive_time / 1000.0, naive_time * 1000.0 / updates);
+	printf("create, add 3 components, destroy: %.1f ns\n", churn_time * 1000.0 / ENTITY_BENCH_ITERATIONS);
+
+	if (!same)
+		printf("FAILED: the entity store and the vector of structs disagree\n");
+
+	return same ? 0 : 1;
+}
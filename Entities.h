@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Entities.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Rect
+#include "Defines.h" // Our defines header
+#include "Enums.h"   // For Component
+
+// Refers to an entity: its slot in the low 16 bits and the slot's generation //
+// in the high 16. Destroying an entity bumps the generation, so old handles  //
+// to the slot stop working instead of pointing at whatever moves in next.    //
+typedef Uint32 EntityHandle;
+
+#define NULL_ENTITY        0   // generations start at 1, so no entity has this handle
+#define COMPONENT_BIT(c)   (1 << (c))
+
+// The entities that have one component, packed together so a system can loop //
+// over just those. index says where each slot is in the entities array.      //
+struct ComponentList
+{
+	Uint16 entities[MAX_ENTITIES];
+	Uint16 index[MAX_ENTITIES];
+	int    count;
+};
+
+// Things in the game that come and go, like power-ups. Each component's data //
+// is an array indexed by slot, and free slots are kept on a stack, so making //
+// and destroying entities never allocates. Like the rest of GameState it has //
+// no pointers, so copying it copies everything.                              //
+struct EntityStore
+{
+	Uint16 generations[MAX_ENTITIES];
+	Uint8  alive[MAX_ENTITIES];
+	Uint8  components[MAX_ENTITIES];   // COMPONENT_BITs
+	Uint16 free_slots[MAX_ENTITIES];
+	int    num_free;
+
+	ComponentList lists[NUM_COMPONENTS];
+
+	// Component data //
+	SDL_Rect positions[MAX_ENTITIES];
+	int      x_speeds[MAX_ENTITIES];
+	int      y_speeds[MAX_ENTITIES];
+	int      powerup_types[MAX_ENTITIES];  // PowerUpType
+};
+
+void ClearEntities(EntityStore* store);
+
+// Returns NULL_ENTITY if every slot is taken //
+EntityHandle CreateEntity(EntityStore* store);
+void DestroyEntity(EntityStore* store, EntityHandle entity);
+bool IsEntityAlive(const EntityStore* store, EntityHandle entity);
+
+inline int EntitySlot(EntityHandle entity) { return entity & 0xFFFF; }
+EntityHandle GetEntityHandle(const EntityStore* store, int slot);
+
+void AddComponent(EntityStore* store, EntityHandle entity, int component);
+void RemoveComponent(EntityStore* store, EntityHandle entity, int component);
+
+// Returns the shortest list among the components in mask. A system loops over //
+// it, skipping slots missing any of the others. Destroying entities moves the //
+// end of the list into the gap, so loop backwards if the system does that.   //
+const ComponentList* GetSystemList(const EntityStore* store, int mask);
+
+inline bool HasComponents(const EntityStore* store, int slot, int mask)
+{
+	return (store->components[slot] & mask) == mask;
+}
+
+// Times the movement system against a plain vector of structs //
+int RunEntityBench();
@@ -12,3 +12,137 @@ enum Direction
 	DOWN
 };
 */
+
+// Player input for a single simulation tick, stored as bit flags //
+enum InputFlags
+{
+	INPUT_NONE   = 0,
+	INPUT_LEFT   = 1 << 0,
+	INPUT_RIGHT  = 1 << 1,
+	INPUT_LAUNCH = 1 << 2
+};
+
+// Outcome of the game after a simulation tick //
+enum GameResult
+{
+	RESULT_PLAYING,
+	RESULT_WON,
+	RESULT_LOST
+};
+
+// Symmetry patterns used by the level generator //
+enum LevelSymmetry
+{
+	SYMMETRY_NONE,
+	SYMMETRY_MIRROR_X,   // left half mirrored onto the right half
+	SYMMETRY_MIRROR_Y,   // top half mirrored onto the bottom half
+	SYMMETRY_MIRROR_XY,  // both of the above
+	NUM_SYMMETRIES
+};
+
+// Parts of the game the allocation tracker charges allocations to //
+enum AllocSubsystem
+{
+	ALLOC_OTHER,
+	ALLOC_INPUT,
+	ALLOC_SIMULATION,
+	ALLOC_RENDER,
+	ALLOC_TEXT,
+	ALLOC_LEVELS,
+	NUM_ALLOC_SUBSYSTEMS
+};
+
+// File formats the frame capture can write //
+enum CaptureFormat
+{
+	CAPTURE_RAW,   // one file of 24-bit RGB frames
+	CAPTURE_PNG    // a PNG per frame
+};
+
+// The parts an entity can be made of. Each has its own array in the EntityStore. //
+enum Component
+{
+	COMPONENT_POSITION,   // a rect on the screen
+	COMPONENT_VELOCITY,   // moves every tick
+	COMPONENT_POWERUP,    // can be caught by a paddle
+	NUM_COMPONENTS
+};
+
+// What catching a power-up does //
+enum PowerUpType
+{
+	POWERUP_EXTRA_LIFE,
+	POWERUP_BONUS,        // POWERUP_BONUS_POINTS to whoever catches it
+	NUM_POWERUP_TYPES
+};
+
+// Things that happen during a tick, in the order they're applied //
+enum GameEventType
+{
+	EVENT_PADDLE_HIT,       // index is the player
+	EVENT_BLOCK_HIT,        // index is the block
+	EVENT_BLOCK_DESTROYED,  // index is the block
+	EVENT_LEVEL_CLEARED,    // index is the level that was cleared
+	EVENT_LIFE_LOST         // index is unused
+};
+
+// The kinds of drawing a frame is made of //
+enum DrawCommandType
+{
+	DRAW_FILL,        // a solid rect
+	DRAW_BLIT,        // a copy of part of another surface
+	DRAW_PARTICLES    // everything in a ParticlePool
+};
+
+// How much of each frame gets drawn when the game can't keep up. Each level //
+// gives up more than the one before; the simulation always runs in full.   //
+enum GovernorLevel
+{
+	GOVERNOR_FULL,            // everything, every frame
+	GOVERNOR_NO_HUD,          // no lives and level text
+	GOVERNOR_HALF_PRESENTS,   // no text, and only every other frame drawn
+	NUM_GOVERNOR_LEVELS
+};
+
+// How a level's script moves its blocks //
+enum MoverType
+{
+	MOVER_SLIDE,   // back and forth along a line, a whole row together
+	MOVER_ORBIT    // round an ellipse, one block
+};
+
+// What the counters in Counters.h keep track of //
+enum CounterId
+{
+	COUNTER_TICKS,              // ticks played, fast forwarded ones included, replays not
+	COUNTER_MOVER_STEPS,        // blocks moved by level scripts
+	COUNTER_FASTFORWARD_TICKS,  // ticks run ahead without being drawn
+	COUNTER_DROPPED_TICKS,      // ticks given up on when too far behind
+	COUNTER_BLOCKS_LEFT,        // in the game being played
+	COUNTER_GOVERNOR_LEVEL,     // GovernorLevel
+	COUNTER_TICK_TIME,          // microseconds of input, simulation and drawing
+	COUNTER_COLLISION_CHECKS,   // blocks the ball was tested against, each tick
+	COUNTER_BLITS,              // draw commands in each frame
+	COUNTER_TEXT_RENDERS,       // text SDL_ttf had to render for each frame
+	NUM_COUNTERS
+};
+
+// How a counter's values add up //
+enum CounterType
+{
+	COUNTER_TOTAL,       // only ever goes up
+	COUNTER_GAUGE,       // set to the latest value
+	COUNTER_HISTOGRAM    // a sum and a count of values in each bucket
+};
+
+// The images we cut out of BlockBreaker.bmp and keep scaled to the window //
+enum Sprite
+{
+	SPRITE_PADDLE,
+	SPRITE_BALL,
+	SPRITE_RED,
+	SPRITE_YELLOW,
+	SPRITE_GREEN,
+	SPRITE_BLUE,
+	NUM_SPRITES
+};
@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    FrameBench.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+// Helpers for the headless frame benchmark in Main.cpp: framebuffer hashes, //
+// golden hash files and frame time percentiles.                            //
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FrameBench.h"
+
+// FNV-1a, run over each row of pixels //
+Uint32 HashSurface(SDL_Surface* surface)
+{
+	Uint32 hash = 2166136261u;
+
+	if ( SDL_MUSTLOCK(surface) )
+		SDL_LockSurface(surface);
+
+	int row_bytes = surface->w * surface->format->BytesPerPixel;
+
+	for (int y=0; y < surface->h; y++)
+	{
+		const Uint8* row = (const Uint8*)surface->pixels + y * surface->pitch;
+
+		for (int x=0; x < row_bytes; x++)
+		{
+			hash ^= row[x];
+			hash *= 16777619u;
+		}
+	}
+
+	if ( SDL_MUSTLOCK(surface) )
+		SDL_UnlockSurface(surface);
+
+	return hash;
+}
+
+void ClearFrameTimes(FrameTimeStats* stats)
+{
+	stats->count = 0;
+}
+
+void AddFrameTime(FrameTimeStats* stats, Uint32 microseconds)
+{
+	if (stats->count < FRAME_STATS_SIZE)
+		stats->samples[stats->count++] = microseconds;
+}
+
+static int CompareTimes(const void* a, const void* b)
+{
+	Uint32 left  = *(const Uint32*)a;
+	Uint32 right = *(const Uint32*)b;
+	return (left > right) - (left < right);
+}
+
+void PrintFrameTimes(const char* name, FrameTimeStats* stats)
+{
+	if (stats->count == 0)
+	{
+		printf("%-10s no frames\n", name);
+		return;
+	}
+
+	qsort(stats->samples, stats->count, sizeof(Uint32), CompareTimes);
+
+	printf("%-10s p50 %6u us  p99 %6u us  max %6u us  (%d frames)\n", name,
+	       stats->samples[stats->count / 2],
+	       stats->samples[(stats->count * 99) / 100],
+	       stats->samples[stats->count - 1],
+	       stats->count);
+}
+
+bool LoadGoldenFrames(const char* file_name, GoldenFrames* golden)
+{
+	FILE* inFile = fopen(file_name, "r");
+
+	if (!inFile)
+		return false;
+
+	memset(golden, 0, sizeof(GoldenFrames));
+
+	int level, frame;
+	unsigned int hash;
+	while (fscanf(inFile, "%d %d %x", &level, &frame, &hash) == 3)
+	{
+		if (level < 1 || level > NUM_LEVELS || frame < 0 || frame >= FRAMEBENCH_FRAMES)
+			continue;
+
+		golden->hashes[level - 1][frame] = hash;
+		if (frame + 1 > golden->num_frames[level - 1])
+			golden->num_frames[level - 1] = frame + 1;
+	}
+
+	fclose(inFile);
+
+	return true;
+}
+
+bool SaveGoldenFrames(const char* file_name, const GoldenFrames* golden)
+{
+	FILE* outFile = fopen(file_name, "w");
+
+	if (!outFile)
+		return false;
+
+	for (int level=0; level < NUM_LEVELS; level++)
+	{
+		for (int frame=0; frame < golden->num_frames[level]; frame++)
+		{
+			fprintf(outFile, "%d %d %08x\n", level + 1, frame, golden->hashes[level][frame]);
+		}
+	}
+
+	fclose(outFile);
+
+	return true;
+}
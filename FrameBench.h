@@ -0,0 +1,43 @@
+//////////////////////////////////////////////////////////////////////////////////
+// FrameBench.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Surface
+#include "Defines.h" // Our defines header
+
+// How long each part of the last game frame took, in microseconds //
+struct FramePhaseTimes
+{
+	Uint32 input;
+	Uint32 simulation;
+	Uint32 render;
+	Uint32 expand;       // of render, turning an 8-bit frame into the window's colors
+};
+
+// A list of frame times we can pull percentiles out of //
+struct FrameTimeStats
+{
+	Uint32 samples[FRAME_STATS_SIZE];
+	int    count;
+};
+
+// The framebuffer hash expected after each frame of each level //
+struct GoldenFrames
+{
+	Uint32 hashes[NUM_LEVELS][FRAMEBENCH_FRAMES];
+	int    num_frames[NUM_LEVELS];   // frames played before the level ended
+};
+
+// Hashes the visible pixels of a surface, ignoring any padding at the end of rows //
+Uint32 HashSurface(SDL_Surface* surface);
+
+void ClearFrameTimes(FrameTimeStats* stats);
+void AddFrameTime(FrameTimeStats* stats, Uint32 microseconds);
+// Prints the p50, p99 and max of the samples (sorts them in the process) //
+void PrintFrameTimes(const char* name, FrameTimeStats* stats);
+
+// Golden files have one "level frame hash" line per frame //
+bool LoadGoldenFrames(const char* file_name, GoldenFrames* golden);
+bool SaveGoldenFrames(const char* file_name, const GoldenFrames* golden);
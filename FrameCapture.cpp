@@ -0,0 +1,400 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    FrameCapture.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <string.h>
+#include "FrameCapture.h"
+#include "Atomic.h" // For AtomicLoad() and AtomicStore()
+#include "Timing.h" // For GetMicroseconds()
+
+// Largest stored (uncompressed) deflate block //
+#define PNG_MAX_BLOCK 65535
+
+static Uint32 g_CrcTable[256];
+
+static void MakeCrcTable()
+{
+	for (Uint32 i=0; i < 256; i++)
+	{
+		Uint32 crc = i;
+		for (int bit=0; bit < 8; bit++)
+			crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+		g_CrcTable[i] = crc;
+	}
+}
+
+// A PNG being written a row at a time. The image data is stored rather than //
+// compressed, which needs no zlib and keeps the writer quick; the files are //
+// big, but they're only there to be turned into a video.                    //
+struct PngStream
+{
+	FILE*  file;
+	Uint32 crc;         // of the chunk being written
+	Uint32 adler_a;     // of the image data
+	Uint32 adler_b;
+	int    data_left;   // image bytes still to come
+	int    block_left;  // image bytes left in the current deflate block
+};
+
+static void PngWrite(PngStream* png, const Uint8* data, int size)
+{
+	for (int i=0; i < size; i++)
+		png->crc = g_CrcTable[(png->crc ^ data[i]) & 0xFF] ^ (png->crc >> 8);
+
+	fwrite(data, 1, size, png->file);
+}
+
+static void PngWriteInt(PngStream* png, Uint32 value)
+{
+	Uint8 bytes[4] = { (Uint8)(value >> 24), (Uint8)(value >> 16), (Uint8)(value >> 8), (Uint8)value };
+	PngWrite(png, bytes, 4);
+}
+
+static void PngStartChunk(PngStream* png, const char* type, Uint32 size)
+{
+	Uint8 bytes[4] = { (Uint8)(size >> 24), (Uint8)(size >> 16), (Uint8)(size >> 8), (Uint8)size };
+	fwrite(bytes, 1, 4, png->file);
+
+	png->crc = 0xFFFFFFFFu;
+	PngWrite(png, (const Uint8*)type, 4);
+}
+
+static void PngEndChunk(PngStream* png)
+{
+	Uint32 crc = png->crc ^ 0xFFFFFFFFu;
+	Uint8 bytes[4] = { (Uint8)(crc >> 24), (Uint8)(crc >> 16), (Uint8)(crc >> 8), (Uint8)crc };
+	fwrite(bytes, 1, 4, png->file);
+}
+
+// Writes image data, starting a new stored block whenever the last one is full //
+static void PngWriteImageData(PngStream* png, const Uint8* data, int size)
+{
+	while (size > 0)
+	{
+		if (png->block_left == 0)
+		{
+			int block_size = png->data_left < PNG_MAX_BLOCK ? png->data_left : PNG_MAX_BLOCK;
+			Uint8 header[5] = { (Uint8)(png->data_left == block_size ? 1 : 0),
+			                    (Uint8)block_size, (Uint8)(block_size >> 8),
+			                    (Uint8)~block_size, (Uint8)(~block_size >> 8) };
+			PngWrite(png, header, 5);
+			png->block_left = block_size;
+		}
+
+		int count = size < png->block_left ? size : png->block_left;
+		PngWrite(png, data, count);
+
+		for (int i=0; i < count; i++)
+		{
+			png->adler_a = (png->adler_a + data[i]) % 65521;
+			png->adler_b = (png->adler_b + png->adler_a) % 65521;
+		}
+
+		png->block_left -= count;
+		png->data_left  -= count;
+		data += count;
+		size -= count;
+	}
+}
+
+// Converts one row of a captured frame to 24-bit RGB //
+static void ConvertRow(const CaptureBuffer* buffer, int y, Uint8* rgb)
+{
+	const Uint8* source = buffer->pixels + y * buffer->width * buffer->bytes_per_pixel;
+
+	for (int x=0; x < buffer->width; x++)
+	{
+		Uint32 pixel;
+		switch (buffer->bytes_per_pixel)
+		{
+		case 1:
+			rgb[0] = buffer->palette[source[x]].r;
+			rgb[1] = buffer->palette[source[x]].g;
+			rgb[2] = buffer->palette[source[x]].b;
+			rgb += 3;
+			continue;
+		case 2:
+			pixel = ((const Uint16*)source)[x];
+			break;
+		case 3:
+			pixel = source[x*3] | (source[x*3 + 1] << 8) | (source[x*3 + 2] << 16);
+			break;
+		default:
+			pixel = ((const Uint32*)source)[x];
+			break;
+		}
+
+		for (int c=0; c < 3; c++)
+			*rgb++ = (Uint8)(((pixel & buffer->masks[c]) >> buffer->shifts[c]) << buffer->losses[c]);
+	}
+}
+
+static bool WritePng(FrameCapture* capture, const CaptureBuffer* buffer)
+{
+	char file_name[CAPTURE_MAX_PATH + 32];
+	sprintf(file_name, "%s/frame%05d.png", capture->directory, buffer->frame);
+
+	PngStream png;
+	png.file = fopen(file_name, "wb");
+	if (!png.file)
+		return false;
+
+	static const Uint8 signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	fwrite(signature, 1, 8, png.file);
+
+	// 8 bits per channel RGB, no interlacing //
+	PngStartChunk(&png, "IHDR", 13);
+	PngWriteInt(&png, buffer->width);
+	PngWriteInt(&png, buffer->height);
+	Uint8 header[5] = { 8, 2, 0, 0, 0 };
+	PngWrite(&png, header, 5);
+	PngEndChunk(&png);
+
+	// Every row starts with a 0 to say it isn't filtered //
+	int row_size   = buffer->width * 3 + 1;
+	int data_size  = row_size * buffer->height;
+	int num_blocks = (data_size + PNG_MAX_BLOCK - 1) / PNG_MAX_BLOCK;
+
+	png.adler_a    = 1;
+	png.adler_b    = 0;
+	png.data_left  = data_size;
+	png.block_left = 0;
+
+	PngStartChunk(&png, "IDAT", 2 + data_size + num_blocks * 5 + 4);
+	Uint8 zlib_header[2] = { 0x78, 0x01 };
+	PngWrite(&png, zlib_header, 2);
+
+	for (int y=0; y < buffer->height; y++)
+	{
+		capture->row[0] = 0;
+		ConvertRow(buffer, y, capture->row + 1);
+		PngWriteImageData(&png, capture->row, row_size);
+	}
+
+	PngWriteInt(&png, (png.adler_b << 16) | png.adler_a);
+	PngEndChunk(&png);
+
+	PngStartChunk(&png, "IEND", 0);
+	PngEndChunk(&png);
+
+	bool failed = (ferror(png.file) != 0);
+	return (fclose(png.file) == 0) && !failed;
+}
+
+// Raw frames are appended to one file of 24-bit RGB, which ffmpeg reads with  //
+// -f rawvideo -pix_fmt rgb24 -s <width>x<height>. A dropped frame leaves no    //
+// gap there, the file is just a frame shorter and plays that much too fast, so //
+// each run of drops goes in capture.drops as a line of "<frames in the file    //
+// before it> <frames dropped>", enough to put the timing back.                 //
+static bool WriteRaw(FrameCapture* capture, const CaptureBuffer* buffer)
+{
+	if (buffer->frame > capture->next_frame)
+	{
+		fprintf(capture->drops_file, "%d %d\n", capture->frames_written + capture->write_failures,
+		        buffer->frame - capture->next_frame);
+	}
+	capture->next_frame = buffer->frame + 1;
+
+	for (int y=0; y < buffer->height; y++)
+	{
+		ConvertRow(buffer, y, capture->row);
+		fwrite(capture->row, 3, buffer->width, capture->raw_file);
+	}
+
+	return ferror(capture->raw_file) == 0;
+}
+
+static int CaptureWriterThread(void* data)
+{
+	FrameCapture* capture = (FrameCapture*)data;
+
+	for (;;)
+	{
+		int tail = capture->tail;
+
+		// Sleep until there's something to write, or we're told to stop //
+		if ( tail == AtomicLoad(&capture->head) )
+		{
+			if ( !AtomicLoad(&capture->running) && tail == AtomicLoad(&capture->head) )
+				break;
+			SDL_Delay(1);
+			continue;
+		}
+
+		Uint64 start = GetMicroseconds();
+
+		const CaptureBuffer* buffer = &capture->buffers[tail % CAPTURE_POOL_SIZE];
+		bool written = (capture->format == CAPTURE_PNG) ? WritePng(capture, buffer) : WriteRaw(capture, buffer);
+
+		if (written)
+			capture->frames_written++;
+		else
+			capture->write_failures++;
+		capture->write_microseconds += GetMicroseconds() - start;
+
+		// Hand the buffer back to the game thread //
+		AtomicStore(&capture->tail, tail + 1);
+	}
+
+	return 0;
+}
+
+bool StartCapture(FrameCapture* capture, int format, const char* directory, int width, int height)
+{
+	memset(capture, 0, sizeof(FrameCapture));
+
+	if (strlen(directory) >= CAPTURE_MAX_PATH)
+		return false;
+
+	capture->format = format;
+	capture->width  = width;
+	capture->height = height;
+	strcpy(capture->directory, directory);
+
+	if (format == CAPTURE_RAW)
+	{
+		char file_name[CAPTURE_MAX_PATH + 32];
+		sprintf(file_name, "%s/capture.rgb", directory);
+
+		capture->raw_file = fopen(file_name, "wb");
+		if (!capture->raw_file)
+			return false;
+
+		sprintf(file_name, "%s/capture.drops", directory);
+
+		capture->drops_file = fopen(file_name, "w");
+		if (!capture->drops_file)
+		{
+			fclose(capture->raw_file);
+			capture->raw_file = NULL;
+			return false;
+		}
+	}
+
+	MakeCrcTable();
+
+	// Everything is allocated up front so capturing never allocates mid-game //
+	capture->row = (Uint8*)malloc(width * 3 + 1);
+	bool allocated = (capture->row != NULL);
+
+	for (int i=0; i < CAPTURE_POOL_SIZE; i++)
+	{
+		// Touch every page now, so the first frames don't pay for it //
+		capture->buffers[i].pixels = (Uint8*)malloc(width * height * 4);
+		if (capture->buffers[i].pixels)
+			memset(capture->buffers[i].pixels, 0, width * height * 4);
+		else
+			allocated = false;
+	}
+
+	capture->running = 1;
+
+	if (allocated)
+		capture->writer = SDL_CreateThread(CaptureWriterThread, capture);
+
+	if (!capture->writer)
+	{
+		StopCapture(capture);
+		return false;
+	}
+
+	return true;
+}
+
+void CaptureFrame(FrameCapture* capture, SDL_Surface* surface)
+{
+	int head    = capture->head;
+	int backlog = head - AtomicLoad(&capture->tail);
+
+	if (backlog > capture->max_backlog)
+		capture->max_backlog = backlog;
+
+	int frame = capture->frames_presented++;
+
+	// Don't wait for the writer, just lose the frame. The window may also //
+	// have been resized past what the buffers hold.                      //
+	if (backlog >= CAPTURE_POOL_SIZE || surface->w != capture->width || surface->h != capture->height)
+	{
+		capture->frames_dropped++;
+		return;
+	}
+
+	CaptureBuffer* buffer = &capture->buffers[head % CAPTURE_POOL_SIZE];
+
+	SDL_PixelFormat* format = surface->format;
+	buffer->frame           = frame;
+	buffer->width           = surface->w;
+	buffer->height          = surface->h;
+	buffer->bytes_per_pixel = format->BytesPerPixel;
+	buffer->masks[0]  = format->Rmask;  buffer->masks[1]  = format->Gmask;  buffer->masks[2]  = format->Bmask;
+	buffer->shifts[0] = format->Rshift; buffer->shifts[1] = format->Gshift; buffer->shifts[2] = format->Bshift;
+	buffer->losses[0] = format->Rloss;  buffer->losses[1] = format->Gloss;  buffer->losses[2] = format->Bloss;
+
+	if (format->palette)
+		memcpy(buffer->palette, format->palette->colors, format->palette->ncolors * sizeof(SDL_Color));
+
+	if ( SDL_MUSTLOCK(surface) )
+		SDL_LockSurface(surface);
+
+	int row_size = surface->w * format->BytesPerPixel;
+	for (int y=0; y < surface->h; y++)
+	{
+		memcpy(buffer->pixels + y * row_size, (Uint8*)surface->pixels + y * surface->pitch, row_size);
+	}
+
+	if ( SDL_MUSTLOCK(surface) )
+		SDL_UnlockSurface(surface);
+
+	// Hand the buffer to the writer //
+	AtomicStore(&capture->head, head + 1);
+}
+
+int CaptureBacklog(FrameCapture* capture)
+{
+	return capture->head - AtomicLoad(&capture->tail);
+}
+
+void StopCapture(FrameCapture* capture)
+{
+	AtomicStore(&capture->running, 0);
+
+	if (capture->writer)
+	{
+		SDL_WaitThread(capture->writer, NULL);
+
+		printf("capture: %d frames presented, %d dropped, %d written, %d failed to write\n",
+		       capture->frames_presented, capture->frames_dropped, capture->frames_written,
+		       capture->write_failures);
+		printf("capture: worst backlog %d of %d buffers, %.2f ms to write a frame\n",
+		       capture->max_backlog, CAPTURE_POOL_SIZE,
+		       capture->frames_written ? capture->write_microseconds / 1000.0 / capture->frames_written : 0.0);
+	}
+	capture->writer = NULL;
+
+	if (capture->raw_file)
+		fclose(capture->raw_file);
+	capture->raw_file = NULL;
+
+	// The writer never saw the frames dropped after its last one //
+	if (capture->drops_file)
+	{
+		if (capture->frames_presented > capture->next_frame)
+		{
+			fprintf(capture->drops_file, "%d %d\n", capture->frames_written + capture->write_failures,
+			        capture->frames_presented - capture->next_frame);
+		}
+		fclose(capture->drops_file);
+	}
+	capture->drops_file = NULL;
+
+	free(capture->row);
+	capture->row = NULL;
+
+	for (int i=0; i < CAPTURE_POOL_SIZE; i++)
+	{
+		free(capture->buffers[i].pixels);
+		capture->buffers[i].pixels = NULL;
+	}
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////////////////
+// FrameCapture.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdio.h>   // For FILE
+#include "SDL/SDL.h" // For SDL_Surface and SDL_Thread
+#include "Defines.h" // Our defines header
+#include "Enums.h"   // For CaptureFormat
+
+// One captured frame, copied straight out of the window surface. The pixel //
+// format goes along with it so the writer can turn it into RGB later.      //
+struct CaptureBuffer
+{
+	Uint8*    pixels;   // rows packed together, no padding
+	int       frame;    // frames presented before this one, counting dropped ones
+	int       width;
+	int       height;
+	int       bytes_per_pixel;
+	Uint32    masks[3];     // red, green and blue
+	Uint8     shifts[3];
+	Uint8     losses[3];
+	SDL_Color palette[256]; // for 8-bit surfaces
+};
+
+// Records the frames the game presents. The game thread copies each frame  //
+// into a free buffer of the pool and moves on; a writer thread saves the   //
+// buffers to disk in order. The pool doubles as the queue between the two: //
+// the game thread only moves head and the writer only moves tail, so no    //
+// locks are needed. When the writer falls behind and the pool fills up,    //
+// frames are dropped rather than making the game wait.                     //
+struct FrameCapture
+{
+	int   format;                      // CaptureFormat
+	char  directory[CAPTURE_MAX_PATH];
+	FILE* raw_file;                    // every frame goes into one file in raw format
+	FILE* drops_file;                  // and where frames are missing from it
+	int   next_frame;                  // the frame the writer expects next
+	Uint8* row;                        // the writer's RGB row
+
+	int           width;               // the size the pool was made for, frames
+	int           height;              // of any other size are dropped
+	CaptureBuffer buffers[CAPTURE_POOL_SIZE];
+	volatile int  head;                // frames handed to the writer
+	volatile int  tail;                // frames the writer is done with
+	volatile int  running;             // cleared to tell the writer to finish up
+	SDL_Thread*   writer;
+
+	// Counters, kept by the game thread //
+	int frames_presented;
+	int frames_dropped;
+	int max_backlog;
+
+	// Counters, kept by the writer //
+	int    frames_written;
+	int    write_failures;
+	Uint64 write_microseconds;
+};
+
+// Allocates the buffer pool and starts the writer. Frames are written to the //
+// directory, which must already exist, as frameNNNNN.png or capture.rgb.     //
+// Raw captures also get capture.drops, listing the frames that were dropped. //
+bool StartCapture(FrameCapture* capture, int format, const char* directory, int width, int height);
+
+// Copies the surface into the next free buffer, or drops the frame if there //
+// isn't one. Never waits on the writer.                                     //
+void CaptureFrame(FrameCapture* capture, SDL_Surface* surface);
+
+// Number of frames waiting to be written //
+int  CaptureBacklog(FrameCapture* capture);
+
+// Waits for the writer to finish the backlog, then prints the counters //
+void StopCapture(FrameCapture* capture);
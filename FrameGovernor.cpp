@@ -0,0 +1,120 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    FrameGovernor.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "FrameGovernor.h"
+
+static const char* g_GovernorLevelNames[NUM_GOVERNOR_LEVELS] = { "full", "no hud", "half" };
+
+void ResetGovernor(FrameGovernor* governor, bool enabled)
+{
+	memset(governor, 0, sizeof(FrameGovernor));
+	governor->enabled  = enabled;
+	governor->level    = GOVERNOR_FULL;
+	governor->present  = true;
+	governor->draw_hud = true;
+}
+
+bool StartGovernedFrame(FrameGovernor* governor)
+{
+	governor->frames++;
+	governor->frames_at_level[governor->level]++;
+
+	// Odd frames are the ones left out //
+	governor->present  = !(governor->level >= GOVERNOR_HALF_PRESENTS && (governor->frames & 1));
+	governor->draw_hud = governor->level < GOVERNOR_NO_HUD;
+
+	if (!governor->present)
+		governor->skipped_presents++;
+	else
+	{
+		governor->presents++;
+		if (!governor->draw_hud)
+			governor->skipped_huds++;
+	}
+
+	return governor->present;
+}
+
+static void ChangeLevel(FrameGovernor* governor, int level)
+{
+	if (level > governor->level)
+		governor->degrades++;
+	else
+		governor->recoveries++;
+
+	governor->level       = level;
+	governor->settle      = GOVERNOR_SETTLE_FRAMES;
+	governor->calm_frames = 0;
+}
+
+void EndGovernedFrame(FrameGovernor* governor, Uint32 simulation, Uint32 render, int lag)
+{
+	AddFrameTime(&governor->tick_times, simulation + render);
+
+	bool late = lag > FRAME_RATE;
+	if (late)
+		governor->late_ticks++;
+
+	if (!governor->enabled)
+		return;
+
+	// Averages over roughly the last eight frames //
+	governor->simulation_cost = (governor->simulation_cost * 7 + simulation) / 8;
+	if (governor->present)
+		governor->render_cost = (governor->render_cost * 7 + render) / 8;
+
+	// What a tick costs on average at this level //
+	Uint32 cost   = governor->simulation_cost + (governor->level >= GOVERNOR_HALF_PRESENTS ?
+	                                             governor->render_cost / 2 : governor->render_cost);
+	Uint32 budget = (FRAME_RATE) * 1000;
+
+	// Being a whole frame behind can't wait for the averages to catch up //
+	if ( late && governor->level < NUM_GOVERNOR_LEVELS - 1 )
+	{
+		ChangeLevel(governor, governor->level + 1);
+		return;
+	}
+
+	if (governor->settle > 0)
+	{
+		governor->settle--;
+		return;
+	}
+
+	if ( cost > budget * GOVERNOR_HIGH_WATER / 100 )
+	{
+		governor->calm_frames = 0;
+		if (governor->level < NUM_GOVERNOR_LEVELS - 1)
+			ChangeLevel(governor, governor->level + 1);
+	}
+	else if ( cost < budget * GOVERNOR_LOW_WATER / 100 && !late )
+	{
+		if (++governor->calm_frames >= GOVERNOR_RECOVER_FRAMES && governor->level > GOVERNOR_FULL)
+			ChangeLevel(governor, governor->level - 1);
+	}
+	else
+	{
+		governor->calm_frames = 0;
+	}
+}
+
+void PrintGovernorReport(FrameGovernor* governor)
+{
+	if (governor->frames == 0)
+		return;
+
+	printf("governor: %u ticks, %u drawn, %u skipped, %u without text, %u late, %u dropped\n",
+	       governor->frames, governor->presents, governor->skipped_presents, governor->skipped_huds,
+	       governor->late_ticks, governor->dropped_ticks);
+	printf("governor: %u times drew less, %u times more, now at %s;", governor->degrades,
+	       governor->recoveries, g_GovernorLevelNames[governor->level]);
+	for (int i=0; i < NUM_GOVERNOR_LEVELS; i++)
+		printf(" %u %s", governor->frames_at_level[i], g_GovernorLevelNames[i]);
+	printf("\n");
+
+	PrintFrameTimes("tick", &governor->tick_times);
+}
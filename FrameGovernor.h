@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////////////
+// FrameGovernor.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h"      // For Uint32
+#include "Defines.h"      // Our defines header
+#include "Enums.h"        // For GovernorLevel
+#include "FrameBench.h"   // For FrameTimeStats
+
+// Keeps track of what the simulation and drawing cost each tick, and draws //
+// less when they don't fit in a frame: first the text goes, then every     //
+// other frame. It goes back a level at a time once there's room again.     //
+struct FrameGovernor
+{
+	bool   enabled;           // when false it only counts, and every frame is drawn in full
+	int    level;             // GovernorLevel
+	Uint32 simulation_cost;   // running averages, in microseconds
+	Uint32 render_cost;       // of the frames that were drawn
+	int    settle;            // frames left before the level can change again
+	int    calm_frames;       // frames in a row under GOVERNOR_LOW_WATER
+
+	// This frame //
+	bool   present;
+	bool   draw_hud;
+
+	// Counters //
+	Uint32 frames;
+	Uint32 presents;
+	Uint32 skipped_presents;
+	Uint32 skipped_huds;
+	Uint32 late_ticks;        // ticks that started more than a frame behind
+	Uint32 dropped_ticks;     // ticks given up when GOVERNOR_MAX_LAG behind
+	Uint32 degrades;
+	Uint32 recoveries;
+	Uint32 frames_at_level[NUM_GOVERNOR_LEVELS];
+	FrameTimeStats tick_times;   // simulation and drawing together
+};
+
+void ResetGovernor(FrameGovernor* governor, bool enabled);
+
+// Decides what to draw this tick. Returns whether to draw it at all. //
+bool StartGovernedFrame(FrameGovernor* governor);
+
+// Records what the tick cost, render being 0 if nothing was drawn, and how //
+// many milliseconds behind schedule it started, and picks the next level.  //
+void EndGovernedFrame(FrameGovernor* governor, Uint32 simulation, Uint32 render, int lag);
+
+// Prints the counters and tick times, if any ticks were governed //
+void PrintGovernorReport(FrameGovernor* governor);
@@ -0,0 +1,623 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    LevelGen.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+// A seeded level generator, and an estimator that scores how hard a level is //
+// by letting a computer controlled paddle play it many times without a window. //
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "LevelGen.h"
+#include "ParSolver.h"   // For SolveParTime()
+#include "Timing.h"      // For GetMicroseconds()
+
+// Hit count distributions the command line generator cycles through //
+#define NUM_WEIGHT_PRESETS 4
+static const int g_WeightPresets[NUM_WEIGHT_PRESETS][MAX_HITS + 1] =
+{
+	{ 2, 4, 2, 1, 1 },  // mostly easy blocks
+	{ 1, 2, 3, 2, 1 },  // even spread
+	{ 1, 1, 2, 3, 3 },  // mostly tough blocks
+	{ 4, 1, 1, 1, 1 },  // sparse
+};
+
+// Size of a packed layout in a bulk file, two cells per byte //
+#define BULK_LEVEL_BYTES ((NUM_ROWS * NUM_COLS + 1) / 2)
+
+Uint32 NextRandom(Uint32* seed)
+{
+	Uint32 x = *seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*seed = x;
+	return x;
+}
+
+// Sets a cell along with every cell the symmetry mirrors it onto //
+// Sets a cell and its mirror images, returning how many different cells //
+// that was, as the middle row or column is its own mirror image.        //
+static int SetCell(LevelCells* layout, int symmetry, int row, int col, int hits)
+{
+	int mirror_row = NUM_ROWS - 1 - row;
+	int mirror_col = NUM_COLS - 1 - col;
+	bool mirror_x  = (symmetry == SYMMETRY_MIRROR_X || symmetry == SYMMETRY_MIRROR_XY);
+	bool mirror_y  = (symmetry == SYMMETRY_MIRROR_Y || symmetry == SYMMETRY_MIRROR_XY);
+
+	layout->hits[row * NUM_COLS + col] = hits;
+	if (mirror_x)
+		layout->hits[row * NUM_COLS + mirror_col] = hits;
+	if (mirror_y)
+		layout->hits[mirror_row * NUM_COLS + col] = hits;
+	if (mirror_x && mirror_y)
+		layout->hits[mirror_row * NUM_COLS + mirror_col] = hits;
+
+	int num_x = (mirror_x && mirror_col != col) ? 2 : 1;
+	int num_y = (mirror_y && mirror_row != row) ? 2 : 1;
+	return num_x * num_y;
+}
+
+static int CountBlocks(const LevelCells* layout)
+{
+	int count = 0;
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		if (layout->hits[i] > 0)
+			count++;
+	}
+	return count;
+}
+
+void GenerateLevel(Uint32* seed, const LevelGenParams* params, LevelCells* layout)
+{
+	int symmetry = params->symmetry;
+
+	// Turn the weights into a running total so one random number picks the hit count //
+	int cumulative[MAX_HITS + 1];
+	int total = 0;
+	for (int hits=0; hits <= MAX_HITS; hits++)
+	{
+		if (params->hit_weights[hits] > 0)
+			total += params->hit_weights[hits];
+		cumulative[hits] = total;
+	}
+
+	// With mirroring we only need to pick the cells of one half (or quarter) //
+	int num_rows = NUM_ROWS;
+	int num_cols = NUM_COLS;
+	if (symmetry == SYMMETRY_MIRROR_X || symmetry == SYMMETRY_MIRROR_XY)
+		num_cols = (NUM_COLS + 1) / 2;
+	if (symmetry == SYMMETRY_MIRROR_Y || symmetry == SYMMETRY_MIRROR_XY)
+		num_rows = (NUM_ROWS + 1) / 2;
+
+	for (int row=0; row < num_rows; row++)
+	{
+		for (int col=0; col < num_cols; col++)
+		{
+			// Counting the totals the pick is past, rather than stopping at the //
+			// first one it isn't, has no branch to mispredict on random picks.  //
+			int hits = 0;
+			if (total > 0)
+			{
+				int pick = NextRandom(seed) % total;
+				for (int i=0; i < MAX_HITS; i++)
+					hits += (pick >= cumulative[i]);
+			}
+			SetCell(layout, symmetry, row, col, hits);
+		}
+	}
+
+	// Break up any run of empty cells that is longer than allowed //
+	if (params->max_gap > 0)
+	{
+		for (int row=0; row < NUM_ROWS; row++)
+		{
+			int gap = 0;
+			for (int col=0; col < NUM_COLS; col++)
+			{
+				// Worked out without a branch, as whether a cell is empty is random //
+				gap = (layout->hits[row * NUM_COLS + col] > 0) ? 0 : gap + 1;
+				if (gap > params->max_gap)
+				{
+					SetCell(layout, symmetry, row, col, 1);
+					gap = 0;
+				}
+			}
+		}
+	}
+
+	// Add single hit blocks until there are enough of them. The number of //
+	// tries is limited so impossible params can't hang the generator. An  //
+	// empty cell's mirror images are empty too, so they all count as new. //
+	int num_blocks = CountBlocks(layout);
+	for (int tries=0; num_blocks < params->min_blocks && tries < NUM_ROWS * NUM_COLS * 4; tries++)
+	{
+		int cell = NextRandom(seed) % (NUM_ROWS * NUM_COLS);
+		if (layout->hits[cell] == 0)
+		{
+			num_blocks += SetCell(layout, symmetry, cell / NUM_COLS, cell % NUM_COLS, 1);
+		}
+	}
+}
+
+void CellsToLayout(const LevelCells* cells, LevelLayout* layout)
+{
+	for (int cell=0; cell < NUM_ROWS * NUM_COLS; cell++)
+		layout->hits[cell] = cells->hits[cell];
+	layout->num_moves = 0;
+}
+
+// Writes a layout the same way the files in Data/ are laid out //
+bool WriteLevelFile(const char* file_name, const LevelLayout* layout)
+{
+	FILE* outFile = fopen(file_name, "w");
+
+	if (!outFile)
+		return false;
+
+	for (int row=0; row < NUM_ROWS; row++)
+	{
+		for (int col=0; col < NUM_COLS; col++)
+		{
+			fprintf(outFile, "%d ", layout->hits[row * NUM_COLS + col]);
+		}
+		fprintf(outFile, "\n");
+	}
+
+	for (int i=0; i < layout->num_moves; i++)
+	{
+		const MoverScript& move = layout->moves[i];
+		if (move.type == MOVER_SLIDE)
+			fprintf(outFile, "slide %d %d %d %d %d\n", move.row, move.x_range, move.y_range, move.period, move.phase);
+		else
+			fprintf(outFile, "orbit %d %d %d %d %d %d\n", move.row, move.col, move.x_range, move.y_range,
+			        move.period, move.phase);
+	}
+
+	fclose(outFile);
+
+	return true;
+}
+
+// Bulk files start with the magic, version, rows, columns and a little  //
+// endian 32 bit count. Each layout follows as BULK_LEVEL_BYTES bytes,   //
+// with the first cell of each pair in the low four bits. Only the cells //
+// are kept, so the levels read back stand still.                        //
+bool WriteBulkLevels(const char* file_name, const LevelCells* levels, int count)
+{
+	FILE* outFile = fopen(file_name, "wb");
+
+	if (!outFile)
+		return false;
+
+	unsigned char header[12];
+	memcpy(header, BULK_LEVEL_MAGIC, 4);
+	header[4]  = BULK_LEVEL_VERSION;
+	header[5]  = NUM_ROWS;
+	header[6]  = NUM_COLS;
+	header[7]  = 0;
+	header[8]  = (unsigned char)(count);
+	header[9]  = (unsigned char)(count >> 8);
+	header[10] = (unsigned char)(count >> 16);
+	header[11] = (unsigned char)(count >> 24);
+	fwrite(header, 1, sizeof(header), outFile);
+
+	for (int i=0; i < count; i++)
+	{
+		unsigned char packed[BULK_LEVEL_BYTES];
+		memset(packed, 0, sizeof(packed));
+
+		for (int cell=0; cell < NUM_ROWS * NUM_COLS; cell++)
+		{
+			packed[cell / 2] |= (levels[i].hits[cell] & 0xF) << ((cell & 1) * 4);
+		}
+
+		fwrite(packed, 1, sizeof(packed), outFile);
+	}
+
+	bool ok = (ferror(outFile) == 0);
+	fclose(outFile);
+
+	return ok;
+}
+
+// Reads a bulk file's header, leaving the file at the first layout. Returns //
+// the number of layouts, or -1 if the header is wrong or claims more layouts //
+// than the rest of the file holds.                                           //
+static int ReadBulkHeader(FILE* inFile)
+{
+	unsigned char header[12];
+	if ( fread(header, 1, sizeof(header), inFile) != sizeof(header) ||
+		 memcmp(header, BULK_LEVEL_MAGIC, 4) != 0 ||
+		 header[4] != BULK_LEVEL_VERSION || header[5] != NUM_ROWS || header[6] != NUM_COLS )
+		return -1;
+
+	Uint32 count = (Uint32)header[8] | ((Uint32)header[9] << 8) |
+	               ((Uint32)header[10] << 16) | ((Uint32)header[11] << 24);
+
+	// See how much is left without moving on from the header //
+	long start = ftell(inFile);
+	if ( start < 0 || fseek(inFile, 0, SEEK_END) != 0 )
+		return -1;
+	long end = ftell(inFile);
+	if ( end < start || fseek(inFile, start, SEEK_SET) != 0 )
+		return -1;
+
+	if ( count > (Uint32)((end - start) / BULK_LEVEL_BYTES) )
+		return -1;
+
+	return (int)count;
+}
+
+// Returns the number of layouts in a bulk file, or -1 if it can't be used //
+int CountBulkLevels(const char* file_name)
+{
+	FILE* inFile = fopen(file_name, "rb");
+
+	if (!inFile)
+		return -1;
+
+	int count = ReadBulkHeader(inFile);
+	fclose(inFile);
+
+	return count;
+}
+
+// Returns the number of layouts read, or -1 if the file can't be used //
+int ReadBulkLevels(const char* file_name, LevelCells* levels, int max_count)
+{
+	FILE* inFile = fopen(file_name, "rb");
+
+	if (!inFile)
+		return -1;
+
+	int count = ReadBulkHeader(inFile);
+	if (count < 0)
+	{
+		fclose(inFile);
+		return -1;
+	}
+
+	if (count > max_count)
+		count = max_count;
+
+	int num_read = 0;
+	for (; num_read < count; num_read++)
+	{
+		unsigned char packed[BULK_LEVEL_BYTES];
+		if ( fread(packed, 1, sizeof(packed), inFile) != sizeof(packed) )
+			break;
+
+		for (int cell=0; cell < NUM_ROWS * NUM_COLS; cell++)
+		{
+			levels[num_read].hits[cell] = (packed[cell / 2] >> ((cell & 1) * 4)) & 0xF;
+		}
+	}
+
+	fclose(inFile);
+
+	return num_read;
+}
+
+// A slice of the games handed to one estimator thread //
+struct EstimatorJob
+{
+	const LevelLayout* layout;
+	Uint32 seed;
+	int    first_game;
+	int    num_games;
+
+	int    num_cleared;
+	double cleared_ticks;
+	int    lives_lost;
+};
+
+// Plays one game with a paddle that chases the ball, aiming to hit it at a //
+// random spot on the paddle. Returns true if the level was cleared.        //
+static bool PlayGame(const LevelLayout* layout, Uint32 seed, int* ticks, int* lives_lost)
+{
+	GameState state;
+	InitGameState(&state, layout, 1, 1);
+
+	int aim = (int)(NextRandom(&seed) % (2 * ESTIMATOR_AIM_RANGE + 1)) - ESTIMATOR_AIM_RANGE;
+
+	// Where the ball was over the last few ticks. The AI only knows where it //
+	// was ESTIMATOR_REACTION ticks ago, like a player, so fast balls and     //
+	// sharp angles get past it and the results depend on the level.          //
+	int seen[ESTIMATOR_REACTION];
+	for (int i=0; i < ESTIMATOR_REACTION; i++)
+		seen[i] = state.ball.screen_location.x + state.ball.screen_location.w / 2;
+
+	*lives_lost = 0;
+
+	while (state.result == RESULT_PLAYING && state.ticks < ESTIMATOR_MAX_TICKS)
+	{
+		int input = INPUT_NONE;
+
+		if (state.ball.y_speed == 0)
+			input |= INPUT_LAUNCH;
+
+		int slot      = state.ticks % ESTIMATOR_REACTION;
+		int ball_seen = seen[slot];
+		seen[slot]    = state.ball.screen_location.x + state.ball.screen_location.w / 2;
+
+		// Move so the ball lands aim pixels from the center of the paddle //
+		int paddle_center = state.players[0].screen_location.x + state.players[0].screen_location.w / 2;
+		int target        = ball_seen - aim;
+		if (paddle_center < target - PLAYER_SPEED / 2)
+			input |= INPUT_RIGHT;
+		else if (paddle_center > target + PLAYER_SPEED / 2)
+			input |= INPUT_LEFT;
+
+		int old_y_speed = state.ball.y_speed;
+
+		StepSimulation(&state, input);
+
+		// Power-ups can give lives back, so count the balls that got past //
+		for (int i=0; i < state.num_events; i++)
+		{
+			if (state.events[i].type == EVENT_LIFE_LOST)
+				(*lives_lost)++;
+		}
+
+		// Pick a new spot each time the ball starts heading back up //
+		if (old_y_speed > 0 && state.ball.y_speed < 0)
+			aim = (int)(NextRandom(&seed) % (2 * ESTIMATOR_AIM_RANGE + 1)) - ESTIMATOR_AIM_RANGE;
+	}
+
+	*ticks = state.ticks;
+
+	return (state.result == RESULT_WON);
+}
+
+static int EstimatorThread(void* data)
+{
+	EstimatorJob* job = (EstimatorJob*)data;
+
+	for (int game = job->first_game; game < job->first_game + job->num_games; game++)
+	{
+		// Every game gets its own seed, so results don't depend on the thread count //
+		Uint32 seed = job->seed + (Uint32)game * 0x9E3779B9u;
+		if (seed == 0)
+			seed = 1;
+
+		int ticks, lives_lost;
+		if ( PlayGame(job->layout, seed, &ticks, &lives_lost) )
+		{
+			job->num_cleared++;
+			job->cleared_ticks += ticks;
+		}
+		job->lives_lost += lives_lost;
+	}
+
+	return 0;
+}
+
+void EstimateDifficulty(const LevelLayout* layout, int num_games, Uint32 seed,
+                        DifficultyEstimate* estimate)
+{
+	EstimatorJob jobs[NUM_WORKER_THREADS];
+	SDL_Thread*  threads[NUM_WORKER_THREADS];
+
+	// Every game shares the collision masks, so they're loaded before the threads start //
+	LoadCollisionMasks();
+
+	// Split the games as evenly as possible between the threads //
+	for (int i=0; i < NUM_WORKER_THREADS; i++)
+	{
+		jobs[i].layout        = layout;
+		jobs[i].seed          = seed;
+		jobs[i].first_game    = num_games * i / NUM_WORKER_THREADS;
+		jobs[i].num_games     = num_games * (i + 1) / NUM_WORKER_THREADS - jobs[i].first_game;
+		jobs[i].num_cleared   = 0;
+		jobs[i].cleared_ticks = 0;
+		jobs[i].lives_lost    = 0;
+
+		threads[i] = SDL_CreateThread(EstimatorThread, &jobs[i]);
+
+		// If we couldn't get a thread, just do the work here //
+		if (!threads[i])
+			EstimatorThread(&jobs[i]);
+	}
+
+	int    num_cleared   = 0;
+	double cleared_ticks = 0;
+	int    lives_lost    = 0;
+
+	for (int i=0; i < NUM_WORKER_THREADS; i++)
+	{
+		if (threads[i])
+			SDL_WaitThread(threads[i], NULL);
+
+		num_cleared   += jobs[i].num_cleared;
+		cleared_ticks += jobs[i].cleared_ticks;
+		lives_lost    += jobs[i].lives_lost;
+	}
+
+	estimate->num_games      = num_games;
+	estimate->clear_rate     = num_games   > 0 ? (float)num_cleared / num_games : 0.0f;
+	estimate->avg_ticks      = num_cleared > 0 ? (float)(cleared_ticks / num_cleared) : 0.0f;
+	estimate->avg_lives_lost = num_games   > 0 ? (float)lives_lost / num_games : 0.0f;
+}
+
+static void PrintEstimate(int index, const DifficultyEstimate* estimate)
+{
+	printf("level %d: cleared %.0f%%, %.0f ticks to clear, %.2f lives lost\n", index,
+	       estimate->clear_rate * 100.0f, estimate->avg_ticks, estimate->avg_lives_lost);
+}
+
+static int PrintUsage()
+{
+	printf("usage:\n");
+	printf("  -genlevels <seed> <count> <bulk file> [games]  generate levels, optionally estimating each\n");
+	printf("  -exportlevel <bulk file> <index> <text file>   write one level in the Data/ text format\n");
+	printf("  -estimate <text file> [games]                  estimate the difficulty of a level file\n");
+	printf("  -par [max nodes] [text files...]               find the fastest clear of each level; unless the\n");
+	printf("                                                 search finishes, the par is only an upper bound\n");
+	return 1;
+}
+
+int RunLevelTool(int argc, char** argv)
+{
+	int exit_code = 0;
+
+	// We only need the timer and threads, not a window //
+	SDL_Init(SDL_INIT_TIMER);
+
+	if (strcmp(argv[1], "-genlevels") == 0 && argc >= 5)
+	{
+		Uint32 seed = (Uint32)strtoul(argv[2], NULL, 0);
+		int count   = atoi(argv[3]);
+		int games   = (argc > 5) ? atoi(argv[5]) : 0;
+
+		if (seed == 0)
+			seed = 1;
+		if (count < 1)
+			count = 1;
+
+		LevelCells* levels = new LevelCells[count];
+
+		// Cycle through every symmetry and hit count distribution //
+		Uint64 start = GetMicroseconds();
+		for (int i=0; i < count; i++)
+		{
+			LevelGenParams params;
+			params.symmetry   = i % NUM_SYMMETRIES;
+			memcpy(params.hit_weights, g_WeightPresets[(i / NUM_SYMMETRIES) % NUM_WEIGHT_PRESETS],
+			       sizeof(params.hit_weights));
+			params.min_blocks = NUM_COLS;
+			params.max_gap    = NUM_COLS / 3;
+
+			GenerateLevel(&seed, &params, &levels[i]);
+		}
+		Uint64 generated = GetMicroseconds();
+
+		// Writing is timed on its own, it's the disk as much as us //
+		if ( !WriteBulkLevels(argv[4], levels, count) )
+		{
+			printf("couldn't write %s\n", argv[4]);
+			exit_code = 1;
+		}
+		Uint64 written = GetMicroseconds();
+
+		printf("generated %d levels in %.1f ms", count, (generated - start) / 1000.0);
+		if (generated > start)
+			printf(" (%.0f levels per second)", count * 1000000.0 / (generated - start));
+		printf(", wrote them in %.1f ms\n", (written - generated) / 1000.0);
+
+		LevelLayout layout;
+		for (int i=0; i < count && games > 0; i++)
+		{
+			DifficultyEstimate estimate;
+			CellsToLayout(&levels[i], &layout);
+			EstimateDifficulty(&layout, games, seed + i, &estimate);
+			PrintEstimate(i, &estimate);
+		}
+
+		delete [] levels;
+	}
+	else if (strcmp(argv[1], "-exportlevel") == 0 && argc >= 5)
+	{
+		int index = atoi(argv[3]);
+		int count = CountBulkLevels(argv[2]);
+
+		// Check the level is there before making room for everything up to it //
+		if (count < 0)
+		{
+			printf("couldn't read %s\n", argv[2]);
+			exit_code = 1;
+		}
+		else if (index < 0 || index >= count)
+		{
+			printf("%s has levels 0 to %d, not %d\n", argv[2], count - 1, index);
+			exit_code = 1;
+		}
+		else
+		{
+			LevelCells* levels = new LevelCells[index + 1];
+			LevelLayout layout;
+
+			if ( ReadBulkLevels(argv[2], levels, index + 1) != index + 1 )
+			{
+				printf("couldn't read level %d from %s\n", index, argv[2]);
+				exit_code = 1;
+			}
+			else
+			{
+				CellsToLayout(&levels[index], &layout);
+				if ( !WriteLevelFile(argv[4], &layout) )
+				{
+					printf("couldn't write %s\n", argv[4]);
+					exit_code = 1;
+				}
+			}
+
+			delete [] levels;
+		}
+	}
+	else if (strcmp(argv[1], "-estimate") == 0 && argc >= 3)
+	{
+		int games = (argc > 3) ? atoi(argv[3]) : 100;
+		LevelLayout layout;
+
+		if ( !LoadLevelFile(argv[2], &layout) )
+		{
+			printf("couldn't read %s\n", argv[2]);
+			exit_code = 1;
+		}
+		else
+		{
+			DifficultyEstimate estimate;
+			EstimateDifficulty(&layout, games, 1, &estimate);
+			PrintEstimate(0, &estimate);
+		}
+	}
+	else if (strcmp(argv[1], "-par") == 0)
+	{
+		int max_nodes = (argc > 2) ? atoi(argv[2]) : 0;
+		if (max_nodes < 1)
+			max_nodes = SOLVER_MAX_NODES;
+
+		// The game's own levels unless we're given some //
+		char level_name[32];
+		int  num_files = (argc > 3) ? argc - 3 : NUM_LEVELS;
+
+		ParSolution* solution = new ParSolution;
+		for (int i=0; i < num_files; i++)
+		{
+			const char* file_name = level_name;
+			if (argc > 3)
+				file_name = argv[3 + i];
+			else
+				sprintf(level_name, LEVEL_FILE_NAME, i + 1);
+
+			LevelLayout layout;
+			if ( !LoadLevelFile(file_name, &layout) )
+			{
+				printf("couldn't read %s\n", file_name);
+				exit_code = 1;
+				continue;
+			}
+
+			SolveParTime(&layout, max_nodes, solution);
+			PrintParSolution(file_name, solution);
+
+			if ( solution->ticks > 0 && !CheckParSolution(&layout, solution) )
+			{
+				printf("%s: the inputs don't play back to the same clear\n", file_name);
+				exit_code = 1;
+			}
+		}
+		delete solution;
+	}
+	else
+	{
+		exit_code = PrintUsage();
+	}
+
+	SDL_Quit();
+
+	return exit_code;
+}
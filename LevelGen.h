@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////////////
+// LevelGen.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Simulation.h" // For LevelLayout
+
+// Controls what kind of layouts GenerateLevel() produces //
+struct LevelGenParams
+{
+	int symmetry;                   // LevelSymmetry
+	int hit_weights[MAX_HITS + 1];  // relative chance of a cell getting 0-4 hits
+	int min_blocks;                 // fewest blocks a layout may have
+	int max_gap;                    // longest run of empty cells allowed in a row
+};
+
+// Only the hit counts of a layout, which is all the generator makes and all //
+// bulk files keep. A LevelLayout carries a script too and is many times     //
+// the size, which matters when making millions of them.                    //
+struct LevelCells
+{
+	Uint8 hits[NUM_ROWS * NUM_COLS];
+};
+
+// Results of playing a layout many times with a computer controlled paddle //
+struct DifficultyEstimate
+{
+	int   num_games;
+	float clear_rate;      // fraction of games where the level was cleared
+	float avg_ticks;       // average ticks to clear, over the cleared games
+	float avg_lives_lost;  // average lives lost, over all games
+};
+
+// Returns the next number from a xorshift generator and advances the seed. //
+// The seed must never be zero.                                             //
+Uint32 NextRandom(Uint32* seed);
+
+// Fills in a layout. The same seed and params always give the same layout. //
+void GenerateLevel(Uint32* seed, const LevelGenParams* params, LevelCells* cells);
+
+// Makes a layout from the cells, one with no script, so it stands still //
+void CellsToLayout(const LevelCells* cells, LevelLayout* layout);
+
+// Level files: the "Data/levelN.txt" text format, and a packed bulk format //
+// holding many layouts at two cells per byte.                              //
+bool WriteLevelFile(const char* file_name, const LevelLayout* layout);
+bool WriteBulkLevels(const char* file_name, const LevelCells* levels, int count);
+int  ReadBulkLevels(const char* file_name, LevelCells* levels, int max_count);
+int  CountBulkLevels(const char* file_name);
+
+// Plays num_games headless games of the layout spread over NUM_WORKER_THREADS //
+void EstimateDifficulty(const LevelLayout* layout, int num_games, Uint32 seed,
+                        DifficultyEstimate* estimate);
+
+// Command line entry point for the tools above. Returns the exit code. //
+int RunLevelTool(int argc, char** argv);
@@ -12,6 +12,22 @@
 #include "SDL/SDL.h"     // Main SDL header 
 #include "SDL/SDL_TTF.h" // True Type Font header
 #include "Defines.h" // Our defines header
+#include "Simulation.h" // The game logic
+#include "LevelGen.h"   // Level generator tools
+#include "AllocTracker.h" // Allocation counting (with ALLOC_TRACKING)
+#include "FrameBench.h"   // Framebuffer hashes and frame time stats
+#include "Timing.h"       // Microsecond timer
+#include "Rollback.h"     // Versus mode over the network
+#include "FrameCapture.h" // Recording frames to disk
+#include "Particles.h"    // Debris and sparks
+#include "Viewport.h"     // Scaling the game to the window
+#include "Renderer.h"     // Drawing frames in tiles on several threads
+#include "Collision.h"    // Sprite masks for pixel-accurate collisions
+#include "FrameGovernor.h" // Drawing less when frames run long
+#include "Palette.h"      // The colors of 8-bit frames
+#include "Movers.h"       // Blocks moved by level scripts
+#include "Startup.h"      // Loading in parallel and timing startup
+#include "Counters.h"     // Live counters for collectors
 
 using namespace std;   
 
@@ -22,32 +38,22 @@ struct StateStruct
 	void (*StatePointer)();
 };
 
-// The block just stores it's location and the amount of times it can be hit (health) //
-struct Block
+// A font we've opened, kept open until the game shuts down //
+struct FontCacheEntry
 {
-	SDL_Rect screen_location;  // location on screen
-	SDL_Rect bitmap_location;  // location of image in bitmap 
-
-	int num_hits;   // health
-};
-
-// The paddle only moves horizontally so there's no need for a y_speed variable //
-struct Paddle
-{
-	SDL_Rect screen_location;  // location on screen
-	SDL_Rect bitmap_location;  // location of image in bitmap 
-
-	int x_speed;
+	int       size;
+	TTF_Font* font;
 };
 
-// The ball moves in any direction so we need to have two speed variables //
-struct Ball
+// A piece of text we've rendered, reused until something else needs the slot //
+struct TextCacheEntry
 {
-	SDL_Rect screen_location;  // location on screen
-	SDL_Rect bitmap_location;  // location of image in bitmap 
-
-	int x_speed;
-	int y_speed; 
+	char         text[MAX_TEXT_LENGTH];
+	int          size;
+	SDL_Color    foreground;
+	SDL_Color    background;
+	SDL_Surface* surface;
+	int          last_used;
 };
 
 #define MAX_STACK_SIZE     16
@@ -80,14 +86,42 @@ class StateStack {
 StateStack		   g_StateStack;		 // Our state stack
 SDL_Surface*       g_Bitmap = NULL;		 // Our background image
 SDL_Surface*       g_Window = NULL;		 // Our backbuffer
+SDL_Surface*       g_Frame = NULL;       // What frames are drawn on: g_Window, or an 8-bit buffer
+bool               g_Indexed = false;    // Draw frames in 8 bits (-indexed)
 SDL_Event		   g_Event;				 // An SDL event structure for input
 int				   g_Timer;				 // Our timer is just an integer
-Paddle             g_Player;			 // The player's paddle
-Ball               g_Ball;				 // The game ball
-int				   g_Lives;				 // Player's lives
-int				   g_Level = 1;			 // Current level
-int                g_NumBlocks = 0;      // Keep track of number of blocks
-Block              g_Blocks[MAX_BLOCKS]; // The blocks we're breaking
+GameState          g_GameState;			 // Paddle, ball, blocks, lives and level
+LevelLayout        g_Levels[NUM_LEVELS]; // The levels read in from our data files
+FontCacheEntry     g_Fonts[FONT_CACHE_SIZE];      // Fonts opened by DisplayText
+TextCacheEntry     g_TextCache[TEXT_CACHE_SIZE];  // Text rendered by DisplayText
+int                g_TextCacheClock = 0;          // For finding the least recently used text
+FramePhaseTimes    g_FrameTimes;                  // How long the parts of the last game frame took
+RollbackSession    g_Versus;                      // The game and connection in versus mode
+bool               g_VersusActive = false;        // g_Versus has a socket open
+Uint32             g_VersusEnded = 0;             // when the versus game's end was confirmed
+FrameCapture       g_Capture;                     // Frames being recorded to disk
+bool               g_Capturing = false;           // g_Capture has a writer running
+ParticlePool       g_Particles;                   // Debris and sparks from blocks being hit
+Viewport           g_Viewport;                    // Where the game goes in the window
+SpriteCache        g_Sprites;                     // Our bitmap's sprites scaled to g_Viewport
+Uint32             g_VideoFlags = SDL_ANYFORMAT | SDL_RESIZABLE; // For SDL_SetVideoMode
+DrawList           g_DrawList;                    // Everything drawn this frame, until PresentFrame()
+RenderPool         g_Renderer;                    // Threads that draw g_DrawList
+FrameGovernor      g_Governor;                    // Decides how much of each game frame to draw
+bool               g_FastForward = false;         // Run ahead while the ball is stuck above the blocks (-fastforward)
+bool               g_FastForwarding = false;      // This frame ran ahead
+Uint32             g_FastForwardTicks = 0;        // Ticks run ahead, and the frames they took
+Uint32             g_FastForwardFrames = 0;
+StartupTimeline    g_Startup;                     // What the last Init() took, up to the first frame
+#ifdef ALLOC_TRACKING
+bool               g_ParallelStartup = false;     // The allocation tracker only counts one thread
+#else
+bool               g_ParallelStartup = true;      // Load files on threads while the window opens
+#endif
+CounterServer      g_CounterServer;               // Answers collectors with our counters
+const char*        g_CounterPath = NULL;          // The socket it's on (-counters), if any
+int                g_FrameTextRenders = 0;        // Text SDL_ttf rendered for this frame
+Uint32             g_FramesPresented = 0;         // Frames PresentFrame() has put on the screen
 
 // Functions to handle the states of the game //
 void Menu();
@@ -95,40 +129,205 @@ void Game();
 void Exit();
 void GameWon();
 void GameLost();
+void VersusGame();
+void VersusOver();
 
 // Helper functions for the main game state functions //
 void ClearScreen();
+void PresentFrame();
+void DrawGameState(const GameState* state);
+void DrawSprite(const SDL_Rect& bitmap_location, const SDL_Rect& screen_location);
+void SpawnBlockEffects(const GameState* state);
+void CountLiveTick(const GameState* state);
+void FastForward(int input);
+void UpdateAndDrawParticles();
+Uint32 GetBitmapColor(int x, int y);
 void DisplayText(const char* text, int x, int y, int size, int fR, int fG, int fB, int bR, int bG, int bB);
+TTF_Font* GetFont(int size);
+SDL_Surface* GetTextSurface(const char* text, int size, SDL_Color foreground, SDL_Color background);
+void FreeTextCaches();
 void HandleMenuInput();
-void HandleGameInput();
+int  HandleGameInput();
 void HandleExitInput();
 void HandleWinLoseInput();
 
-// Since there's only one paddle, we no longer need to pass the player's paddle //
-// to CheckBallCollisions. The function will just assume that's what we mean.   //
-bool CheckBallCollisions();
-void CheckBlockCollisions();
-void HandleBlockCollision(int index);
-bool CheckPointInRect(int x, int y, SDL_Rect rect);
-void HandleBall();
-void MoveBall();
 void HandleLoss();
 void HandleWin();
-void ChangeLevel();
+void HandleVersusOver();
 
 // Init and Shutdown functions //
 void Init();
-void InitBlocks();
+int  LoadBitmapJob(void* data);
+int  LoadFontJob(void* data);
+int  LoadLevelsJob(void* data);
+void LoadLevels();
+bool StartVersus(int argc, char **argv);
+bool StartCapturing(const char* format, const char* directory);
+void CapturePresentedFrame();
+void ResizeWindow(int width, int height);
+void CreateFrameBuffer();
+void FreeFrameBuffer();
 void Shutdown();
 
+// Headless test and benchmark modes, run from the command line //
+void StartHeadlessGame(int level);
+void PushKey(SDLKey key, bool down);
+int  RunAllocTest();
+int  RunFrameBench(bool record);
+int  RunParticleBench();
+int  RunScaleBench();
+int  RunTileBench();
+int  RunGovernorBench();
+int  RunIndexedBench();
+int  RunWarpBench();
+int  RunStartupTest();
+const char* StateName(void (*state)());
+
 int main(int argc, char **argv)
 {
+	SetViewport(&g_Viewport, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+	// These can come before any of the options below, in any order: //
+	// -resolution <width>x<height> [fullscreen] sizes the window,    //
+	// -indexed draws frames in 256 colors, -counters <socket path>   //
+	// serves our counters there while we play, and -fastforward      //
+	// skips ahead while the ball is stuck above the blocks.          //
+	for (;;)
+	{
+		int used = 0;
+
+		if (argc > 1 && strcmp(argv[1], "-resolution") == 0)
+		{
+			int width = 0, height = 0;
+			if ( argc < 3 || sscanf(argv[2], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0 )
+			{
+				printf("usage: -resolution <width>x<height> [fullscreen] [other options]\n");
+				return 1;
+			}
+			SetViewport(&g_Viewport, width, height);
+
+			used = 2;
+			if (argc > 3 && strcmp(argv[3], "fullscreen") == 0)
+			{
+				g_VideoFlags |= SDL_FULLSCREEN;
+				used = 3;
+			}
+		}
+		else if (argc > 1 && strcmp(argv[1], "-indexed") == 0)
+		{
+			g_Indexed = true;
+			used = 1;
+		}
+		else if (argc > 1 && strcmp(argv[1], "-fastforward") == 0)
+		{
+			g_FastForward = true;
+			used = 1;
+		}
+		else if (argc > 1 && strcmp(argv[1], "-counters") == 0)
+		{
+			if (argc < 3)
+			{
+				printf("usage: -counters <socket path> [other options]\n");
+				return 1;
+			}
+			g_CounterPath = argv[2];
+			used = 2;
+		}
+
+		if (used == 0)
+			break;
+
+		// Carry on as if the options we used weren't there //
+		argc -= used;
+		argv += used;
+	}
+
+	if (argc > 1 && strcmp(argv[1], "-alloctest") == 0)
+		return RunAllocTest();
+	if (argc > 1 && strcmp(argv[1], "-framebench") == 0)
+	{
+		// -framebench capture <raw|png> <directory> times the frames while recording them //
+		if ( argc > 4 && strcmp(argv[2], "capture") == 0 && !StartCapturing(argv[3], argv[4]) )
+			return 1;
+		return RunFrameBench(argc > 2 && strcmp(argv[2], "record") == 0);
+	}
+
+	if (argc > 1 && strcmp(argv[1], "-entitybench") == 0)
+		return RunEntityBench();
+	if (argc > 1 && strcmp(argv[1], "-particlebench") == 0)
+		return RunParticleBench();
+	if (argc > 1 && strcmp(argv[1], "-scalebench") == 0)
+		return RunScaleBench();
+	if (argc > 1 && strcmp(argv[1], "-tilebench") == 0)
+		return RunTileBench();
+	if (argc > 1 && strcmp(argv[1], "-governorbench") == 0)
+		return RunGovernorBench();
+	if (argc > 1 && strcmp(argv[1], "-indexedbench") == 0)
+		return RunIndexedBench();
+	if (argc > 1 && strcmp(argv[1], "-warpbench") == 0)
+		return RunWarpBench();
+	if (argc > 1 && strcmp(argv[1], "-collisionbench") == 0)
+		return RunCollisionBench();
+	if (argc > 1 && strcmp(argv[1], "-moverbench") == 0)
+		return RunMoverBench();
+	if (argc > 1 && strcmp(argv[1], "-startuptest") == 0)
+		return RunStartupTest();
+	if (argc > 1 && strcmp(argv[1], "-counterbench") == 0)
+		return RunCounterBench();
+	if (argc > 1 && strcmp(argv[1], "-nettest") == 0)
+	{
+		LoadLevels();
+		return RunNetTest(g_Levels, NUM_LEVELS, argc > 2 ? atoi(argv[2]) : 0,
+		                  argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoi(argv[4]) : 0);
+	}
+
+	bool versus  = (argc > 1 && strcmp(argv[1], "-versus") == 0);
+	bool capture = (argc > 1 && strcmp(argv[1], "-capture") == 0);
+
+	// Other command line arguments run one of the level tools instead of the game //
+	if (argc > 1 && !versus && !capture)
+		return RunLevelTool(argc, argv);
+
+	// -capture <raw|png> <directory> records everything we show //
+	if ( capture && (argc < 4 || !StartCapturing(argv[2], argv[3])) )
+	{
+		printf("usage: -capture <raw|png> <directory>\n");
+		return 1;
+	}
+
 	Init();
+
+	if ( versus && !StartVersus(argc, argv) )
+	{
+		Shutdown();
+		return 1;
+	}
 	
 	// Our game loop is just a while loop that breaks when our state stack is empty. //
 	while (!g_StateStack.empty())
 	{
-		g_StateStack.top().StatePointer();		
+		void (*state)() = g_StateStack.top().StatePointer;
+		int    last_frame   = g_Timer;
+		Uint32 last_present = g_FramesPresented;
+
+		state();		
+
+		// The governor can skip drawing a frame, and then there's nothing new to keep //
+		if (g_FramesPresented != last_present)
+			CapturePresentedFrame();
+
+		// The state resets g_Timer each time it finishes a frame //
+		if (g_Timer != last_frame)
+			AllocFrameEnd(StateName(state));
+	}
+
+	PrintAllocReport();
+	PrintStartupTimeline(&g_Startup);
+	PrintGovernorReport(&g_Governor);
+	if (g_FastForwardFrames > 0)
+	{
+		printf("fast forward: %u ticks in %u frames, %.1fx real time\n", g_FastForwardTicks,
+		       g_FastForwardFrames, (double)g_FastForwardTicks / g_FastForwardFrames);
 	}
 
 	Shutdown();
@@ -140,56 +339,47 @@ int main(int argc, char **argv)
 // This function initializes our game. //
 void Init()
 {
-	// Initiliaze SDL video and our timer. //
-	SDL_Init( SDL_INIT_VIDEO | SDL_INIT_TIMER);
+	StartTimeline(&g_Startup);
+
+	// Initiliaze our timer first, before any threads are made. //
+	SDL_Init(SDL_INIT_TIMER);
+
+	// Loading files doesn't need the window, so it happens on other threads //
+	// while SDL opens it. None of them touch anything the others do.        //
+	StartupJob bitmap_job, font_job, levels_job;
+	StartStartupJob(&bitmap_job, &g_Startup, "bitmap", LoadBitmapJob, NULL, g_ParallelStartup);
+	StartStartupJob(&font_job,   &g_Startup, "font",   LoadFontJob,   NULL, g_ParallelStartup);
+	StartStartupJob(&levels_job, &g_Startup, "levels", LoadLevelsJob, NULL, g_ParallelStartup);
+
+	int stage = BeginStartupStage(&g_Startup, "video", "main");
+	// Initiliaze SDL video. //
+	SDL_InitSubSystem(SDL_INIT_VIDEO);
 	// Setup our window's dimensions, bits-per-pixel (0 tells SDL to choose for us), //
 	// and video format (SDL_ANYFORMAT leaves the decision to SDL). This function    //
 	// returns a pointer to our window which we assign to g_Window.                  //
-	g_Window = SDL_SetVideoMode(WINDOW_WIDTH, WINDOW_HEIGHT, 0, SDL_ANYFORMAT);    
+	g_Window = SDL_SetVideoMode(g_Viewport.width, g_Viewport.height, 0, g_VideoFlags);    
+	// Frames are queued up in g_DrawList and drawn by the render threads. //
+	CreateFrameBuffer();
+	StartRenderPool(&g_Renderer, RENDER_THREADS);
+	ResetGovernor(&g_Governor, true);
 	// Set the title of our window. //
 	SDL_WM_SetCaption(WINDOW_CAPTION, 0);
-	// Get the number of ticks since SDL was initialized. //
-	g_Timer = SDL_GetTicks();
+	EndStartupStage(&g_Startup, stage);
 
-	// Initialize the player's data //
-	// screen locations
-	g_Player.screen_location.x = (WINDOW_WIDTH / 2) - (PADDLE_WIDTH / 2);   // center screen
-	g_Player.screen_location.y = PLAYER_Y;
-	g_Player.screen_location.w = PADDLE_WIDTH;
-	g_Player.screen_location.h = PADDLE_HEIGHT;
-	// image location 
-	g_Player.bitmap_location.x = PADDLE_BITMAP_X;
-	g_Player.bitmap_location.y = PADDLE_BITMAP_Y;
-	g_Player.bitmap_location.w = PADDLE_WIDTH;
-	g_Player.bitmap_location.h = PADDLE_HEIGHT;
-	// player speed
-	g_Player.x_speed   = PLAYER_SPEED;
-	// lives 
-	g_Lives = NUM_LIVES;
-
-	// Initialize the ball's data //
-	// screen location
-	g_Ball.screen_location.x = (WINDOW_WIDTH / 2) - (BALL_DIAMETER / 2);   // center screen
-	g_Ball.screen_location.y = (WINDOW_HEIGHT / 2) - (BALL_DIAMETER / 2);  // center screen
-	g_Ball.screen_location.w = BALL_DIAMETER;
-	g_Ball.screen_location.h = BALL_DIAMETER;
-	// image location
-	g_Ball.bitmap_location.x = BALL_BITMAP_X;
-	g_Ball.bitmap_location.y = BALL_BITMAP_Y;
-	g_Ball.bitmap_location.w = BALL_DIAMETER;
-	g_Ball.bitmap_location.h = BALL_DIAMETER;	
-	// speeds 	
-	g_Ball.x_speed = 0;
-	g_Ball.y_speed = 0;	
-
-	// We'll need to initialize our blocks for each level, so we have a separate function handle it //
-	InitBlocks();	
+	stage = BeginStartupStage(&g_Startup, "waiting", "main");
+	FinishStartupJob(&bitmap_job);
+	FinishStartupJob(&font_job);
+	FinishStartupJob(&levels_job);
+	EndStartupStage(&g_Startup, stage);
 
-	// Fill our bitmap structure with information. //
-	g_Bitmap = SDL_LoadBMP("data/BlockBreaker.bmp");	
+	stage = BeginStartupStage(&g_Startup, "game", "main");
 
-	// Set our transparent color (magenta) //
-	SDL_SetColorKey( g_Bitmap, SDL_SRCCOLORKEY, SDL_MapRGB(g_Bitmap->format, 255, 0, 255) );
+	// Set up the paddle, ball, lives and the blocks for the first level //
+	InitGameState(&g_GameState, g_Levels, NUM_LEVELS, 1);
+	ClearParticles(&g_Particles, SDL_GetTicks());
+
+	// Scale the sprites to the window once, so drawing them is a plain copy //
+	BuildSpriteCache(&g_Sprites, g_Bitmap, &g_Viewport, g_Frame->format);
 
 	// We start by adding a pointer to our exit state, this way //
 	// it will be the last thing the player sees of the game.   //
@@ -202,92 +392,1056 @@ void Init()
 	state.StatePointer = Menu;
 	g_StateStack.push(state);
 
+	EndStartupStage(&g_Startup, stage);
+
+	// Collectors can read our counters from here on //
+	if (g_CounterPath)
+		StartCounterServer(&g_CounterServer, g_CounterPath);
+
+	// Get the number of ticks since SDL was initialized, as if a frame just //
+	// went by, so the menu is drawn straight away.                          //
+	g_Timer = SDL_GetTicks() - (FRAME_RATE);
+}
+
+// This function loads our bitmap and works out the shapes of its sprites. //
+int LoadBitmapJob(void*)
+{
+	// Fill our bitmap structure with information. //
+	g_Bitmap = SDL_LoadBMP("data/BlockBreaker.bmp");	
+
+	// Set our transparent color (magenta) //
+	if (g_Bitmap)
+		SDL_SetColorKey( g_Bitmap, SDL_SRCCOLORKEY, SDL_MapRGB(g_Bitmap->format, 255, 0, 255) );
+
+	// The ball's collisions go by the same pixels we draw //
+	InitCollisionMasks(g_Bitmap);
+
+	return g_Bitmap != NULL;
+}
+
+// This function starts the true type font library and opens our font, so //
+// the first frame with text on it doesn't have to wait for it.           //
+int LoadFontJob(void*)
+{
 	// Initialize the true type font library. //
 	TTF_Init();
+
+	// Text grows with the window, so open the size DisplayText() will ask for //
+	int size = ScaleSize(&g_Viewport, PRELOAD_FONT_SIZE);
+	if (size < 1)
+		size = 1;
+
+	return GetFont(size) != NULL;
+}
+
+// This function reads in all of our levels once, so changing levels never touches the disk //
+int LoadLevelsJob(void*)
+{
+	int subsystem = SetAllocSubsystem(ALLOC_LEVELS);
+	LoadLevels();
+	SetAllocSubsystem(subsystem);
+
+	return 1;
+}
+
+// Gives the allocation tracker a name to file each state's frames under //
+const char* StateName(void (*state)())
+{
+	if (state == Menu)     return "menu";
+	if (state == Game)     return "game";
+	if (state == Exit)     return "exit";
+	if (state == GameWon)  return "won";
+	if (state == GameLost) return "lost";
+	if (state == VersusGame) return "versus";
+	if (state == VersusOver) return "versus over";
+	return "unknown";
+}
+
+// This function starts the game state on the given level using SDL's dummy //
+// video driver, so it can run without a display. //
+void StartHeadlessGame(int level)
+{
+	if (!g_Window)
+	{
+		SDL_putenv((char*)"SDL_VIDEODRIVER=dummy");
+		Init();
+	}
+
+	// Skip the menu and go straight into the game //
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+
+	StateStruct state;
+	state.StatePointer = Game;
+	g_StateStack.push(state);
+
+	InitGameState(&g_GameState, g_Levels, NUM_LEVELS, 1);
+	g_GameState.level = level;
+	InitBlocks(&g_GameState);
+
+	// Runs should look the same every time, so every frame is drawn in full //
+	// and every tick gets its own frame //
+	ClearParticles(&g_Particles, 1);
+	ResetGovernor(&g_Governor, false);
+	g_FastForward = false;
+}
+
+// This function queues up a key press or release as if the player made it //
+void PushKey(SDLKey key, bool down)
+{
+	SDL_Event event;
+	memset(&event, 0, sizeof(event));
+	event.type = down ? SDL_KEYDOWN : SDL_KEYUP;
+	event.key.keysym.sym = key;
+	SDL_PushEvent(&event);
+}
+
+// This function runs the game state without a window and fails if any frame //
+// after the first ALLOC_WARMUP_FRAMES allocates memory. //
+int RunAllocTest()
+{
+#ifdef ALLOC_TRACKING
+	StartHeadlessGame(1);
+
+	// Launch the ball so the simulation has something to do //
+	PushKey(SDLK_SPACE, true);
+
+	// Don't count what Init() allocated against the first frame //
+	AllocFrameEnd("init");
+
+	int failed_frames = 0;
+	int frame = 0;
+
+	for (; frame < ALLOC_WARMUP_FRAMES + ALLOC_TEST_FRAMES; frame++)
+	{
+		// The test stops if the game ends //
+		if (g_StateStack.empty() || g_StateStack.top().StatePointer != Game)
+			break;
+
+		// Pretend a frame's worth of time has passed //
+		g_Timer = SDL_GetTicks() - FRAME_RATE;
+
+		Game();
+
+		int allocs = AllocFrameEnd("game");
+		if (frame >= ALLOC_WARMUP_FRAMES && allocs > 0)
+		{
+			printf("frame %d: %d allocations\n", frame, allocs);
+			failed_frames++;
+		}
+	}
+
+	PrintAllocReport();
+
+	// Shutdown() only wants the exit state left over //
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	printf("%s: %d of %d frames allocated after warm-up\n", failed_frames ? "FAILED" : "PASSED",
+	       failed_frames, frame > ALLOC_WARMUP_FRAMES ? frame - ALLOC_WARMUP_FRAMES : 0);
+
+	return failed_frames ? 1 : 0;
+#else
+	printf("-alloctest needs ALLOC_TRACKING defined in Defines.h\n");
+	return 1;
+#endif
+}
+
+// The keys pressed during each benchmark run. The script repeats every //
+// BENCH_SCRIPT_LENGTH frames, and at most one key changes per frame    //
+// since HandleGameInput() only looks at one event a frame.             //
+struct ScriptedKey
+{
+	int    frame;
+	SDLKey key;
+	bool   down;
+};
+
+#define BENCH_SCRIPT_LENGTH 120
+static const ScriptedKey g_BenchScript[] =
+{
+	{   0, SDLK_SPACE, true  },
+	{   1, SDLK_SPACE, false },
+	{  10, SDLK_LEFT,  true  },
+	{  30, SDLK_LEFT,  false },
+	{  40, SDLK_RIGHT, true  },
+	{  80, SDLK_RIGHT, false },
+	{  90, SDLK_LEFT,  true  },
+	{ 110, SDLK_LEFT,  false },
+};
+
+// Lets go of any key the last run left held down. The releases are handed //
+// to HandleGameInput() straight away, so the script starts on frame 0.    //
+static void ReleaseBenchKeys()
+{
+	while ( SDL_PollEvent(&g_Event) )
+		;
+
+	PushKey(SDLK_LEFT, false);
+	PushKey(SDLK_RIGHT, false);
+	HandleGameInput();
+	HandleGameInput();
+}
+
+// Plays one frame of a benchmark run, pressing the keys the script has for //
+// it. Returns false without playing once the game has left the game state. //
+static bool PlayBenchFrame(int frame)
+{
+	if (g_StateStack.empty() || g_StateStack.top().StatePointer != Game)
+		return false;
+
+	for (int i=0; i < (int)(sizeof(g_BenchScript) / sizeof(g_BenchScript[0])); i++)
+	{
+		if (g_BenchScript[i].frame == frame % BENCH_SCRIPT_LENGTH)
+			PushKey(g_BenchScript[i].key, g_BenchScript[i].down);
+	}
+
+	// Pretend a frame's worth of time has passed //
+	g_Timer = SDL_GetTicks() - (FRAME_RATE);
+
+	Game();
+
+	return true;
+}
+
+// This function plays each level for FRAMEBENCH_FRAMES frames with scripted input, //
+// checking the framebuffer after every frame against GOLDEN_FRAMES_FILE and timing //
+// the input, simulation and render parts of the frame. With record, the hashes    //
+// are written out as the new golden file instead. Text is part of every frame, so  //
+// the hashes only hold for the arial.ttf they were recorded with; a machine with   //
+// a different one records its own. Without a golden file the frames are only timed. //
+int RunFrameBench(bool record)
+{
+	static GoldenFrames   golden;
+	static GoldenFrames   actual;
+	static FrameTimeStats input_times, simulation_times, render_times, frame_times, capture_times;
+
+	bool have_golden = !record && LoadGoldenFrames(GOLDEN_FRAMES_FILE, &golden);
+	if (!record && !have_golden)
+		printf("recording needed: no %s, so frames are only timed (run -framebench record)\n",
+		       GOLDEN_FRAMES_FILE);
+
+	ClearFrameTimes(&input_times);
+	ClearFrameTimes(&simulation_times);
+	ClearFrameTimes(&render_times);
+	ClearFrameTimes(&frame_times);
+	ClearFrameTimes(&capture_times);
+
+	int mismatches = 0;
+
+	for (int level=1; level <= NUM_LEVELS; level++)
+	{
+		StartHeadlessGame(level);
+		ReleaseBenchKeys();
+
+		int frame = 0;
+		for (; frame < FRAMEBENCH_FRAMES; frame++)
+		{
+			// The level is over if the game left the game state //
+			if ( !PlayBenchFrame(frame) )
+				break;
+
+			AddFrameTime(&input_times,      g_FrameTimes.input);
+			AddFrameTime(&simulation_times, g_FrameTimes.simulation);
+			AddFrameTime(&render_times,     g_FrameTimes.render);
+			AddFrameTime(&frame_times,      g_FrameTimes.input + g_FrameTimes.simulation + g_FrameTimes.render);
+
+			actual.hashes[level - 1][frame] = HashSurface(g_Window);
+
+			// Frames come faster than the real game makes them, so the writer is //
+			// likely to fall behind; this shows what that costs the game thread. //
+			if (g_Capturing)
+			{
+				Uint64 capture_start = GetMicroseconds();
+				CapturePresentedFrame();
+				AddFrameTime(&capture_times, (Uint32)(GetMicroseconds() - capture_start));
+			}
+
+			if ( have_golden && (frame >= golden.num_frames[level - 1] ||
+				 actual.hashes[level - 1][frame] != golden.hashes[level - 1][frame]) )
+			{
+				if (mismatches < 10)
+					printf("level %d frame %d: hash %08x doesn't match the golden frame\n",
+					       level, frame, actual.hashes[level - 1][frame]);
+				mismatches++;
+			}
+		}
+
+		actual.num_frames[level - 1] = frame;
+
+		if (have_golden && frame < golden.num_frames[level - 1])
+		{
+			printf("level %d ended after %d frames, the golden run lasted %d\n",
+			       level, frame, golden.num_frames[level - 1]);
+			mismatches++;
+		}
+	}
+
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	PrintFrameTimes("input",      &input_times);
+	PrintFrameTimes("simulation", &simulation_times);
+	PrintFrameTimes("render",     &render_times);
+	PrintFrameTimes("frame",      &frame_times);
+	if (capture_times.count > 0)
+		PrintFrameTimes("capture",    &capture_times);
+
+	if (record)
+	{
+		if ( !SaveGoldenFrames(GOLDEN_FRAMES_FILE, &actual) )
+		{
+			printf("couldn't write %s\n", GOLDEN_FRAMES_FILE);
+			return 1;
+		}
+		printf("recorded golden frames to %s\n", GOLDEN_FRAMES_FILE);
+		return 0;
+	}
+
+	if (have_golden)
+		printf("%s: %d frames differ from the golden run\n", mismatches ? "FAILED" : "PASSED", mismatches);
+	else
+		printf("not checked: record golden frames with -framebench record first\n");
+
+	return mismatches ? 1 : 0;
+}
+
+// Returns true if two pools hold exactly the same particles, bit for bit //
+static bool SameParticles(const ParticlePool* a, const ParticlePool* b)
+{
+	int count = a->count;
+
+	return a->count == b->count &&
+	       memcmp(a->x,       b->x,       count * sizeof(float))  == 0 &&
+	       memcmp(a->y,       b->y,       count * sizeof(float))  == 0 &&
+	       memcmp(a->x_speed, b->x_speed, count * sizeof(float))  == 0 &&
+	       memcmp(a->y_speed, b->y_speed, count * sizeof(float))  == 0 &&
+	       memcmp(a->life,    b->life,    count * sizeof(float))  == 0 &&
+	       memcmp(a->color,   b->color,   count * sizeof(Uint32)) == 0;
+}
+
+// This function keeps PARTICLE_BENCH_COUNT particles bursting out of the //
+// blocks of the first level for PARTICLE_BENCH_FRAMES frames. The SIMD   //
+// and scalar updates run side by side on the same bursts, so after every //
+// frame their particles have to match exactly, and both have to fit the  //
+// particles' share of each frame in PARTICLE_BUDGET.                     //
+int RunParticleBench()
+{
+	static FrameTimeStats update_times, draw_times, particle_times, scalar_times, scalar_particle_times;
+	static ParticlePool   scalar_pool;
+
+	ClearFrameTimes(&update_times);
+	ClearFrameTimes(&draw_times);
+	ClearFrameTimes(&particle_times);
+	ClearFrameTimes(&scalar_times);
+	ClearFrameTimes(&scalar_particle_times);
+
+	StartHeadlessGame(1);
+
+	Uint32 color = SDL_MapRGB(g_Frame->format, 255, 230, 80);
+	int    live  = 0;
+	int    mismatches = 0;
+
+	// Both pools burst the same particles in the same places //
+	ClearParticles(&g_Particles, 1);
+	ClearParticles(&scalar_pool, 1);
+	Uint32 seed = 1;
+
+	for (int frame=0; frame < PARTICLE_BENCH_FRAMES; frame++)
+	{
+		while (g_Particles.count < PARTICLE_BENCH_COUNT && g_GameState.num_blocks > 0)
+		{
+			// Only blocks that are there burst //
+			const Block& block = g_GameState.blocks[NextRandom(&seed) % (NUM_ROWS * NUM_COLS)];
+			if (block.num_hits == 0)
+				continue;
+
+			SpawnBurst(&g_Particles, &block.screen_location, DEBRIS_PER_BLOCK, 4.0f, &color, 1);
+			SpawnBurst(&scalar_pool, &block.screen_location, DEBRIS_PER_BLOCK, 4.0f, &color, 1);
+		}
+		live += g_Particles.count;
+
+		ClearScreen();
+		DrawGameState(&g_GameState);
+		RenderDrawList(&g_DrawList, &g_Renderer);
+
+		// The particles are drawn straight onto the frame, to time them alone //
+		Uint64 start = GetMicroseconds();
+		UpdateParticles(&g_Particles);
+		Uint64 updated = GetMicroseconds();
+		DrawParticles(&g_Particles, g_Frame, &g_Viewport);
+		Uint64 drawn = GetMicroseconds();
+
+		AddFrameTime(&update_times,   (Uint32)(updated - start));
+		AddFrameTime(&draw_times,     (Uint32)(drawn - updated));
+		AddFrameTime(&particle_times, (Uint32)(drawn - start));
+
+		start = GetMicroseconds();
+		UpdateParticlesScalar(&scalar_pool);
+		updated = GetMicroseconds();
+		DrawParticles(&scalar_pool, g_Frame, &g_Viewport);
+		drawn = GetMicroseconds();
+
+		AddFrameTime(&scalar_times,          (Uint32)(updated - start));
+		AddFrameTime(&scalar_particle_times, (Uint32)(drawn - start));
+
+		if ( !SameParticles(&g_Particles, &scalar_pool) )
+		{
+			if (mismatches < 10)
+				printf("frame %d: the SIMD and scalar particles differ\n", frame);
+			mismatches++;
+		}
+
+		// An 8-bit frame has to be turned into the window's colors to be seen //
+		if (g_Frame != g_Window)
+			SDL_BlitSurface(g_Frame, NULL, g_Window, NULL);
+		SDL_UpdateRect(g_Window, 0, 0, 0, 0);
+	}
+
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	printf("%d particles live on average\n", live / PARTICLE_BENCH_FRAMES);
+	PrintFrameTimes("update",    &update_times);
+	PrintFrameTimes("scalar",    &scalar_times);
+	PrintFrameTimes("draw",      &draw_times);
+	PrintFrameTimes("particles", &particle_times);
+	PrintFrameTimes("scalar all", &scalar_particle_times);
+
+	// PrintFrameTimes() sorted the samples //
+	Uint32 worst        = particle_times.samples[particle_times.count * 99 / 100];
+	Uint32 scalar_worst = scalar_particle_times.samples[scalar_particle_times.count * 99 / 100];
+	bool   passed       = (worst <= PARTICLE_BUDGET && scalar_worst <= PARTICLE_BUDGET && mismatches == 0);
+
+	printf("%s: p99 of %u us with SIMD and %u us without against a budget of %d us, %d frames differ\n",
+	       passed ? "PASSED" : "FAILED", worst, scalar_worst, PARTICLE_BUDGET, mismatches);
+
+	return passed ? 0 : 1;
+}
+
+// This function plays the first level for SCALEBENCH_FRAMES frames with the //
+// benchmark's script, first in a WINDOW_WIDTH x WINDOW_HEIGHT window and    //
+// then at SCALEBENCH_WIDTH x SCALEBENCH_HEIGHT, and compares what a frame   //
+// costs at each size. Scaling the sprites is timed apart from the frames,   //
+// since it only happens when the window changes size.                      //
+int RunScaleBench()
+{
+	static FrameTimeStats render_times[2], frame_times[2];
+	const int widths[2]  = { WINDOW_WIDTH,  SCALEBENCH_WIDTH };
+	const int heights[2] = { WINDOW_HEIGHT, SCALEBENCH_HEIGHT };
+	Uint64 scale_times[2];
+
+	for (int pass=0; pass < 2; pass++)
+	{
+		ClearFrameTimes(&render_times[pass]);
+		ClearFrameTimes(&frame_times[pass]);
+
+		StartHeadlessGame(1);
+		ReleaseBenchKeys();
+
+		Uint64 start = GetMicroseconds();
+		ResizeWindow(widths[pass], heights[pass]);
+		scale_times[pass] = GetMicroseconds() - start;
+
+		if (!g_Window)
+		{
+			printf("couldn't make a %dx%d window\n", widths[pass], heights[pass]);
+			return 1;
+		}
+
+		for (int frame=0; frame < SCALEBENCH_FRAMES; frame++)
+		{
+			if ( !PlayBenchFrame(frame) )
+				break;
+
+			AddFrameTime(&render_times[pass], g_FrameTimes.render);
+			AddFrameTime(&frame_times[pass],  g_FrameTimes.input + g_FrameTimes.simulation + g_FrameTimes.render);
+		}
+	}
+
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	for (int pass=0; pass < 2; pass++)
+	{
+		printf("%dx%d, sprites scaled in %.2f ms\n", widths[pass], heights[pass], scale_times[pass] / 1000.0);
+		PrintFrameTimes("render", &render_times[pass]);
+		PrintFrameTimes("frame",  &frame_times[pass]);
+	}
+
+	// PrintFrameTimes() sorted the samples //
+	Uint32 small = frame_times[0].samples[frame_times[0].count / 2];
+	Uint32 large = frame_times[1].samples[frame_times[1].count / 2];
+
+	printf("a %dx%d frame costs %.2fx a %dx%d one at p50, for %.1fx the pixels\n",
+	       widths[1], heights[1], small ? (double)large / small : 0.0, widths[0], heights[0],
+	       (double)widths[1] * heights[1] / (widths[0] * heights[0]));
+
+	return 0;
+}
+
+// This function plays the first level at SCALEBENCH_WIDTH x SCALEBENCH_HEIGHT //
+// with SDL drawing each frame in order, then again with the tiles drawn on   //
+// one thread and on more and more after that. Every frame has to come out    //
+// the same as SDL drew it, and the render times show how drawing scales with //
+// the number of cores it gets.                                               //
+int RunTileBench()
+{
+	static FrameTimeStats render_times;
+	static Uint32 serial_hashes[SCALEBENCH_FRAMES];
+	const int thread_counts[] = { 0, 1, 2, 4, 8, MAX_RENDER_THREADS };
+	const int num_runs        = sizeof(thread_counts) / sizeof(thread_counts[0]);
+	Uint32 medians[sizeof(thread_counts) / sizeof(thread_counts[0])];
+
+	int serial_frames = 0;
+	int mismatches    = 0;
+
+	for (int run=0; run < num_runs; run++)
+	{
+		int threads = thread_counts[run];
+		ClearFrameTimes(&render_times);
+
+		StartHeadlessGame(1);
+		ResizeWindow(SCALEBENCH_WIDTH, SCALEBENCH_HEIGHT);
+		StopRenderPool(&g_Renderer);
+		StartRenderPool(&g_Renderer, threads);
+
+		if (!g_Window)
+		{
+			printf("couldn't make a %dx%d window\n", SCALEBENCH_WIDTH, SCALEBENCH_HEIGHT);
+			return 1;
+		}
+
+		// Every run has to play the same game, so start with no keys left over //
+		ReleaseBenchKeys();
+
+		int frame = 0;
+		for (; frame < SCALEBENCH_FRAMES; frame++)
+		{
+			if ( !PlayBenchFrame(frame) )
+				break;
+
+			AddFrameTime(&render_times, g_FrameTimes.render);
+
+			Uint32 hash = HashSurface(g_Window);
+			if (threads == 0)
+			{
+				serial_hashes[frame] = hash;
+			}
+			else if (frame >= serial_frames || hash != serial_hashes[frame])
+			{
+				if (mismatches < 10)
+					printf("%d threads, frame %d: hash %08x doesn't match SDL's\n", threads, frame, hash);
+				mismatches++;
+			}
+		}
+
+		if (threads == 0)
+			serial_frames = frame;
+		else if (frame != serial_frames)
+			mismatches++;
+
+		char name[32];
+		if (threads == 0)
+			sprintf(name, "SDL");
+		else
+			sprintf(name, "%d threads", g_Renderer.num_threads);
+		PrintFrameTimes(name, &render_times);
+
+		// PrintFrameTimes() sorted the samples //
+		medians[run] = render_times.samples[render_times.count / 2];
+	}
+
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	printf("%d frames at %dx%d in %d tiles, p50 render time against SDL's:\n",
+	       serial_frames, SCALEBENCH_WIDTH, SCALEBENCH_HEIGHT, RENDER_TILES);
+	for (int run=1; run < num_runs; run++)
+	{
+		printf("%2d threads: %.2fx\n", thread_counts[run],
+		       medians[run] ? (double)medians[0] / medians[run] : 0.0);
+	}
+
+	printf("%s: %d frames differ from SDL's\n", mismatches ? "FAILED" : "PASSED", mismatches);
+
+	return mismatches ? 1 : 0;
 }
 
-// This function determines which level to load and then iterates through the block structure //
-// reading in values from the level file and setting up the blocks accordingly. //
-void InitBlocks()
+// This function plays the first level in real time, GOVERNORBENCH_PHASE_TICKS //
+// ticks at a time: first as it is, then with GOVERNORBENCH_LOAD added to     //
+// every frame drawn, which is more than a whole frame's time, then as it is  //
+// again. The ticks should keep coming at the same rate the whole way, with   //
+// the governor drawing less under the load and everything once it's gone.   //
+// The load comes after Game() returns, so the governor can only tell from   //
+// the next ticks starting late, not from what drawing cost.                //
+int RunGovernorBench()
 {
-	// The following code creates a buffer storing the proper file name. If   //
-	// g_Level = 1, we get: "data\\level" + "1" + ".txt" = "data\\level1.txt" //
-	char file_name[256];              // for sprintf
-	// the file will always start with "level"
-	sprintf(file_name, "data\\level%d.txt", g_Level);
+	const char* phases[3] = { "no load", "load", "no load" };
+	double      tick_rate = 1000.0 / (FRAME_RATE);
+	bool        passed    = true;
+
+	StartHeadlessGame(1);
+	ResetGovernor(&g_Governor, true);
+	g_Timer = SDL_GetTicks();
+
+	for (int phase=0; phase < 3; phase++)
+	{
+		Uint32 load = (phase == 1) ? GOVERNORBENCH_LOAD : 0;
+
+		Uint32 first_tick    = g_Governor.frames;
+		Uint32 first_present = g_Governor.presents;
+		Uint64 start         = GetMicroseconds();
+
+		// Just like the game loop, the game decides when it's time for a tick //
+		while (g_Governor.frames - first_tick < GOVERNORBENCH_PHASE_TICKS)
+		{
+			if (g_StateStack.empty() || g_StateStack.top().StatePointer != Game)
+				break;
+
+			Uint32 presents = g_Governor.presents;
+
+			Game();
 
-	// Open the file for input.
-	FILE* inFile = fopen(file_name, "r");
+			// Make drawing look slower than it is //
+			if (load > 0 && g_Governor.presents != presents)
+			{
+				Uint64 loaded = GetMicroseconds() + load;
+				while (GetMicroseconds() < loaded)
+					;
+			}
+		}
+
+		double seconds = (GetMicroseconds() - start) / 1000000.0;
+		double rate    = (g_Governor.frames - first_tick) / seconds;
+
+		printf("%-8s %5.1f ticks a second (want %.1f), %3u of %u ticks drawn\n", phases[phase],
+		       rate, tick_rate, g_Governor.presents - first_present, g_Governor.frames - first_tick);
+
+		if (rate < tick_rate * 0.95)
+			passed = false;
+	}
+
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	PrintGovernorReport(&g_Governor);
+
+	// It has to have backed off under the load and come all the way back after it //
+	if (g_Governor.degrades == 0 || g_Governor.level != GOVERNOR_FULL || g_Governor.dropped_ticks > 0)
+		passed = false;
+
+	printf("%s\n", passed ? "PASSED" : "FAILED");
+
+	return passed ? 0 : 1;
+}
 
-	int index = 0; // used to index blocks in g_Blocks array
+// This function plays the first level drawn in the window's format and then //
+// drawn in 8 bits, at WINDOW_WIDTH x WINDOW_HEIGHT and then at             //
+// SCALEBENCH_WIDTH x SCALEBENCH_HEIGHT, and compares the bytes of pixels   //
+// each frame moves and how long it takes to draw. 8-bit frames count the   //
+// expansion to the window's format as well.                                //
+int RunIndexedBench()
+{
+	static FrameTimeStats render_times, expand_times;
+	const int sizes[2][2] = { { WINDOW_WIDTH, WINDOW_HEIGHT }, { SCALEBENCH_WIDTH, SCALEBENCH_HEIGHT } };
 
-	// We'll first read in the number of hits a block has and then determine whether we //
-	// should create the block (num_hits = 1-4) or if we should skip that block (0)     //
-	int temp_hits;
+	bool was_indexed = g_Indexed;
 
-	// Iterate through each row and column of blocks //
-	for (int row=0; row<NUM_ROWS; row++)
+	for (int size=0; size < 2; size++)
 	{
-		for (int col=0; col<NUM_COLS; col++)
+		Uint32 direct_render = 0;
+		double direct_bytes  = 0;
+
+		for (int indexed=0; indexed < 2; indexed++)
 		{
-			// Read the next value into temp_hits // 
-			fscanf(inFile, "%d", &temp_hits);
+			ClearFrameTimes(&render_times);
+			ClearFrameTimes(&expand_times);
+
+			g_Indexed = (indexed != 0);
+			StartHeadlessGame(1);
+			ResizeWindow(sizes[size][0], sizes[size][1]);
+
+			if (!g_Window)
+			{
+				printf("couldn't make a %dx%d window\n", sizes[size][0], sizes[size][1]);
+				return 1;
+			}
+
+			// Text kept from the last run is in the wrong format //
+			FreeTextCaches();
+
+			ReleaseBenchKeys();
 
-			g_Blocks[index].num_hits = temp_hits;
+			g_DrawList.bytes_drawn = 0;
+			g_FrameTimes.expand    = 0;
 
-			// We set the location of the block according to what row and column   //
-			// we're on in our loop. Notice that we use BLOCK_SCREEN_BUFFER to set //
-			// the blocks away from the sides of the screen. //
-			g_Blocks[index].screen_location.x = col*BLOCK_WIDTH + BLOCK_WIDTH - BLOCK_SCREEN_BUFFER;
-			g_Blocks[index].screen_location.y = row*BLOCK_HEIGHT + BLOCK_HEIGHT + BLOCK_SCREEN_BUFFER;
-			g_Blocks[index].screen_location.w = BLOCK_WIDTH;
-			g_Blocks[index].screen_location.h = BLOCK_HEIGHT;
-			g_Blocks[index].bitmap_location.w = BLOCK_WIDTH;
-			g_Blocks[index].bitmap_location.h = BLOCK_HEIGHT;
+			int frame = 0;
+			for (; frame < SCALEBENCH_FRAMES; frame++)
+			{
+				if ( !PlayBenchFrame(frame) )
+					break;
+
+				AddFrameTime(&render_times, g_FrameTimes.render);
+				AddFrameTime(&expand_times, g_FrameTimes.expand);
+			}
+
+			// Expanding reads each 8-bit pixel and writes it out in the window's format //
+			double pixels = (double)g_Window->w * g_Window->h;
+			double bytes  = frame ? (double)g_DrawList.bytes_drawn / frame : 0;
+			if (g_Frame != g_Window)
+				bytes += pixels * (1 + g_Window->format->BytesPerPixel);
 
-			// Now we set the bitmap location rect according to num_hits //
-			switch (g_Blocks[index].num_hits)
+			char name[32];
+			sprintf(name, "%d-bit", g_Frame->format->BitsPerPixel);
+			printf("%dx%d, %d frames:\n", g_Window->w, g_Window->h, frame);
+			PrintFrameTimes(name, &render_times);
+			if (g_Frame != g_Window)
+				PrintFrameTimes("expand", &expand_times);
+
+			// PrintFrameTimes() sorted the samples //
+			Uint32 median = render_times.count ? render_times.samples[render_times.count / 2] : 0;
+
+			printf("%-10s %.2f MB of pixels a frame, %.1f MB/s at %d frames a second\n", name,
+			       bytes / 1000000, bytes * FRAMES_PER_SECOND / 1000000, FRAMES_PER_SECOND);
+
+			if (!indexed)
+			{
+				direct_render = median;
+				direct_bytes  = bytes;
+			}
+			else if (median && direct_render && direct_bytes > 0)
 			{
-				case 1:
-				{
-					g_Blocks[index].bitmap_location.x = RED_X;
-					g_Blocks[index].bitmap_location.y = RED_Y;
-				} break;
-				case 2:
-				{
-					g_Blocks[index].bitmap_location.x = YELLOW_X;
-					g_Blocks[index].bitmap_location.y = YELLOW_Y;
-				} break;
-				case 3:
-				{
-					g_Blocks[index].bitmap_location.x = GREEN_X;
-					g_Blocks[index].bitmap_location.y = GREEN_Y;
-				} break;
-				case 4:
-				{
-					g_Blocks[index].bitmap_location.x = BLUE_X;
-					g_Blocks[index].bitmap_location.y = BLUE_Y;
-				} break;
+				printf("8-bit against %d-bit: %.2fx the render time, %.2fx the bytes\n",
+				       g_Window->format->BitsPerPixel, (double)median / direct_render, bytes / direct_bytes);
 			}
+		}
+	}
+
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	g_Indexed = was_indexed;
+
+	return 0;
+}
+
+// Starts the first level with the ball above the blocks, on its way up //
+static void StartTrappedGame()
+{
+	StartHeadlessGame(1);
+
+	ReleaseBenchKeys();
+
+	Ball& ball = g_GameState.ball;
+	ball.screen_location.x = WINDOW_WIDTH / 2;
+	ball.screen_location.y = BLOCK_SCREEN_BUFFER / 2;
+	ball.x_speed           = 3;
+	ball.y_speed           = -BALL_SPEED_Y;
+}
 
-			// For future use, keep track of how many blocks we have. //
-			g_NumBlocks++;
-			index++;	// move to next block
+// This function plays the first level from the ball being stuck above the //
+// blocks until WARPBENCH_AFTER_TICKS after it comes down, once a tick per  //
+// frame and once fast-forwarding. Every tick the fast-forwarded game shows //
+// has to match the same tick of the first game, and it should get there in //
+// a small fraction of the frames.                                          //
+int RunWarpBench()
+{
+	static Uint32 hashes[WARPBENCH_MAX_TICKS + 1];
+
+	// Play it through one frame at a time, remembering every tick //
+	StartTrappedGame();
+
+	int    last_tick = WARPBENCH_MAX_TICKS;
+	int    came_down = 0;
+	Uint64 start     = GetMicroseconds();
+	int    frames    = 0;
+
+	hashes[0] = HashGameState(&g_GameState);
+	while (g_GameState.ticks < last_tick && !g_StateStack.empty() && g_StateStack.top().StatePointer == Game)
+	{
+		g_Timer = SDL_GetTicks() - FRAME_RATE;
+		Game();
+		frames++;
+
+		hashes[g_GameState.ticks] = HashGameState(&g_GameState);
+
+		if ( came_down == 0 && !IsBallAboveBlocks(&g_GameState) )
+		{
+			came_down = g_GameState.ticks;
+			last_tick = came_down + WARPBENCH_AFTER_TICKS;
+			if (last_tick > WARPBENCH_MAX_TICKS)
+				last_tick = WARPBENCH_MAX_TICKS;
+		}
+	}
+
+	Uint64 real_time   = GetMicroseconds() - start;
+	int    real_frames = frames;
+	int    ticks       = g_GameState.ticks;
+
+	// Now again, skipping ahead //
+	StartTrappedGame();
+	g_FastForward       = true;
+	g_FastForwardTicks  = 0;
+	g_FastForwardFrames = 0;
+
+	int mismatches    = 0;
+	int warped_frames = 0;
+	frames = 0;
+	start  = GetMicroseconds();
+
+	while (g_GameState.ticks < ticks && !g_StateStack.empty() && g_StateStack.top().StatePointer == Game)
+	{
+		g_Timer = SDL_GetTicks() - FRAME_RATE;
+		Game();
+		frames++;
+
+		if (g_FastForwarding)
+			warped_frames++;
+
+		if (g_GameState.ticks > ticks || HashGameState(&g_GameState) != hashes[g_GameState.ticks])
+		{
+			if (mismatches < 10)
+				printf("tick %d doesn't match playing it in real time\n", g_GameState.ticks);
+			mismatches++;
+		}
+	}
+
+	Uint64 warp_time = GetMicroseconds() - start;
+
+	if (g_GameState.ticks != ticks)
+		mismatches++;
+
+	g_FastForward = false;
+	while (!g_StateStack.empty())
+		g_StateStack.pop();
+	Shutdown();
+
+	if (came_down == 0)
+		printf("the ball never came down in %d ticks\n", ticks);
+	printf("%d ticks with the ball above the blocks, then %d more\n", came_down, ticks - came_down);
+	printf("one tick a frame: %5d frames, %8.1f ms\n", real_frames, real_time / 1000.0);
+	printf("fast forward:     %5d frames, %8.1f ms (%d of them skipping ahead)\n",
+	       frames, warp_time / 1000.0, warped_frames);
+	if (warped_frames > 0)
+	{
+		printf("%.1fx real time while skipping ahead, %.1fx overall\n",
+		       (double)g_FastForwardTicks / warped_frames, frames ? (double)real_frames / frames : 0.0);
+	}
+
+	printf("%s: %d ticks differ from real time\n", mismatches ? "FAILED" : "PASSED", mismatches);
+
+	return mismatches ? 1 : 0;
+}
+
+// This function starts the game without a display STARTUPTEST_RUNS times  //
+// loading one file after another and STARTUPTEST_RUNS times loading them   //
+// in parallel, timing each start up to the first frame of the menu. It     //
+// fails if the fastest parallel start takes longer than STARTUP_BUDGET.    //
+int RunStartupTest()
+{
+	SDL_putenv((char*)"SDL_VIDEODRIVER=dummy");
+
+	bool            parallel_startup = g_ParallelStartup;
+	Uint32          fastest[2]       = { 0, 0 };
+	StartupTimeline timeline;
+
+	for (int run=0; run < STARTUPTEST_RUNS * 2; run++)
+	{
+		bool parallel = (run & 1) != 0;
+		g_ParallelStartup = parallel;
+
+		Init();
+		g_StateStack.top().StatePointer();
+
+		if (fastest[parallel] == 0 || g_Startup.first_frame < fastest[parallel])
+		{
+			fastest[parallel] = g_Startup.first_frame;
+			if (parallel)
+				timeline = g_Startup;
 		}
+
+		while (!g_StateStack.empty())
+			g_StateStack.pop();
+		Shutdown();
+	}
+
+	g_ParallelStartup = parallel_startup;
+
+	PrintStartupTimeline(&timeline);
+	printf("fastest of %d starts: %.1f ms one at a time, %.1f ms in parallel, budget %d ms\n",
+	       STARTUPTEST_RUNS, fastest[0] / 1000.0, fastest[1] / 1000.0, STARTUP_BUDGET);
+
+	bool passed = fastest[1] > 0 && fastest[1] <= STARTUP_BUDGET * 1000;
+	printf("%s\n", passed ? "PASSED" : "FAILED: startup is over budget");
+
+	return passed ? 0 : 1;
+}
+
+// This function reads in the layout of every level. //
+void LoadLevels()
+{
+	for (int level=1; level<=NUM_LEVELS; level++)
+	{
+		// The following code creates a buffer storing the proper file name. If //
+		// level = 1, we get: "Data/level" + "1" + ".txt" = "Data/level1.txt" //
+		char file_name[256];              // for sprintf
+		sprintf(file_name, LEVEL_FILE_NAME, level);
+
+		// A missing level is left empty //
+		if ( !LoadLevelFile(file_name, &g_Levels[level - 1]) )
+			memset(&g_Levels[level - 1], 0, sizeof(LevelLayout));
+	}
+}
+
+// Connects to the other player for a versus game, given the command line     //
+// -versus <player 1|2> <local port> <remote host> <remote port>                //
+//         [latency ms] [jitter ms] [loss %]                                    //
+// The last three fake a bad network. The versus game replaces the main menu.  //
+bool StartVersus(int argc, char **argv)
+{
+	if (argc < 6)
+	{
+		printf("usage: -versus <player 1|2> <local port> <remote host> <remote port> "
+		       "[latency ms] [jitter ms] [loss %%]\n");
+		return false;
+	}
+
+	int player = atoi(argv[2]) == 2 ? 1 : 0;
+
+	if ( !StartRollbackSession(&g_Versus, g_Levels, NUM_LEVELS, player, NET_INPUT_DELAY,
+	                           atoi(argv[3]), argv[4], atoi(argv[5])) )
+	{
+		printf("couldn't open UDP port %s\n", argv[3]);
+		return false;
 	}
+	g_VersusActive = true;
+
+	NetSetConditions(&g_Versus.socket, argc > 6 ? atoi(argv[6]) : 0,
+	                 argc > 7 ? atoi(argv[7]) : 0, argc > 8 ? atoi(argv[8]) : 0);
+
+	g_StateStack.pop();
+
+	StateStruct state;
+	state.StatePointer = VersusGame;
+	g_StateStack.push(state);
 
-	fclose(inFile);
+	return true;
+}
+
+// Starts the frame writer. Frames are captured as the game loop presents them. //
+bool StartCapturing(const char* format, const char* directory)
+{
+	int capture_format;
+	if (strcmp(format, "raw") == 0)
+		capture_format = CAPTURE_RAW;
+	else if (strcmp(format, "png") == 0)
+		capture_format = CAPTURE_PNG;
+	else
+		return false;
+
+	if ( !StartCapture(&g_Capture, capture_format, directory, g_Viewport.width, g_Viewport.height) )
+	{
+		printf("couldn't start capturing to %s\n", directory);
+		return false;
+	}
+
+	g_Capturing = true;
+	return true;
+}
+
+// Copies the frame we just presented for the writer, and once a second shows //
+// how the writer is keeping up in the window's title, where it isn't recorded. //
+void CapturePresentedFrame()
+{
+	if (!g_Capturing || !g_Window)
+		return;
+
+	CaptureFrame(&g_Capture, g_Window);
+
+	if (g_Capture.frames_presented % FRAMES_PER_SECOND == 0)
+	{
+		char caption[128];
+		sprintf(caption, "%s - recording, %d frames dropped, %d waiting", WINDOW_CAPTION,
+		        g_Capture.frames_dropped, CaptureBacklog(&g_Capture));
+		SDL_WM_SetCaption(caption, 0);
+	}
+}
+
+// This function changes the size of our window and rescales the sprites //
+// to match. Text is rendered at the new size as it's needed.            //
+void ResizeWindow(int width, int height)
+{
+	SetViewport(&g_Viewport, width, height);
+	FreeFrameBuffer();
+	g_Window = SDL_SetVideoMode(width, height, 0, g_VideoFlags);
+	CreateFrameBuffer();
+	if (g_Frame)
+		BuildSpriteCache(&g_Sprites, g_Bitmap, &g_Viewport, g_Frame->format);
+}
+
+// This function sets up what frames are drawn on, after the window has //
+// changed. With -indexed that's an 8-bit buffer the size of the window, //
+// otherwise it's the window itself.                                     //
+void CreateFrameBuffer()
+{
+	g_Frame = g_Window;
+
+	if (g_Indexed && g_Window)
+	{
+		g_Frame = CreateIndexedSurface(g_Window->w, g_Window->h);
+		if (!g_Frame)
+			g_Frame = g_Window;
+	}
+
+	ClearDrawList(&g_DrawList, g_Frame);
+}
+
+// This function frees the 8-bit buffer, if there is one. //
+void FreeFrameBuffer()
+{
+	if (g_Frame && g_Frame != g_Window)
+		SDL_FreeSurface(g_Frame);
+	g_Frame = NULL;
 }
 
 // This function shuts down our game. //
 void Shutdown()
 {
-	// Shutdown the true type font library. //
+	// Let the writer finish the frames it has //
+	if (g_Capturing)
+		StopCapture(&g_Capture);
+	g_Capturing = false;
+
+	if (g_VersusActive)
+		StopRollbackSession(&g_Versus);
+	g_VersusActive = false;
+
+	if (g_CounterPath)
+		StopCounterServer(&g_CounterServer);
+	g_CounterPath = NULL;
+
+	// Close any fonts and text we kept around, then shutdown the true type font library. //
+	FreeTextCaches();
 	TTF_Quit();
 
+	StopRenderPool(&g_Renderer);
+	ClearDrawList(&g_DrawList, NULL);
+
 	// Free our surfaces. //
+	FreeSpriteCache(&g_Sprites);
 	SDL_FreeSurface(g_Bitmap);
+	FreeFrameBuffer();
 	SDL_FreeSurface(g_Window);
+	g_Bitmap = NULL;
+	g_Window = NULL;
 
 	// Tell SDL to shutdown and free any resources it was using. //
 	SDL_Quit();
@@ -309,9 +1463,8 @@ void Menu()
 		DisplayText("Start (G)ame", 350, 250, 12, 255, 255, 255, 0, 0, 0);
 		DisplayText("(Q)uit Game",  350, 270, 12, 255, 255, 255, 0, 0, 0);
 			
-		// Tell SDL to display our backbuffer. The four 0's will make //
-		// SDL display the whole screen. //
-		SDL_UpdateRect(g_Window, 0, 0, 0, 0);
+		// Draw everything we queued up and tell SDL to display our backbuffer //
+		PresentFrame();
 
 		// We've processed a frame so we now need to record the time at which we did it. //
 		// This way we can compare this time the next time our function gets called and  //
@@ -328,42 +1481,253 @@ void Game()
 	// handled a frame. If FRAME_RATE amount of time has, it's time for a new frame. //
 	if ( (SDL_GetTicks() - g_Timer) >= FRAME_RATE )
 	{
-		HandleGameInput();
+		Uint64 frame_start = GetMicroseconds();
 
-		HandleBall();
+		// How many milliseconds late this tick is //
+		int lag = (int)(SDL_GetTicks() - g_Timer) - (FRAME_RATE);
+
+		SetAllocSubsystem(ALLOC_INPUT);
+		int input = HandleGameInput();
+
+		Uint64 input_done = GetMicroseconds();
+
+		SetAllocSubsystem(ALLOC_SIMULATION);
+
+		int ticks_before = g_GameState.ticks;
+
+		StepSimulation(&g_GameState, input);
+
+		if (g_GameState.ticks != ticks_before)
+			CountLiveTick(&g_GameState);
+
+		SpawnBlockEffects(&g_GameState);
+
+		// Skip ahead to when the ball comes back down, if it's stuck up top //
+		g_FastForwarding = false;
+		if (g_FastForward)
+			FastForward(input);
+
+		// Switch to the win or lose screen once the game is over //
+		if (g_GameState.result == RESULT_LOST)
+			HandleLoss();
+		else if (g_GameState.result == RESULT_WON)
+			HandleWin();
+
+		Uint64 simulation_done = GetMicroseconds();
+
+		SetAllocSubsystem(ALLOC_RENDER);
+
+		// The governor may have us skip drawing this frame, or parts of it //
+		if ( StartGovernedFrame(&g_Governor) )
+		{
+			// Make sure nothing from the last frame is still drawn. //
+			ClearScreen();
+
+			DrawGameState(&g_GameState);
+			UpdateAndDrawParticles();
+
+			// Output the number of lives the player has left and the current level //
+			if (g_Governor.draw_hud)
+			{
+				char buffer[256];
+
+				sprintf(buffer, "Lives: %d", g_GameState.lives);
+				DisplayText(buffer, LIVES_X, LIVES_Y, 12, 66, 239, 16, 0, 0, 0);		
+
+				sprintf(buffer, "Level: %d", g_GameState.level);
+				DisplayText(buffer, LEVEL_X, LEVEL_Y, 12, 66, 239, 16, 0, 0, 0);		
+
+				if (g_FastForwarding)
+					DisplayText("Fast forward", FASTFORWARD_X, FASTFORWARD_Y, 12, 255, 255, 255, 0, 0, 0);
+			}
+
+			// Draw everything we queued up and tell SDL to display our backbuffer //
+			PresentFrame();
+		}
+		else
+		{
+			// Particles keep moving whether they're drawn or not //
+			UpdateParticles(&g_Particles);
+		}
+
+		SetAllocSubsystem(ALLOC_OTHER);
+
+		// Keep track of how long each part of the frame took //
+		g_FrameTimes.input      = (Uint32)(input_done - frame_start);
+		g_FrameTimes.simulation = (Uint32)(simulation_done - input_done);
+		g_FrameTimes.render     = (Uint32)(GetMicroseconds() - simulation_done);
+
+		EndGovernedFrame(&g_Governor, g_FrameTimes.input + g_FrameTimes.simulation,
+		                 g_Governor.present ? g_FrameTimes.render : 0, lag);
+
+		// What collectors see of this tick //
+		AddCounterSample(COUNTER_TICK_TIME, g_FrameTimes.input + g_FrameTimes.simulation +
+		                                    g_FrameTimes.render);
+		SetCounter(COUNTER_BLOCKS_LEFT, g_GameState.num_blocks);
+		SetCounter(COUNTER_GOVERNOR_LEVEL, g_Governor.level);
+
+		// We've processed a frame, so the next one is due FRAME_RATE after this one //
+		// was. Counting from when this one was due, rather than from now, keeps     //
+		// the ticks coming at the same rate however long frames take to draw, as   //
+		// long as the governor can make them fit on average.                        //
+		g_Timer += FRAME_RATE;
+
+		// Too far behind to catch up without a burst of ticks, so let them go //
+		if ( (int)(SDL_GetTicks() - g_Timer) > GOVERNOR_MAX_LAG )
+		{
+			Uint32 dropped = (SDL_GetTicks() - g_Timer) / (FRAME_RATE);
+			g_Governor.dropped_ticks += dropped;
+			AddCounter(COUNTER_DROPPED_TICKS, dropped);
+			g_Timer = SDL_GetTicks();
+		}
+	}	
+}
+
+// Returns true if the last tick hit a block //
+static bool HitABlock(const GameState* state)
+{
+	for (int i=0; i < state->num_events; i++)
+	{
+		if (state->events[i].type == EVENT_BLOCK_HIT)
+			return true;
+	}
+
+	return false;
+}
+
+// This function runs the game ahead while the ball is above the blocks, //
+// where it can't reach the paddle, for up to FASTFORWARD_BUDGET of the  //
+// frame. It only runs while no key is held, and the paddle stays still  //
+// through the skipped ticks, so they play just as they would in real     //
+// time with the player's hands off the keys; they just aren't drawn.     //
+// It stops the moment the ball turns or anything hits a block.           //
+void FastForward(int input)
+{
+	if ( !IsBallAboveBlocks(&g_GameState) || HitABlock(&g_GameState) )
+		return;
+
+	// A held key means the player is moving the paddle, which they should see //
+	if (input & (INPUT_LEFT | INPUT_RIGHT))
+		return;
+
+	Uint64 start = GetMicroseconds();
+	int    ticks = 0;
+
+	while ( ticks < FASTFORWARD_MAX_TICKS && IsBallAboveBlocks(&g_GameState) &&
+	        GetMicroseconds() - start < FASTFORWARD_BUDGET )
+	{
+		StepSimulation(&g_GameState, INPUT_NONE);
+		CountLiveTick(&g_GameState);
+		ticks++;
+
+		// A moving block can still run into the ball //
+		if ( HitABlock(&g_GameState) )
+			break;
+	}
+
+	g_FastForwarding = true;
+	g_FastForwardTicks += ticks + 1;   // and the tick this frame ran anyway
+	g_FastForwardFrames++;
+	AddCounter(COUNTER_FASTFORWARD_TICKS, ticks + 1);
+}
+
+// This function handles a versus game. Only our own paddle is controlled from //
+// here; the other player's moves arrive over the network.                    //
+void VersusGame()
+{
+	if ( (SDL_GetTicks() - g_Timer) >= FRAME_RATE )
+	{
+		int input = HandleGameInput();
+
+		// Escape or closing the window ends the game //
+		if (g_StateStack.empty() || g_StateStack.top().StatePointer != VersusGame)
+			return;
+
+		int ticks_before = g_Versus.state.ticks;
+
+		bool waiting = !RollbackTick(&g_Versus, input, SDL_GetTicks());
+
+		// Only the newest tick's events are kept. Ticks replayed after a rollback //
+		// were shown already, and a waiting game hasn't made any new ones.       //
+		if (g_Versus.state.ticks != ticks_before)
+		{
+			SpawnBlockEffects(&g_Versus.state);
+			CountLiveTick(&g_Versus.state);
+		}
+
+		// Our game may have ended on a guess that a rollback takes back, so //
+		// only stop once the end is on a frame both inputs are known for.  //
+		if (g_Versus.result_frame >= 0)
+		{
+			HandleVersusOver();
+			return;
+		}
 
-		// Make sure nothing from the last frame is still drawn. //
 		ClearScreen();
 
-		// Draw the paddle and the ball //
-		SDL_BlitSurface(g_Bitmap, &g_Player.bitmap_location, g_Window, &g_Player.screen_location);
-		SDL_BlitSurface(g_Bitmap, &g_Ball.bitmap_location,   g_Window, &g_Ball.screen_location);
+		DrawGameState(&g_Versus.state);
+		UpdateAndDrawParticles();
+
+		char buffer[256];
+
+		sprintf(buffer, "P1: %d  P2: %d", g_Versus.state.scores[0], g_Versus.state.scores[1]);
+		DisplayText(buffer, LIVES_X, LIVES_Y, 12, 66, 239, 16, 0, 0, 0);
+
+		sprintf(buffer, "Lives: %d  Level: %d", g_Versus.state.lives, g_Versus.state.level);
+		DisplayText(buffer, LEVEL_X, LEVEL_Y, 12, 66, 239, 16, 0, 0, 0);
+
+		if (waiting)
+			DisplayText("Waiting for the other player...", 300, 300, 12, 255, 255, 255, 0, 0, 0);
 
-		// Iterate through the blocks array, drawing each block //
-		for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+		// The two games should never disagree, so make it obvious when they do //
+		if (g_Versus.desyncs > 0)
 		{
-			if (g_Blocks[i].num_hits > 0)
-				SDL_BlitSurface(g_Bitmap, &g_Blocks[i].bitmap_location, g_Window, &g_Blocks[i].screen_location);
+			sprintf(buffer, "Out of sync since frame %d", g_Versus.first_desync);
+			DisplayText(buffer, 300, 320, 12, 255, 0, 0, 0, 0, 0);
 		}
 
-		// Output the number of lives the player has left and the current level //
+		PresentFrame();
+
+		g_Timer = SDL_GetTicks();
+	}
+}
+
+// Display who won a versus game. //
+void VersusOver()
+{
+	if ( (SDL_GetTicks() - g_Timer) >= FRAME_RATE )
+	{
+		// They may still need our inputs to get to the end themselves //
+		if (g_VersusActive)
+		{
+			RollbackTick(&g_Versus, INPUT_NONE, SDL_GetTicks());
+
+			if ( IsRollbackFinished(&g_Versus) || SDL_GetTicks() - g_VersusEnded > NET_FINISH_TIMEOUT )
+			{
+				StopRollbackSession(&g_Versus);
+				g_VersusActive = false;
+			}
+		}
+
+		HandleWinLoseInput();
+
+		ClearScreen();
+
+		// Whoever broke the most blocks wins //
+		int ours   = g_Versus.state.scores[g_Versus.local_player];
+		int theirs = g_Versus.state.scores[1 - g_Versus.local_player];
+
 		char buffer[256];
+		sprintf(buffer, "%s  %d to %d", ours > theirs ? "You Win!!!" : (ours < theirs ? "You Lose." : "It's a draw."),
+		        ours, theirs);
 
-		sprintf(buffer, "Lives: %d", g_Lives);
-		DisplayText(buffer, LIVES_X, LIVES_Y, 12, 66, 239, 16, 0, 0, 0);		
-
-		sprintf(buffer, "Level: %d", g_Level);
-		DisplayText(buffer, LEVEL_X, LEVEL_Y, 12, 66, 239, 16, 0, 0, 0);		
+		DisplayText(buffer, 350, 250, 12, 255, 255, 255, 0, 0, 0);
+		DisplayText("Quit Game (Y or N)?", 350, 270, 12, 255, 255, 255, 0, 0, 0);
 
-		// Tell SDL to display our backbuffer. The four 0's will make //
-		// SDL display the whole screen. //
-		SDL_UpdateRect(g_Window, 0, 0, 0, 0);
+		PresentFrame();
 
-		// We've processed a frame so we now need to record the time at which we did it. //
-		// This way we can compare this time the next time our function gets called and  //
-		// see if enough time has passed between iterations. //
 		g_Timer = SDL_GetTicks();
-	}	
+	}
 }
 
 // This function handles the game's exit screen. It will display //
@@ -381,9 +1745,8 @@ void Exit()
 
 		DisplayText("Quit Game (Y or N)?", 350, 260, 12, 255, 255, 255, 0, 0, 0);
 
-		// Tell SDL to display our backbuffer. The four 0's will make //
-		// SDL display the whole screen. //
-		SDL_UpdateRect(g_Window, 0, 0, 0, 0);
+		// Draw everything we queued up and tell SDL to display our backbuffer //
+		PresentFrame();
 
 		// We've processed a frame so we now need to record the time at which we did it. //
 		// This way we can compare this time the next time our function gets called and  //
@@ -404,7 +1767,7 @@ void GameWon()
 		DisplayText("You Win!!!", 350, 250, 12, 255, 255, 255, 0, 0, 0);
 		DisplayText("Quit Game (Y or N)?", 350, 270, 12, 255, 255, 255, 0, 0, 0);
 
-		SDL_UpdateRect(g_Window, 0, 0, 0, 0);
+		PresentFrame();
 
 		g_Timer = SDL_GetTicks();
 	}	
@@ -422,7 +1785,7 @@ void GameLost()
 		DisplayText("You Lose.", 350, 250, 12, 255, 255, 255, 0, 0, 0);
 		DisplayText("Quit Game (Y or N)?", 350, 270, 12, 255, 255, 255, 0, 0, 0);
 
-		SDL_UpdateRect(g_Window, 0, 0, 0, 0);
+		PresentFrame();
 
 		g_Timer = SDL_GetTicks();
 	}	
@@ -431,10 +1794,171 @@ void GameLost()
 // This function simply clears the back buffer to black. //
 void ClearScreen()
 {
-	// This function just fills a surface with a given color. The //
-	// first 0 tells SDL to fill the whole surface. The second 0  //
-	// is for black. //
-	SDL_FillRect(g_Window, 0, 0);
+	// This queues up a fill with a given color. The NULL //
+	// means the whole window and the 0 is for black.     //
+	AddFill(&g_DrawList, NULL, 0);
+}
+
+// This function draws the frame queued up in g_DrawList and //
+// tells SDL to display our backbuffer. The four 0's will    //
+// make SDL display the whole screen.                        //
+void PresentFrame()
+{
+	g_FramesPresented++;
+
+	AddCounterSample(COUNTER_BLITS, g_DrawList.count);
+	AddCounterSample(COUNTER_TEXT_RENDERS, g_FrameTextRenders);
+	g_FrameTextRenders = 0;
+
+	RenderDrawList(&g_DrawList, &g_Renderer);
+
+	// An 8-bit frame is only turned into the window's colors here, //
+	// with SDL looking each pixel's color up in the palette.        //
+	if (g_Frame != g_Window)
+	{
+		Uint64 start = GetMicroseconds();
+		SDL_BlitSurface(g_Frame, NULL, g_Window, NULL);
+		g_FrameTimes.expand = (Uint32)(GetMicroseconds() - start);
+	}
+
+	SDL_UpdateRect(g_Window, 0, 0, 0, 0);
+
+	MarkFirstFrame(&g_Startup);
+}
+
+// This function draws a sprite from our bitmap at a spot in the game, using //
+// the copy already scaled to the window.                                     //
+void DrawSprite(const SDL_Rect& bitmap_location, const SDL_Rect& screen_location)
+{
+	SDL_Rect     destination = ScaleRect(&g_Viewport, screen_location);
+	SDL_Surface* sprite      = GetSprite(&g_Sprites, bitmap_location);
+
+	if (sprite)
+		AddBlit(&g_DrawList, sprite, NULL, destination);
+	else
+		AddBlit(&g_DrawList, g_Bitmap, &bitmap_location, destination);
+}
+
+// This function draws the paddles, the ball, power-ups and the blocks. The //
+// game state is left untouched, so replays of the game stay the same.      //
+void DrawGameState(const GameState* state)
+{
+	SDL_Rect destination;
+
+	// Draw the paddles and the ball //
+	for (int i=0; i < state->num_players; i++)
+		DrawSprite(state->players[i].bitmap_location, state->players[i].screen_location);
+
+	DrawSprite(state->ball.bitmap_location, state->ball.screen_location);
+
+	// Power-ups are plain squares, green for a life and gold for points //
+	Uint32 powerup_colors[NUM_POWERUP_TYPES] = { SDL_MapRGB(g_Frame->format, 66, 239, 16),
+	                                             SDL_MapRGB(g_Frame->format, 255, 200, 0) };
+
+	const EntityStore&   entities = state->entities;
+	const ComponentList* list     = &entities.lists[COMPONENT_POWERUP];
+	for (int i=0; i < list->count; i++)
+	{
+		int slot = list->entities[i];
+		if ( !HasComponents(&entities, slot, COMPONENT_BIT(COMPONENT_POSITION)) )
+			continue;
+
+		destination = ScaleRect(&g_Viewport, entities.positions[slot]);
+		AddFill(&g_DrawList, &destination, powerup_colors[entities.powerup_types[slot]]);
+	}
+
+	// Iterate through the blocks array, drawing each block //
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		const Block& block = state->blocks[i];
+		if (block.num_hits > 0)
+			DrawSprite(block.bitmap_location, block.screen_location);
+	}
+}
+
+// This function goes through the last tick's events, throwing out debris for //
+// every block destroyed, in the block's own colors, and sparks for every     //
+// block that was only damaged.                                               //
+void SpawnBlockEffects(const GameState* state)
+{
+	// A new level means new blocks, not broken ones //
+	for (int i=0; i < state->num_events; i++)
+	{
+		if (state->events[i].type == EVENT_LEVEL_CLEARED)
+			return;
+	}
+
+	Uint32 sparks[2] = { SDL_MapRGB(g_Frame->format, 255, 255, 255),
+	                     SDL_MapRGB(g_Frame->format, 255, 230, 80) };
+
+	for (int i=0; i < state->num_events; i++)
+	{
+		const GameEvent& event = state->events[i];
+		if (event.type != EVENT_BLOCK_HIT && event.type != EVENT_BLOCK_DESTROYED)
+			continue;
+
+		// Destroyed blocks were hit too, they get their debris from the second event //
+		const Block& block = state->blocks[event.index];
+		if (event.type == EVENT_BLOCK_HIT)
+		{
+			if (block.num_hits > 0)
+				SpawnBurst(&g_Particles, &block.screen_location, SPARKS_PER_HIT, 3.0f, sparks, 2);
+			continue;
+		}
+
+		// Pick colors from inside the block's image, away from its edges //
+		Uint32 colors[PARTICLE_COLORS];
+		const SDL_Rect& image = block.bitmap_location;
+
+		if ( SDL_MUSTLOCK(g_Bitmap) )
+			SDL_LockSurface(g_Bitmap);
+		for (int c=0; c < PARTICLE_COLORS; c++)
+		{
+			colors[c] = GetBitmapColor(image.x + image.w * (c + 1) / (PARTICLE_COLORS + 1),
+			                           image.y + image.h / 2);
+		}
+		if ( SDL_MUSTLOCK(g_Bitmap) )
+			SDL_UnlockSurface(g_Bitmap);
+
+		SpawnBurst(&g_Particles, &block.screen_location, DEBRIS_PER_BLOCK, 2.0f, colors, PARTICLE_COLORS);
+	}
+}
+
+// This function tells collectors about a tick of the game being played. Fast //
+// forwarded ticks count too; ticks replayed after a rollback don't.          //
+void CountLiveTick(const GameState* state)
+{
+	AddCounter(COUNTER_TICKS, 1);
+	AddCounter(COUNTER_MOVER_STEPS, state->mover_steps);
+	AddCounterSample(COUNTER_COLLISION_CHECKS, state->collision_checks);
+}
+
+// Reads a pixel of our bitmap and returns it in the format frames are //
+// drawn in. The bitmap must be locked. //
+Uint32 GetBitmapColor(int x, int y)
+{
+	SDL_PixelFormat* format = g_Bitmap->format;
+	Uint8* pixel = (Uint8*)g_Bitmap->pixels + y * g_Bitmap->pitch + x * format->BytesPerPixel;
+
+	Uint32 value;
+	switch (format->BytesPerPixel)
+	{
+	case 1:  value = *pixel;                                        break;
+	case 2:  value = *(Uint16*)pixel;                               break;
+	case 3:  value = pixel[0] | (pixel[1] << 8) | (pixel[2] << 16); break;
+	default: value = *(Uint32*)pixel;                               break;
+	}
+
+	Uint8 r, g, b;
+	SDL_GetRGB(value, format, &r, &g, &b);
+
+	return SDL_MapRGB(g_Frame->format, r, g, b);
+}
+
+void UpdateAndDrawParticles()
+{
+	UpdateParticles(&g_Particles);
+	AddParticles(&g_DrawList, &g_Particles, &g_Viewport);
 }
 
 // This function displays text to the screen. It takes the text //
@@ -442,27 +1966,166 @@ void ClearScreen()
 // text, and the color of the text and background.              //
 void DisplayText(const char* text, int x, int y, int size, int fR, int fG, int fB, int bR, int bG, int bB) 
 {
-	// Open our font and set its size to the given parameter. //
-    TTF_Font* font = TTF_OpenFont("arial.ttf", size);
+	int subsystem = SetAllocSubsystem(ALLOC_TEXT);
 
 	SDL_Color foreground  = { fR, fG, fB};   // Text color. //
 	SDL_Color background  = { bR, bG, bB };  // Color of what's behind the text. //
 
-	// This renders our text to a temporary surface. There //
-	// are other text functions, but this one looks nice.  //
-	SDL_Surface* temp = TTF_RenderText_Shaded(font, text, foreground, background);
+	// A structure storing the destination of our text, in the window. //
+	SDL_Rect destination = { (Sint16)ScaleX(&g_Viewport, x), (Sint16)ScaleY(&g_Viewport, y), 0, 0 };
 
-	// A structure storing the destination of our text. //
-	SDL_Rect destination = { x, y, 0, 0 };
-	
-	// Blit the text surface to our window surface. //
-	SDL_BlitSurface(temp, NULL, g_Window, &destination);
+	// The text grows with the window too //
+	size = ScaleSize(&g_Viewport, size);
+	if (size < 1)
+		size = 1;
+
+	// Most of our text is the same every frame, so we only render it the first time //
+	SDL_Surface* cached = GetTextSurface(text, size, foreground, background);
+
+	if (cached)
+	{
+		AddBlit(&g_DrawList, cached, NULL, destination);
+	}
+	else
+	{
+		// Without the font there's nothing we can draw //
+		TTF_Font* font = GetFont(size);
+		if (!font)
+		{
+			SetAllocSubsystem(subsystem);
+			return;
+		}
+
+		// This renders our text to a temporary surface. There //
+		// are other text functions, but this one looks nice.  //
+		SDL_Surface* temp = TTF_RenderText_Shaded(font, text, foreground, background);
+		g_FrameTextRenders++;
+
+		// Queue the text surface up to be drawn, then freed //
+		// once the frame is on the screen. Always free memory! //
+		if (temp)
+		{
+			AddBlit(&g_DrawList, temp, NULL, destination);
+			AddTemporary(&g_DrawList, temp);
+		}
+	}
+
+	SetAllocSubsystem(subsystem);
+}
+
+// This function returns an open font of the given size. Opening a font is slow, //
+// so each size is opened once and kept until FreeTextCaches() is called.       //
+TTF_Font* GetFont(int size)
+{
+	for (int i=0; i < FONT_CACHE_SIZE; i++)
+	{
+		if (g_Fonts[i].font && g_Fonts[i].size == size)
+			return g_Fonts[i].font;
+	}
+
+	// Use a free slot, or close the last font if there aren't any //
+	int slot = FONT_CACHE_SIZE - 1;
+	for (int i=0; i < FONT_CACHE_SIZE; i++)
+	{
+		if (!g_Fonts[i].font)
+		{
+			slot = i;
+			break;
+		}
+	}
 
-	// Always free memory! //
-	SDL_FreeSurface(temp);
+	if (g_Fonts[slot].font)
+		TTF_CloseFont(g_Fonts[slot].font);
 
-	// Close the font. //
-	TTF_CloseFont(font);
+	// Open our font and set its size to the given parameter. //
+	g_Fonts[slot].font = TTF_OpenFont("arial.ttf", size);
+	g_Fonts[slot].size = size;
+
+	return g_Fonts[slot].font;
+}
+
+// This function returns a surface with the text already rendered on it, rendering //
+// it if we haven't already. Returns NULL if the text is too long to keep around, //
+// or couldn't be rendered.                                                         //
+SDL_Surface* GetTextSurface(const char* text, int size, SDL_Color foreground, SDL_Color background)
+{
+	if (strlen(text) >= MAX_TEXT_LENGTH)
+		return NULL;
+
+	TTF_Font* font = GetFont(size);
+	if (!font)
+		return NULL;
+
+	g_TextCacheClock++;
+
+	// Look for the text, remembering the least recently used slot in case it isn't there //
+	TextCacheEntry* oldest = &g_TextCache[0];
+	for (int i=0; i < TEXT_CACHE_SIZE; i++)
+	{
+		TextCacheEntry& entry = g_TextCache[i];
+
+		if ( entry.surface && entry.size == size &&
+			 entry.foreground.r == foreground.r && entry.foreground.g == foreground.g &&
+			 entry.foreground.b == foreground.b && entry.background.r == background.r &&
+			 entry.background.g == background.g && entry.background.b == background.b &&
+			 strcmp(entry.text, text) == 0 )
+		{
+			entry.last_used = g_TextCacheClock;
+			return entry.surface;
+		}
+
+		if (entry.last_used < oldest->last_used)
+			oldest = &entry;
+	}
+
+	SDL_Surface* surface = TTF_RenderText_Shaded(font, text, foreground, background);
+	g_FrameTextRenders++;
+
+	// Text that failed isn't kept, so the slot's text stays usable //
+	if (!surface)
+		return NULL;
+
+	if (oldest->surface)
+		SDL_FreeSurface(oldest->surface);
+
+	strcpy(oldest->text, text);
+	oldest->size       = size;
+	oldest->foreground = foreground;
+	oldest->background = background;
+	oldest->last_used  = g_TextCacheClock;
+	oldest->surface    = surface;
+
+	// Kept text is given the frames' palette once, so drawing it is a plain copy //
+	if (g_Frame != g_Window)
+	{
+		SDL_Surface* converted = SDL_ConvertSurface(oldest->surface, g_Frame->format, SDL_SWSURFACE);
+		if (converted)
+		{
+			SDL_FreeSurface(oldest->surface);
+			oldest->surface = converted;
+		}
+	}
+
+	return oldest->surface;
+}
+
+// This function frees all of the text surfaces and fonts DisplayText kept around. //
+void FreeTextCaches()
+{
+	for (int i=0; i < TEXT_CACHE_SIZE; i++)
+	{
+		if (g_TextCache[i].surface)
+			SDL_FreeSurface(g_TextCache[i].surface);
+		g_TextCache[i].surface   = NULL;
+		g_TextCache[i].last_used = 0;
+	}
+
+	for (int i=0; i < FONT_CACHE_SIZE; i++)
+	{
+		if (g_Fonts[i].font)
+			TTF_CloseFont(g_Fonts[i].font);
+		g_Fonts[i].font = NULL;
+	}
 }
 
 // This function receives player input and //
@@ -472,6 +2135,10 @@ void HandleMenuInput()
 	// Fill our event structure with event information. //
 	if ( SDL_PollEvent(&g_Event) )
 	{
+		// Rescale everything when the player resizes the window //
+		if (g_Event.type == SDL_VIDEORESIZE)
+			ResizeWindow(g_Event.resize.w, g_Event.resize.h);
+
 		// Handle user manually closing game window //
 		if (g_Event.type == SDL_QUIT)
 		{			
@@ -510,16 +2177,22 @@ void HandleMenuInput()
 	}
 }
 
-// This function receives player input and //
-// handles it for the main game state.     //
-void HandleGameInput() 
+// This function receives player input for the main game state and //
+// returns it as InputFlags for the simulation to act on.           //
+int HandleGameInput() 
 {
 	static bool left_pressed  = false;
 	static bool right_pressed = false;
 
+	int input = INPUT_NONE;
+
 	// Fill our event structure with event information. //
 	if ( SDL_PollEvent(&g_Event) )
 	{
+		// Rescale everything when the player resizes the window //
+		if (g_Event.type == SDL_VIDEORESIZE)
+			ResizeWindow(g_Event.resize.w, g_Event.resize.h);
+
 		// Handle user manually closing game window //
 		if (g_Event.type == SDL_QUIT)
 		{			
@@ -529,7 +2202,7 @@ void HandleGameInput()
 				g_StateStack.pop();
 			}
 
-			return;  // game is over, exit the function
+			return input;  // game is over, exit the function
 		}
 
 		// Handle keyboard input here //
@@ -539,13 +2212,12 @@ void HandleGameInput()
 			{
 				g_StateStack.pop();
 				
-				return;  // this state is done, exit the function 
+				return input;  // this state is done, exit the function 
 			}	
 			if (g_Event.key.keysym.sym == SDLK_SPACE)
 			{
 				// Player can hit 'space' to make the ball move at start //
-				if (g_Ball.y_speed == 0)
-					g_Ball.y_speed = BALL_SPEED_Y;
+				input |= INPUT_LAUNCH;
 			}
 			if (g_Event.key.keysym.sym == SDLK_LEFT)
 			{
@@ -569,22 +2241,13 @@ void HandleGameInput()
 		}		
 	}
 
-	// This is where we actually move the paddle //
+	// The paddle is moved by the simulation //
 	if (left_pressed)
-	{
-		// Notice that we do this here now instead of in a separate function //
-		if ( (g_Player.screen_location.x - PLAYER_SPEED) >= 0 )
-		{
-			g_Player.screen_location.x -= PLAYER_SPEED;
-		}
-	}
+		input |= INPUT_LEFT;
 	if (right_pressed)
-	{
-		if ( (g_Player.screen_location.x + PLAYER_SPEED) <= WINDOW_WIDTH )
-		{
-			g_Player.screen_location.x += PLAYER_SPEED;
-		}
-	}
+		input |= INPUT_RIGHT;
+
+	return input;
 }
 
 // This function receives player input and //
@@ -594,6 +2257,10 @@ void HandleExitInput()
 	// Fill our event structure with event information. //
 	if ( SDL_PollEvent(&g_Event) )
 	{
+		// Rescale everything when the player resizes the window //
+		if (g_Event.type == SDL_VIDEORESIZE)
+			ResizeWindow(g_Event.resize.w, g_Event.resize.h);
+
 		// Handle user manually closing game window //
 		if (g_Event.type == SDL_QUIT)
 		{			
@@ -638,6 +2305,10 @@ void HandleWinLoseInput()
 {
 	if ( SDL_PollEvent(&g_Event) )
 	{
+		// Rescale everything when the player resizes the window //
+		if (g_Event.type == SDL_VIDEORESIZE)
+			ResizeWindow(g_Event.resize.w, g_Event.resize.h);
+
 		// Handle user manually closing game window //
 		if (g_Event.type == SDL_QUIT)
 		{			
@@ -682,269 +2353,6 @@ void HandleWinLoseInput()
 	}
 }
 
-// Check to see if the ball is going to hit the paddle //
-bool CheckBallCollisions()
-{
-	// Temporary values to keep things tidy //
-	int ball_x      = g_Ball.screen_location.x;
-	int ball_y      = g_Ball.screen_location.y;
-	int ball_width  = g_Ball.screen_location.w;
-	int ball_height = g_Ball.screen_location.h;
-	int ball_speed  = g_Ball.y_speed;
-
-	int paddle_x      = g_Player.screen_location.x;
-	int paddle_y      = g_Player.screen_location.y;	
-	int paddle_width  = g_Player.screen_location.w;
-	int paddle_height = g_Player.screen_location.h;
-
-	// Check to see if ball is in Y range of the player's paddle. //
-	// We check its speed to see if it's even moving towards the player's paddle. //
-	if ( (ball_speed > 0) && (ball_y + ball_height >= paddle_y) && 
-		 (ball_y + ball_height <= paddle_y + paddle_height) )        // side hit
-	{
-		// If ball is in the X range of the paddle, return true. //
-		if ( (ball_x <= paddle_x + paddle_width) && (ball_x + ball_width >= paddle_x) )
-		{
-			return true;
-		}
-	}
-
-	return false;
-}
-
-// This function checks to see if the ball has hit one of the blocks. It also checks  //
-// what part of the ball hit the block so we can adjust the ball's speed acoordingly. //
-void CheckBlockCollisions()
-{
-	// collision points 
-	int left_x   = g_Ball.screen_location.x;
-	int left_y   = g_Ball.screen_location.y + g_Ball.screen_location.h/2;
-	int right_x  = g_Ball.screen_location.x + g_Ball.screen_location.w;
-	int right_y  = g_Ball.screen_location.y + g_Ball.screen_location.h/2;
-	int top_x    = g_Ball.screen_location.x + g_Ball.screen_location.w/2;
-	int top_y    = g_Ball.screen_location.y;
-	int bottom_x = g_Ball.screen_location.x + g_Ball.screen_location.w/2;
-	int bottom_y = g_Ball.screen_location.y + g_Ball.screen_location.h;
-
-	bool top = false;
-	bool bottom = false;
-	bool left = false;
-	bool right = false;
-
-	int left_col = (left_x - BLOCK_WIDTH + BLOCK_SCREEN_BUFFER) / BLOCK_WIDTH;
-	int right_col = (right_x - BLOCK_WIDTH + BLOCK_SCREEN_BUFFER) / BLOCK_WIDTH;
-	if (left_col < 0)
-		left_col = 0;
-	if (right_col >= NUM_COLS)
-		right_col = NUM_COLS - 1;
-
-	int top_row = (top_y - BLOCK_WIDTH - BLOCK_SCREEN_BUFFER) / BLOCK_HEIGHT;
-	int bottom_row = (bottom_x - BLOCK_WIDTH - BLOCK_SCREEN_BUFFER) / BLOCK_HEIGHT;
-	if (top_row < 0)
-		top_row = 0;
-	if (bottom_row >= NUM_ROWS)
-		bottom_row = NUM_ROWS - 1;
-
-	for (int row = top_row; row <= bottom_row; ++row)
-	{
-		for (int col = left_col; col <= right_col; ++col)
-		{
-			int block = col + row * NUM_COLS;
-			if (g_Blocks[block].num_hits == 0)
-				continue;
-
-			// top //
-			if ( CheckPointInRect(top_x, top_y, g_Blocks[block].screen_location) )
-			{
-				top = true;
-				HandleBlockCollision(block);
-			}
-			// bottom //
-			if ( CheckPointInRect(bottom_x, bottom_y, g_Blocks[block].screen_location) )
-			{
-				bottom = true;
-				HandleBlockCollision(block);
-			}
-			// left //
-			if ( CheckPointInRect(left_x, left_y, g_Blocks[block].screen_location) )
-			{
-				left = true;
-				HandleBlockCollision(block);
-			}
-			// right //
-			if ( CheckPointInRect(right_x, right_y, g_Blocks[block].screen_location) )
-			{
-				right = true;
-				HandleBlockCollision(block);
-			}
-		}
-	}
-
-	if (top)
-	{
-		g_Ball.y_speed = -g_Ball.y_speed;
-		g_Ball.screen_location.y += BALL_DIAMETER;
-	}
-	if (bottom)
-	{
-		g_Ball.y_speed = -g_Ball.y_speed;
-		g_Ball.screen_location.y -= BALL_DIAMETER;
-	}
-	if (left)
-	{
-		g_Ball.x_speed = -g_Ball.x_speed;
-		g_Ball.screen_location.x += BALL_DIAMETER;
-	}
-	if (right)
-	{
-		g_Ball.x_speed = -g_Ball.x_speed;
-		g_Ball.screen_location.x -= BALL_DIAMETER;
-	}
-}
-
-// This function changes the block's hit count. We also need it to change  //
-// the color of the block and check to see if the hit count reached zero.  //
-void HandleBlockCollision(int index)
-{
-	if (g_Blocks[index].num_hits == 0)
-		return;
-
-	g_Blocks[index].num_hits--;
-
-	// If num_hits is 0, the block needs to be erased //
-	if (g_Blocks[index].num_hits == 0)
-	{
-		g_NumBlocks--;
-
-		// Check to see if it's time to change the level //
-		if (g_NumBlocks == 0)
-		{
-			ChangeLevel();			
-		}
-	}
-	// If the hit count hasn't reached zero, we need to change the block's color //
-	else
-	{
-		switch (g_Blocks[index].num_hits)
-		{
-			case 1:
-			{
-				g_Blocks[index].bitmap_location.x = RED_X;
-				g_Blocks[index].bitmap_location.y = RED_Y;
-			} break;
-			case 2:
-			{
-				g_Blocks[index].bitmap_location.x = YELLOW_X;
-				g_Blocks[index].bitmap_location.y = YELLOW_Y;
-			} break;
-			case 3:
-			{
-				g_Blocks[index].bitmap_location.x = GREEN_X;
-				g_Blocks[index].bitmap_location.y = GREEN_Y;
-			} break;
-		}
-	}
-}
-
-// Check to see if a point is within a rectangle //
-bool CheckPointInRect(int x, int y, SDL_Rect rect)
-{
-	if ( (x >= rect.x) && (x <= rect.x + rect.w) && 
-		 (y >= rect.y) && (y <= rect.y + rect.h) )
-	{
-		return true;
-	}
-
-	return false;
-}
-
-void ChangeLevel()
-{
-	g_Level++;
-
-	// Check to see if the player has won //
-	if (g_Level > NUM_LEVELS)
-	{
-		HandleWin();
-		return;
-	}
-
-	// Reset the ball //
-	g_Ball.x_speed = 0;
-	g_Ball.y_speed = 0;
-
-	g_Ball.screen_location.x = WINDOW_WIDTH/2 - g_Ball.screen_location.w/2;
-	g_Ball.screen_location.y = WINDOW_HEIGHT/2 - g_Ball.screen_location.h/2;
-
-	g_NumBlocks = 0; // Set this to zero before calling InitBlocks()
-	InitBlocks();    // InitBlocks() will load the proper level 
-}
-
-void HandleBall()
-{	
-	// Start by moving the ball //
-	MoveBall();	
-
-	if ( CheckBallCollisions() )	
-	{
-		// Get center location of paddle //
-	    int paddle_center = g_Player.screen_location.x + g_Player.screen_location.w / 2;
-		int ball_center = g_Ball.screen_location.x + g_Ball.screen_location.w / 2;
-
-		// Find the location on the paddle that the ball hit //
-		int paddle_location = ball_center - paddle_center;
-
-		// Increase X speed according to distance from center of paddle. //
-		// Use bit shifting, multiplication, and pre-compile division to avoid
-		// runtime division, which can be expensive on embedded systems.
-		g_Ball.x_speed =
-			(paddle_location * ((1 << BALL_SPEED_MODIFIER_SHIFT) /
-				BALL_SPEED_MODIFIER)) >> BALL_SPEED_MODIFIER_SHIFT;
-		g_Ball.y_speed = -g_Ball.y_speed;
-	}
-
-	// Check for collisions with blocks //
-	CheckBlockCollisions();
-}
-
-void MoveBall()
-{
-	g_Ball.screen_location.x += g_Ball.x_speed;
-	g_Ball.screen_location.y += g_Ball.y_speed;	
-
-	// If the ball is moving left, we see if it hits the wall. If does, //
-	// we change its direction. We do the same thing if it's moving right. //
-	if ( ( (g_Ball.x_speed < 0) && (g_Ball.screen_location.x <= 0)  ) || 
-		 ( (g_Ball.x_speed > 0) &&
-		   (g_Ball.screen_location.x + g_Ball.screen_location.w >= WINDOW_WIDTH) ) )
-	{
-		g_Ball.x_speed = -g_Ball.x_speed;
-	}
-
-	// If the ball is moving up, we should check to see if it hits the 'roof' //
-	if ( (g_Ball.y_speed < 0) && (g_Ball.screen_location.y <= 0) )
-	{
-		g_Ball.y_speed = -g_Ball.y_speed;
-	}
-
-	// Check to see if ball has passed the player //
-	if ( g_Ball.screen_location.y  >= WINDOW_HEIGHT )
-	{
-		g_Lives--;
-
-		g_Ball.x_speed = 0;
-		g_Ball.y_speed = 0;
-
-		g_Ball.screen_location.x = WINDOW_WIDTH/2 - g_Ball.screen_location.w/2;
-		g_Ball.screen_location.y = WINDOW_HEIGHT/2 - g_Ball.screen_location.h/2;
-
-		if (g_Lives == 0)
-		{
-			HandleLoss();
-		}
-	}
-}
-
 void HandleLoss()
 {
 	while ( !g_StateStack.empty() )
@@ -952,16 +2360,9 @@ void HandleLoss()
 		g_StateStack.pop();
 	}	
 
-	g_Ball.x_speed = 0;
-	g_Ball.y_speed = 0;
-
-	g_Ball.screen_location.x = WINDOW_WIDTH/2 - g_Ball.screen_location.w/2;
-	g_Ball.screen_location.y = WINDOW_HEIGHT/2 - g_Ball.screen_location.h/2;
-
-	g_Lives = NUM_LIVES;
-	g_NumBlocks = 0;
-	g_Level = 1;
-	InitBlocks();
+	// Start over from the first level //
+	InitGameState(&g_GameState, g_Levels, NUM_LEVELS, 1);
+	ClearParticles(&g_Particles, SDL_GetTicks());
 
 	StateStruct temp;
 	temp.StatePointer = GameLost;
@@ -976,19 +2377,27 @@ void HandleWin()
 		g_StateStack.pop();
 	}	
 
-	g_Ball.x_speed = 0;
-	g_Ball.y_speed = 0;
+	// Start over from the first level //
+	InitGameState(&g_GameState, g_Levels, NUM_LEVELS, 1);
+	ClearParticles(&g_Particles, SDL_GetTicks());
+
+	StateStruct temp;
+	temp.StatePointer = GameWon;
+	g_StateStack.push(temp);
+}
 
-	g_Ball.screen_location.x = WINDOW_WIDTH/2 - g_Ball.screen_location.w/2;
-	g_Ball.screen_location.y = WINDOW_HEIGHT/2 - g_Ball.screen_location.h/2;
+void HandleVersusOver()
+{
+	while ( !g_StateStack.empty() )
+	{
+		g_StateStack.pop();
+	}
 
-	g_Lives = NUM_LIVES;
-	g_NumBlocks = 0;
-	g_Level = 1;
-	InitBlocks();
+	// VersusOver() keeps answering the other player until they've seen the end too //
+	g_VersusEnded = SDL_GetTicks();
 
 	StateStruct temp;
-	temp.StatePointer = GameWon;
+	temp.StatePointer = VersusOver;
 	g_StateStack.push(temp);
 }
 
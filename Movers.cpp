@@ -0,0 +1,324 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Movers.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "Movers.h"
+#include "Simulation.h" // For Block and LevelLayout
+#include "LevelGen.h"   // For NextRandom()
+#include "Timing.h"     // For GetMicroseconds()
+
+// sin() times 1024 at each of the MOVER_STEPS places around a circle. It's a //
+// table so every machine moves the blocks the same, and replays stay in sync. //
+static const Sint16 g_MoverSine[MOVER_STEPS] =
+{
+	    0,   100,   200,   297,   392,   483,   569,   650,
+	  724,   792,   851,   903,   946,   980,  1004,  1019,
+	 1024,  1019,  1004,   980,   946,   903,   851,   792,
+	  724,   650,   569,   483,   392,   297,   200,   100,
+	    0,  -100,  -200,  -297,  -392,  -483,  -569,  -650,
+	 -724,  -792,  -851,  -903,  -946,  -980, -1004, -1019,
+	-1024, -1019, -1004,  -980,  -946,  -903,  -851,  -792,
+	 -724,  -650,  -569,  -483,  -392,  -297,  -200,  -100,
+};
+
+// Which of its places a mover is at on a tick. Places are spread evenly over the period. //
+static inline int GetMoverStep(const MoverSchedule* schedule, const BlockMover& mover, int tick)
+{
+	return (tick - schedule->start_tick + mover.phase) * MOVER_STEPS / mover.period;
+}
+
+// The first tick after this one that the mover gets to its next place //
+static inline int GetNextMoverTick(const MoverSchedule* schedule, const BlockMover& mover, int tick)
+{
+	int next_step = GetMoverStep(schedule, mover, tick) + 1;
+	return schedule->start_tick - mover.phase + (next_step * mover.period + MOVER_STEPS - 1) / MOVER_STEPS;
+}
+
+// Where the mover's block is on a tick //
+static void PlaceMovedBlock(const MoverSchedule* schedule, const BlockMover& mover, int tick, SDL_Rect* location)
+{
+	int step   = GetMoverStep(schedule, mover, tick) & (MOVER_STEPS - 1);
+	int sine   = g_MoverSine[step];
+	int cosine = g_MoverSine[(step + MOVER_STEPS/4) & (MOVER_STEPS - 1)];
+
+	// Slides go back and forth along a line, orbits round an ellipse //
+	location->x = (Sint16)(mover.home_x + mover.x_range * (mover.type == MOVER_ORBIT ? cosine : sine) / 1024);
+	location->y = (Sint16)(mover.home_y + mover.y_range * sine / 1024);
+}
+
+static void ScheduleMover(MoverSchedule* schedule, int index)
+{
+	BlockMover& mover = schedule->movers[index];
+	int         slot  = mover.next_tick % MOVER_WHEEL_SIZE;
+
+	mover.next = schedule->wheel[slot];
+	schedule->wheel[slot] = (Sint16)index;
+}
+
+void InitMovers(MoverSchedule* schedule, const LevelLayout* layout, Block* blocks, int tick)
+{
+	schedule->num_movers = 0;
+	schedule->start_tick = tick;
+	schedule->steps      = 0;
+	for (int i=0; i < MOVER_WHEEL_SIZE; i++)
+		schedule->wheel[i] = -1;
+
+	// A block only follows the first line of the script that moves it //
+	bool moved[NUM_ROWS * NUM_COLS];
+	memset(moved, 0, sizeof(moved));
+
+	for (int m=0; m < layout->num_moves; m++)
+	{
+		const MoverScript& script = layout->moves[m];
+
+		int first_col = script.type == MOVER_SLIDE ? 0 : script.col;
+		int last_col  = script.type == MOVER_SLIDE ? NUM_COLS - 1 : script.col;
+
+		for (int col = first_col; col <= last_col; col++)
+		{
+			int block = script.row * NUM_COLS + col;
+			if (moved[block] || blocks[block].num_hits == 0 || schedule->num_movers == MAX_MOVERS)
+				continue;
+
+			moved[block] = true;
+
+			BlockMover& mover = schedule->movers[schedule->num_movers];
+			mover.block   = (Sint16)block;
+			mover.type    = (Sint16)script.type;
+			mover.home_x  = blocks[block].screen_location.x;
+			mover.home_y  = blocks[block].screen_location.y;
+			mover.x_range = (Sint16)script.x_range;
+			mover.y_range = (Sint16)script.y_range;
+			mover.period  = script.period;
+			mover.phase   = script.phase;
+
+			PlaceMovedBlock(schedule, mover, tick, &blocks[block].screen_location);
+			mover.next_tick = GetNextMoverTick(schedule, mover, tick);
+			ScheduleMover(schedule, schedule->num_movers);
+
+			schedule->num_movers++;
+		}
+	}
+}
+
+int StepMovers(MoverSchedule* schedule, int tick, Block* blocks, BlockGrid* grid)
+{
+	if (schedule->num_movers == 0)
+		return 0;
+
+	Uint32 steps = schedule->steps;
+
+	// Take the slot's whole list, so movers put back in it aren't seen twice //
+	int slot  = tick % MOVER_WHEEL_SIZE;
+	int index = schedule->wheel[slot];
+	schedule->wheel[slot] = -1;
+
+	while (index >= 0)
+	{
+		BlockMover& mover = schedule->movers[index];
+		int         next  = mover.next;
+		Block&      block = blocks[mover.block];
+
+		// A destroyed block's mover is dropped for good //
+		if (block.num_hits > 0)
+		{
+			if (mover.next_tick <= tick)
+			{
+				PlaceMovedBlock(schedule, mover, tick, &block.screen_location);
+				MoveGridBlock(grid, mover.block, block.screen_location);
+				mover.next_tick = GetNextMoverTick(schedule, mover, tick);
+				schedule->steps++;
+			}
+
+			ScheduleMover(schedule, index);
+		}
+
+		index = next;
+	}
+
+	return (int)(schedule->steps - steps);
+}
+
+// A level that keeps every block of a board moving: three sliding rows, and //
+// blocks going round in the other three, each board a little different      //
+static void MakeBenchLayout(LevelLayout* layout, int board)
+{
+	memset(layout, 0, sizeof(LevelLayout));
+
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+		layout->hits[i] = MAX_HITS;
+
+	for (int row=0; row < NUM_ROWS; row += 2)
+	{
+		MoverScript& slide = layout->moves[layout->num_moves++];
+		slide.type    = MOVER_SLIDE;
+		slide.row     = row;
+		slide.col     = 0;
+		slide.x_range = BLOCK_WIDTH / 2;
+		slide.y_range = row == 2 ? BLOCK_HEIGHT / 2 : 0;
+		slide.period  = 90 + row * 20 + board;
+		slide.phase   = board * 7;
+	}
+
+	for (int row=1; row < NUM_ROWS; row += 2)
+	{
+		for (int col = (row / 2) % 2; col < NUM_COLS && layout->num_moves < MAX_LEVEL_MOVES; col += 2)
+		{
+			MoverScript& orbit = layout->moves[layout->num_moves++];
+			orbit.type    = MOVER_ORBIT;
+			orbit.row     = row;
+			orbit.col     = col;
+			orbit.x_range = BLOCK_WIDTH / 4;
+			orbit.y_range = BLOCK_HEIGHT;
+			orbit.period  = 60 + col * 15 + board * 3;
+			orbit.phase   = board * 5 + col * 3;
+		}
+	}
+}
+
+// What moving blocks cost without the schedule and grid: every mover is //
+// placed and every block refiled, every tick                            //
+static void StepEveryMover(GameState* state, int tick)
+{
+	MoverSchedule& schedule = state->movers;
+
+	for (int i=0; i < schedule.num_movers; i++)
+	{
+		const BlockMover& mover = schedule.movers[i];
+		if (state->blocks[mover.block].num_hits > 0)
+			PlaceMovedBlock(&schedule, mover, tick, &state->blocks[mover.block].screen_location);
+	}
+
+	ClearBlockGrid(&state->grid);
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		if (state->blocks[i].num_hits > 0)
+			InsertGridBlock(&state->grid, i, state->blocks[i].screen_location);
+	}
+}
+
+static bool CheckRectsTouch(const SDL_Rect& a, const SDL_Rect& b)
+{
+	return (a.x <= b.x + b.w) && (b.x <= a.x + a.w) &&
+	       (a.y <= b.y + b.h) && (b.y <= a.y + a.h);
+}
+
+static LevelLayout g_BenchLayouts[MOVERBENCH_BOARDS];
+static GameState   g_BenchBoards[MOVERBENCH_BOARDS];
+static GameState   g_BenchNaive[MOVERBENCH_BOARDS];
+static SDL_Rect    g_BenchBalls[MOVERBENCH_QUERIES];
+
+int RunMoverBench()
+{
+	int num_movers = 0;
+	for (int b=0; b < MOVERBENCH_BOARDS; b++)
+	{
+		MakeBenchLayout(&g_BenchLayouts[b], b);
+		InitGameState(&g_BenchBoards[b], &g_BenchLayouts[b], 1, 1);
+		g_BenchNaive[b] = g_BenchBoards[b];
+		num_movers += g_BenchBoards[b].movers.num_movers;
+	}
+
+	// Moving the blocks: the schedule, then everything every tick, checking //
+	// after each tick that they put every block in the same place and cell  //
+	Uint64 schedule_time = 0;
+	Uint64 naive_time    = 0;
+	int    mismatches    = 0;
+
+	for (int tick=1; tick <= MOVERBENCH_TICKS; tick++)
+	{
+		Uint64 start = GetMicroseconds();
+		for (int b=0; b < MOVERBENCH_BOARDS; b++)
+			StepMovers(&g_BenchBoards[b].movers, tick, g_BenchBoards[b].blocks, &g_BenchBoards[b].grid);
+		schedule_time += GetMicroseconds() - start;
+
+		start = GetMicroseconds();
+		for (int b=0; b < MOVERBENCH_BOARDS; b++)
+			StepEveryMover(&g_BenchNaive[b], tick);
+		naive_time += GetMicroseconds() - start;
+
+		for (int b=0; b < MOVERBENCH_BOARDS; b++)
+		{
+			for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+			{
+				const SDL_Rect& a = g_BenchBoards[b].blocks[i].screen_location;
+				const SDL_Rect& n = g_BenchNaive[b].blocks[i].screen_location;
+				if ( a.x != n.x || a.y != n.y || g_BenchBoards[b].grid.cells[i] != g_BenchNaive[b].grid.cells[i] )
+				{
+					if (mismatches < 10)
+						printf("board %d block %d is in the wrong place on tick %d\n", b, i, tick);
+					mismatches++;
+				}
+			}
+		}
+	}
+
+	Uint32 steps   = 0;
+	Uint32 refiles = 0;
+	for (int b=0; b < MOVERBENCH_BOARDS; b++)
+	{
+		steps   += g_BenchBoards[b].movers.steps;
+		refiles += g_BenchBoards[b].grid.refiles;
+	}
+
+	// Finding what a ball touches, on the last tick's boards //
+	Uint32 seed = 0x2545F491;
+	for (int i=0; i < MOVERBENCH_QUERIES; i++)
+	{
+		g_BenchBalls[i].x = (Sint16)(NextRandom(&seed) % (WINDOW_WIDTH - BALL_DIAMETER));
+		g_BenchBalls[i].y = (Sint16)(NextRandom(&seed) % (PLAYER_Y - BALL_DIAMETER));
+		g_BenchBalls[i].w = BALL_DIAMETER;
+		g_BenchBalls[i].h = BALL_DIAMETER;
+	}
+
+	int grid_touching = 0, grid_candidates = 0;
+	Uint64 start = GetMicroseconds();
+	for (int i=0; i < MOVERBENCH_QUERIES; i++)
+	{
+		const GameState& board = g_BenchBoards[i % MOVERBENCH_BOARDS];
+
+		int found[GRID_MAX_FOUND];
+		int num_found = QueryBlockGrid(&board.grid, g_BenchBalls[i], found, GRID_MAX_FOUND);
+		grid_candidates += num_found;
+		for (int f=0; f < num_found; f++)
+			grid_touching += CheckRectsTouch(g_BenchBalls[i], board.blocks[found[f]].screen_location);
+	}
+	Uint64 grid_time = GetMicroseconds() - start;
+
+	int all_touching = 0;
+	start = GetMicroseconds();
+	for (int i=0; i < MOVERBENCH_QUERIES; i++)
+	{
+		const GameState& board = g_BenchBoards[i % MOVERBENCH_BOARDS];
+
+		for (int b=0; b < NUM_ROWS * NUM_COLS; b++)
+		{
+			if (board.blocks[b].num_hits > 0)
+				all_touching += CheckRectsTouch(g_BenchBalls[i], board.blocks[b].screen_location);
+		}
+	}
+	Uint64 all_time = GetMicroseconds() - start;
+
+	if (grid_touching != all_touching)
+	{
+		printf("the grid found %d blocks touching, looking at all of them found %d\n", grid_touching, all_touching);
+		mismatches++;
+	}
+
+	double block_ticks = (double)num_movers * MOVERBENCH_TICKS;
+	printf("%d boards, %d moving blocks, %d ticks\n", MOVERBENCH_BOARDS, num_movers, MOVERBENCH_TICKS);
+	printf("schedule:     %8.2f ms  %6.2f ns per block a tick, %u moves (%.0f%% of ticks), %u refiled\n",
+	       schedule_time / 1000.0, schedule_time * 1000.0 / block_ticks, steps, steps * 100.0 / block_ticks, refiles);
+	printf("every block:  %8.2f ms  %6.2f ns per block a tick\n",
+	       naive_time / 1000.0, naive_time * 1000.0 / block_ticks);
+	printf("%d balls: grid %.1f ns looking at %.2f blocks each, all blocks %.1f ns; %d touching\n",
+	       MOVERBENCH_QUERIES, grid_time * 1000.0 / MOVERBENCH_QUERIES, (double)grid_candidates / MOVERBENCH_QUERIES,
+	       all_time * 1000.0 / MOVERBENCH_QUERIES, grid_touching);
+
+	printf("%s: %d disagreements\n", mismatches ? "FAILED" : "PASSED", mismatches);
+
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Movers.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h"   // For Sint16 and Uint32
+#include "Defines.h"   // Our defines header
+#include "Enums.h"     // For MoverType
+#include "BlockGrid.h" // For BlockGrid
+
+struct Block;
+struct LevelLayout;
+
+// One line of a level's script, see LoadLevelFile() //
+struct MoverScript
+{
+	int type;      // MoverType
+	int row;
+	int col;       // unused by MOVER_SLIDE, which moves the whole row
+	int x_range;   // pixels the block goes to either side of its place in the grid
+	int y_range;
+	int period;    // ticks to go all the way along the path and back
+	int phase;     // ticks into the path the level starts at
+};
+
+// A block being moved by a script. Its path is MOVER_STEPS places, and it //
+// only moves when the next one is due.                                    //
+struct BlockMover
+{
+	Sint16 block;
+	Sint16 type;             // MoverType
+	Sint16 home_x;           // the block's place in the grid, the middle of its path
+	Sint16 home_y;
+	Sint16 x_range;
+	Sint16 y_range;
+	int    period;
+	int    phase;
+	int    next_tick;        // when it next moves
+	Sint16 next;             // next mover waiting in the same slot of the wheel, -1 for none
+};
+
+// The movers of the current level. Each one waits in a timing wheel, a   //
+// slot per tick, until its block's next move, so a tick only looks at the //
+// movers that move on it. Movers waiting longer than MOVER_WHEEL_SIZE     //
+// ticks stay where they are when their slot comes round early.            //
+struct MoverSchedule
+{
+	BlockMover movers[MAX_MOVERS];
+	int        num_movers;
+	int        start_tick;               // the tick the level started on
+	Sint16     wheel[MOVER_WHEEL_SIZE];  // first mover waiting in each slot, -1 for none
+	Uint32     steps;                    // moves made, for -moverbench
+};
+
+// Makes a mover for every standing block the layout's script moves, and puts //
+// those blocks where the script has them at the given tick. The blocks have   //
+// to be filed in the grid afterwards.                                         //
+void InitMovers(MoverSchedule* schedule, const LevelLayout* layout, Block* blocks, int tick);
+
+// Moves the blocks due to move this tick, refiling them in the grid. It has to //
+// be called every tick after InitMovers(). Destroyed blocks stop being moved.  //
+// Returns how many blocks it moved.                                           //
+int StepMovers(MoverSchedule* schedule, int tick, Block* blocks, BlockGrid* grid);
+
+// Times the schedule and grid against moving every block and refiling them //
+// all every tick, over MOVERBENCH_BOARDS boards full of moving blocks, and  //
+// checks the two always agree                                               //
+int RunMoverBench();
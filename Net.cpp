@@ -0,0 +1,169 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Net.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "Net.h"
+#include "LevelGen.h" // For NextRandom()
+
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#include <ws2tcpip.h>
+#define CloseNetHandle closesocket
+#else
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define INVALID_SOCKET -1
+#define CloseNetHandle close
+#endif
+
+bool NetOpen(NetSocket* socket, int local_port, const char* remote_host, int remote_port)
+{
+	memset(socket, 0, sizeof(NetSocket));
+	socket->handle      = INVALID_SOCKET;
+	socket->random_seed = 0x9E3779B9u ^ local_port;  // never zero
+
+#ifdef _WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+		return false;
+#endif
+
+	socket->handle = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (socket->handle == INVALID_SOCKET)
+	{
+		NetClose(socket);
+		return false;
+	}
+
+	sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family      = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port        = htons((unsigned short)local_port);
+
+	// Look up where we're sending to //
+	hostent* host = gethostbyname(remote_host);
+
+	if ( !host || bind(socket->handle, (sockaddr*)&local, sizeof(local)) != 0 )
+	{
+		NetClose(socket);
+		return false;
+	}
+
+	socket->remote.sin_family = AF_INET;
+	socket->remote.sin_port   = htons((unsigned short)remote_port);
+	memcpy(&socket->remote.sin_addr, host->h_addr_list[0], sizeof(socket->remote.sin_addr));
+
+	// The game can't wait on the network, so never block //
+#ifdef _WIN32
+	u_long non_blocking = 1;
+	ioctlsocket(socket->handle, FIONBIO, &non_blocking);
+#else
+	fcntl(socket->handle, F_SETFL, fcntl(socket->handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+	return true;
+}
+
+void NetClose(NetSocket* socket)
+{
+	if (socket->handle != INVALID_SOCKET)
+		CloseNetHandle(socket->handle);
+	socket->handle = INVALID_SOCKET;
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+void NetSetConditions(NetSocket* socket, int latency, int jitter, int loss_percent)
+{
+	socket->latency      = latency;
+	socket->jitter       = jitter;
+	socket->loss_percent = loss_percent;
+}
+
+void NetSend(NetSocket* socket, const Uint8* data, int size, Uint32 now)
+{
+	if (size > NET_MAX_PACKET)
+		return;
+
+	// Throw away packets to fake a lossy network //
+	if ( socket->loss_percent > 0 &&
+		 (int)(NextRandom(&socket->random_seed) % 100) < socket->loss_percent )
+	{
+		socket->packets_dropped++;
+		return;
+	}
+
+	// A full queue acts like a congested router and drops the packet //
+	if (socket->queue_count == NET_DELAY_QUEUE_SIZE)
+	{
+		socket->packets_dropped++;
+		return;
+	}
+
+	DelayedPacket& packet = socket->queue[socket->queue_count++];
+	packet.send_time = now + socket->latency;
+	if (socket->jitter > 0)
+		packet.send_time += NextRandom(&socket->random_seed) % (socket->jitter + 1);
+	packet.size = size;
+	memcpy(packet.data, data, size);
+
+	NetFlush(socket, now);
+}
+
+void NetFlush(NetSocket* socket, Uint32 now)
+{
+	// Send everything that's due, keeping the rest in order. With jitter //
+	// packets can overtake each other, just like on a real network.      //
+	int kept = 0;
+	for (int i=0; i < socket->queue_count; i++)
+	{
+		DelayedPacket& packet = socket->queue[i];
+
+		if ( (Sint32)(now - packet.send_time) >= 0 )
+		{
+			sendto(socket->handle, (const char*)packet.data, packet.size, 0,
+			       (sockaddr*)&socket->remote, sizeof(socket->remote));
+			socket->packets_sent++;
+		}
+		else
+		{
+			if (kept != i)
+				socket->queue[kept] = packet;
+			kept++;
+		}
+	}
+	socket->queue_count = kept;
+}
+
+int NetReceive(NetSocket* socket, Uint8* buffer, int size)
+{
+	for (;;)
+	{
+		sockaddr_in from;
+#ifdef _WIN32
+		int from_size = sizeof(from);
+#else
+		socklen_t from_size = sizeof(from);
+#endif
+		int received = recvfrom(socket->handle, (char*)buffer, size, 0, (sockaddr*)&from, &from_size);
+
+		if (received <= 0)
+			return 0;
+
+		// Ignore anyone but the machine we're playing against //
+		if ( from.sin_port != socket->remote.sin_port ||
+			 memcmp(&from.sin_addr, &socket->remote.sin_addr, sizeof(from.sin_addr)) != 0 )
+			continue;
+
+		socket->packets_received++;
+		return received;
+	}
+}
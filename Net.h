@@ -0,0 +1,60 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Net.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For Uint8/Uint32
+#include "Defines.h" // Our defines header
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET NetHandle;
+#else
+#include <netinet/in.h>
+typedef int NetHandle;
+#endif
+
+// A packet held back by the latency injector until its send time comes //
+struct DelayedPacket
+{
+	Uint32 send_time;
+	int    size;
+	Uint8  data[NET_MAX_PACKET];
+};
+
+// A UDP socket talking to one other machine. Outgoing packets can be delayed //
+// and dropped on purpose, to test how the game copes with a bad network.    //
+struct NetSocket
+{
+	NetHandle   handle;
+	sockaddr_in remote;
+
+	// Artificial network conditions //
+	int    latency;        // milliseconds added to every packet
+	int    jitter;         // up to this many more milliseconds, at random
+	int    loss_percent;   // chance of a packet being thrown away
+	Uint32 random_seed;
+
+	DelayedPacket queue[NET_DELAY_QUEUE_SIZE];
+	int           queue_count;
+
+	// Counters //
+	int packets_sent;
+	int packets_dropped;
+	int packets_received;
+};
+
+// Opens a non-blocking socket on local_port that sends to remote_host:remote_port //
+bool NetOpen(NetSocket* socket, int local_port, const char* remote_host, int remote_port);
+void NetClose(NetSocket* socket);
+
+// Sets the artificial latency, jitter and loss for packets we send //
+void NetSetConditions(NetSocket* socket, int latency, int jitter, int loss_percent);
+
+// Queues a packet. It goes out from NetFlush() once its delay has passed. //
+void NetSend(NetSocket* socket, const Uint8* data, int size, Uint32 now);
+void NetFlush(NetSocket* socket, Uint32 now);
+
+// Returns the size of the next waiting packet from the remote machine, or 0 //
+int  NetReceive(NetSocket* socket, Uint8* buffer, int size);
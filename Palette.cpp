@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Palette.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "Palette.h"
+
+// The blocks, the HUD green, sparks and power-ups //
+static const SDL_Color g_GameColors[] =
+{
+	{  66, 239,  16, 0 },
+	{ 254,   0,   0, 0 },
+	{   0, 152,   0, 0 },
+	{   0,   0, 253, 0 },
+	{ 254, 254,   0, 0 },
+	{ 255, 230,  80, 0 },
+	{ 255, 200,   0, 0 }
+};
+
+static void SetColor(SDL_Color* color, int r, int g, int b)
+{
+	color->r = (Uint8)r;
+	color->g = (Uint8)g;
+	color->b = (Uint8)b;
+	color->unused = 0;
+}
+
+void BuildGamePalette(SDL_Color* colors)
+{
+	int count = 0;
+
+	// Black, white and magenta (the transparent color) are all in the cube //
+	for (int r=0; r < 6; r++)
+		for (int g=0; g < 6; g++)
+			for (int b=0; b < 6; b++)
+				SetColor(&colors[count++], r * 51, g * 51, b * 51);
+
+	for (int i=0; i < (int)(sizeof(g_GameColors) / sizeof(g_GameColors[0])); i++)
+		colors[count++] = g_GameColors[i];
+
+	// Text is drawn on black, so its edges are darker shades of it //
+	const SDL_Color& green = g_GameColors[0];
+	for (int i=1; i <= PALETTE_TEXT_SHADES; i++)
+	{
+		SetColor(&colors[count++], green.r * i / (PALETTE_TEXT_SHADES + 1),
+		         green.g * i / (PALETTE_TEXT_SHADES + 1), green.b * i / (PALETTE_TEXT_SHADES + 1));
+	}
+
+	// Grays for white text fill the rest //
+	int grays = 256 - count;
+	for (int i=1; i <= grays; i++)
+	{
+		int gray = 255 * i / (grays + 1);
+		SetColor(&colors[count++], gray, gray, gray);
+	}
+}
+
+SDL_Surface* CreateIndexedSurface(int width, int height)
+{
+	SDL_Surface* surface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, 8, 0, 0, 0, 0);
+	if (!surface)
+		return NULL;
+
+	SDL_Color colors[256];
+	BuildGamePalette(colors);
+	SDL_SetColors(surface, colors, 0, 256);
+
+	return surface;
+}
@@ -0,0 +1,15 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Palette.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Surface and SDL_Color
+#include "Defines.h" // Our defines header
+
+// Fills in the 256 colors every 8-bit frame uses: a 6x6x6 color cube, the //
+// colors the game draws most, exactly, then shades for antialiased text.  //
+void BuildGamePalette(SDL_Color* colors);
+
+// Makes an 8-bit surface with the game's palette, or returns NULL //
+SDL_Surface* CreateIndexedSurface(int width, int height);
@@ -0,0 +1,609 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    ParSolver.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ParSolver.h"
+#include "Atomic.h"     // For AtomicAdd()
+#include "Timing.h"     // For GetMicroseconds()
+
+// Where the search is: the start of the tick the ball comes down to the //
+// paddle on, and the hits that got it there                             //
+struct SolverNode
+{
+	GameState state;
+	int       last_hit;    // the tick of the last paddle hit, or of the launch
+	int       bound;       // the level can't be cleared before this tick
+	int       num_hits;
+	ParHit    hits[SOLVER_MAX_HITS];
+};
+
+// The nodes one thread is working through. The owner pushes and pops at //
+// the end, so it goes depth first; thieves take from the beginning,     //
+// where the nodes closest to the root, with the most work under them, are. //
+struct SolverDeque
+{
+	SDL_mutex*  lock;
+	SolverNode* nodes;   // SOLVER_DEQUE_SIZE of them
+	int         begin;
+	int         end;
+};
+
+// The fewest ticks a state has been reached in //
+struct SolverEntry
+{
+	Uint64 key;
+	int    ticks;
+};
+
+struct ParSearch
+{
+	const LevelLayout* layout;
+	int                max_nodes;
+
+	SolverDeque        deques[NUM_WORKER_THREADS];
+	SolverEntry*       table;                           // SOLVER_TABLE_SIZE entries
+	SDL_mutex*         table_locks[SOLVER_TABLE_LOCKS]; // each covers every SOLVER_TABLE_LOCKS'th entry
+
+	SDL_mutex*         best_lock;
+	ParSolution*       best;
+	volatile int       best_ticks;   // what a node has to beat, best->ticks once there is one
+
+	volatile int       pending;      // nodes pushed and not yet searched from
+	volatile int       expanded;
+	volatile int       stopped;      // max_nodes was reached
+
+	volatile int       duplicates;
+	volatile int       pruned;
+	volatile int       steals;
+	volatile int       dropped;
+};
+
+// Each thread's own space for the node it's on and the ones that come from it //
+struct SolverWorker
+{
+	ParSearch*  search;
+	int         id;
+	SolverNode* node;
+	SolverNode* children;   // SOLVER_MAX_CHOICES of them
+};
+
+// Everything about a state that changes how the rest of the level goes: the //
+// ball, the paddle (where it is, and how long it's had to move since the    //
+// last hit, which is how far it can get) and the blocks. Power-ups and      //
+// scores don't, and neither does the tick, unless blocks move with it.     //
+static Uint64 HashSolverState(const GameState* state, int last_hit)
+{
+	Uint64 hash = 14695981039346656037ull;
+	const Ball& ball = state->ball;
+
+	int values[6] = { ball.screen_location.x, ball.screen_location.y, ball.x_speed, ball.y_speed,
+	                  state->players[0].screen_location.x, state->ticks - last_hit };
+	for (int i=0; i < 6; i++)
+		hash = (hash ^ (Uint32)values[i]) * 1099511628211ull;
+
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+		hash = (hash ^ (Uint32)state->blocks[i].num_hits) * 1099511628211ull;
+
+	if (state->movers.num_movers > 0)
+		hash = (hash ^ (Uint32)state->ticks) * 1099511628211ull;
+
+	// Spread the low bits, which pick the table entry //
+	hash ^= hash >> 29;
+	hash *= 0xBF58476D1CE4E5B9ull;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+// Returns false if the state has been reached in as few ticks before, //
+// otherwise remembers this as the fastest                             //
+static bool CheckSolverTable(ParSearch* search, const GameState* state, int last_hit)
+{
+	Uint64 key   = HashSolverState(state, last_hit);
+	int    index = (int)(key & (SOLVER_TABLE_SIZE - 1));
+
+	SDL_mutex* lock = search->table_locks[index % SOLVER_TABLE_LOCKS];
+	SDL_mutexP(lock);
+
+	SolverEntry& entry = search->table[index];
+	bool better = (entry.key != key || state->ticks < entry.ticks);
+	if (better)
+	{
+		entry.key   = key;
+		entry.ticks = state->ticks;
+	}
+
+	SDL_mutexV(lock);
+
+	return better;
+}
+
+enum SolverAdvance
+{
+	ADVANCE_AT_PADDLE,   // the ball gets low enough to hit the paddle this tick
+	ADVANCE_CLEARED,
+	ADVANCE_FAILED       // the ball got past, or it's too late to beat limit
+};
+
+// Plays ticks with the paddle left where it is until the ball comes down to it //
+static int AdvanceToPaddle(GameState* state, int limit)
+{
+	for (;;)
+	{
+		if (state->result == RESULT_WON)
+			return ADVANCE_CLEARED;
+		if (state->result != RESULT_PLAYING || state->ticks >= limit)
+			return ADVANCE_FAILED;
+
+		// Where MoveBall() will put the bottom of the ball. Only touching the //
+		// paddle's edge doesn't overlap any pixels, so that's too early.     //
+		const Ball& ball   = state->ball;
+		int         bottom = ball.screen_location.y + ball.y_speed + ball.screen_location.h;
+		if ( ball.y_speed > 0 && bottom > PLAYER_Y && bottom <= PLAYER_Y + PADDLE_HEIGHT )
+			return ADVANCE_AT_PADDLE;
+
+		StepSimulation(state, INPUT_NONE);
+
+		for (int i=0; i < state->num_events; i++)
+		{
+			if (state->events[i].type == EVENT_LIFE_LOST)
+				return ADVANCE_FAILED;
+		}
+	}
+}
+
+// The ball has to get from the paddle back up to the lowest block at least //
+// once more before the level can be cleared                                //
+static int GetLowerBound(const GameState* state)
+{
+	if (state->movers.num_movers > 0)
+		return state->ticks + 1;
+
+	int lowest = -1;
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		const Block& block = state->blocks[i];
+		if (block.num_hits > 0 && block.screen_location.y + block.screen_location.h > lowest)
+			lowest = block.screen_location.y + block.screen_location.h;
+	}
+
+	int distance = state->ball.screen_location.y - lowest;
+	return state->ticks + 1 + (distance > 0 ? distance / BALL_SPEED_Y : 0);
+}
+
+static void ReportSolution(ParSearch* search, const SolverNode* node)
+{
+	SDL_mutexP(search->best_lock);
+
+	ParSolution* best = search->best;
+	if (best->ticks == 0 || node->state.ticks < best->ticks)
+	{
+		best->ticks    = node->state.ticks;
+		best->num_hits = node->num_hits;
+		memcpy(best->hits, node->hits, node->num_hits * sizeof(ParHit));
+		AtomicStore(&search->best_ticks, node->state.ticks);
+	}
+
+	SDL_mutexV(search->best_lock);
+}
+
+static void PushNode(ParSearch* search, int id, const SolverNode* node)
+{
+	SolverDeque& deque = search->deques[id];
+
+	SDL_mutexP(deque.lock);
+
+	// Slide everything back down if thieves have emptied the beginning //
+	if (deque.end == SOLVER_DEQUE_SIZE && deque.begin > 0)
+	{
+		memmove(deque.nodes, deque.nodes + deque.begin, (deque.end - deque.begin) * sizeof(SolverNode));
+		deque.end  -= deque.begin;
+		deque.begin = 0;
+	}
+
+	bool pushed = deque.end < SOLVER_DEQUE_SIZE;
+	if (pushed)
+	{
+		deque.nodes[deque.end++] = *node;
+		AtomicAdd(&search->pending, 1);
+	}
+
+	SDL_mutexV(deque.lock);
+
+	if (!pushed)
+		AtomicAdd(&search->dropped, 1);
+}
+
+static bool PopNode(SolverDeque* deque, SolverNode* node)
+{
+	SDL_mutexP(deque->lock);
+
+	bool popped = deque->end > deque->begin;
+	if (popped)
+		*node = deque->nodes[--deque->end];
+	if (deque->end == deque->begin)
+		deque->begin = deque->end = 0;
+
+	SDL_mutexV(deque->lock);
+
+	return popped;
+}
+
+static bool StealNode(ParSearch* search, int id, SolverNode* node)
+{
+	for (int i=1; i < NUM_WORKER_THREADS; i++)
+	{
+		SolverDeque& victim = search->deques[(id + i) % NUM_WORKER_THREADS];
+
+		SDL_mutexP(victim.lock);
+
+		bool stolen = victim.end > victim.begin;
+		if (stolen)
+			*node = victim.nodes[victim.begin++];
+		if (victim.end == victim.begin)
+			victim.begin = victim.end = 0;
+
+		SDL_mutexV(victim.lock);
+
+		if (stolen)
+		{
+			AtomicAdd(&search->steals, 1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Rounds towards minus infinity, unlike / //
+static inline int FloorDivide(int a, int b)
+{
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// Tries every spot the paddle can meet the ball at, follows each different //
+// bounce to where the ball next comes down, and pushes the ones worth      //
+// searching from, the most promising last so they're searched first.       //
+static void ExpandNode(SolverWorker* worker)
+{
+	ParSearch*        search = worker->search;
+	const SolverNode& node   = *worker->node;
+	const GameState&  state  = node.state;
+
+	int paddle_x = state.players[0].screen_location.x;
+	int reach    = (state.ticks - node.last_hit) * PLAYER_SPEED;
+	int ball_x   = state.ball.screen_location.x + state.ball.x_speed;
+
+	// The paddle can only stop every PLAYER_SPEED pixels from where it was. //
+	// A wall can turn the ball around on the way, hence the extra room.    //
+	int margin = abs(state.ball.x_speed);
+	int left   = ball_x - PADDLE_WIDTH - margin;
+	int right  = ball_x + BALL_DIAMETER + margin;
+	if (left < paddle_x - reach)
+		left = paddle_x - reach;
+	if (left < 0)
+		left = 0;
+	if (right > paddle_x + reach)
+		right = paddle_x + reach;
+	if (right > WINDOW_WIDTH)
+		right = WINDOW_WIDTH;
+
+	int first = -FloorDivide(paddle_x - left, PLAYER_SPEED);
+	int last  = FloorDivide(right - paddle_x, PLAYER_SPEED);
+	int home  = WINDOW_WIDTH / 2 - PADDLE_WIDTH / 2;
+
+	int num_children = 0;
+	for (int step = first; step <= last && num_children < SOLVER_MAX_CHOICES; step++)
+	{
+		int x = paddle_x + step * PLAYER_SPEED;
+
+		SolverNode& child = worker->children[num_children];
+		child.state = state;
+		child.state.players[0].screen_location.x = (Sint16)x;
+		StepSimulation(&child.state, INPUT_NONE);
+
+		bool hit = false;
+		for (int i=0; i < child.state.num_events; i++)
+		{
+			if (child.state.events[i].type == EVENT_PADDLE_HIT)
+				hit = true;
+		}
+		if (!hit)
+			continue;
+
+		// Spots that bounce the ball the same way only differ in where the paddle //
+		// is left, and the middle leaves it the most room for the next hit       //
+		int same = 0;
+		while (same < num_children && worker->children[same].state.ball.x_speed != child.state.ball.x_speed)
+			same++;
+
+		if (same < num_children)
+		{
+			int kept = worker->children[same].state.players[0].screen_location.x;
+			if (abs(x - home) < abs(kept - home))
+				worker->children[same].state = child.state;
+			continue;
+		}
+
+		num_children++;
+	}
+
+	// Follow each bounce down to the paddle again //
+	int order[SOLVER_MAX_CHOICES];
+	int num_kept = 0;
+
+	for (int c=0; c < num_children; c++)
+	{
+		SolverNode& child = worker->children[c];
+		child.last_hit = state.ticks;
+
+		if ( !CheckSolverTable(search, &child.state, child.last_hit) )
+		{
+			AtomicAdd(&search->duplicates, 1);
+			continue;
+		}
+
+		if (node.num_hits == SOLVER_MAX_HITS)
+		{
+			AtomicAdd(&search->dropped, 1);
+			continue;
+		}
+
+		child.num_hits = node.num_hits + 1;
+		memcpy(child.hits, node.hits, node.num_hits * sizeof(ParHit));
+		child.hits[node.num_hits].tick     = state.ticks;
+		child.hits[node.num_hits].paddle_x = child.state.players[0].screen_location.x;
+		child.hits[node.num_hits].x_speed  = (Sint16)child.state.ball.x_speed;
+
+		int advance = AdvanceToPaddle(&child.state, AtomicLoad(&search->best_ticks));
+		if (advance == ADVANCE_CLEARED)
+		{
+			ReportSolution(search, &child);
+			continue;
+		}
+		if (advance == ADVANCE_FAILED)
+			continue;
+
+		child.bound = GetLowerBound(&child.state);
+		if ( child.bound >= AtomicLoad(&search->best_ticks) )
+		{
+			AtomicAdd(&search->pruned, 1);
+			continue;
+		}
+
+		// Fewest blocks left first, then soonest //
+		int i = num_kept++;
+		for (; i > 0; i--)
+		{
+			const GameState& other = worker->children[order[i - 1]].state;
+			if ( other.num_blocks < child.state.num_blocks ||
+				 (other.num_blocks == child.state.num_blocks && other.ticks <= child.state.ticks) )
+				break;
+			order[i] = order[i - 1];
+		}
+		order[i] = c;
+	}
+
+	for (int i = num_kept - 1; i >= 0; i--)
+		PushNode(search, worker->id, &worker->children[order[i]]);
+}
+
+static int SolverThread(void* data)
+{
+	SolverWorker* worker = (SolverWorker*)data;
+	ParSearch*    search = worker->search;
+
+	while ( !AtomicLoad(&search->stopped) )
+	{
+		if ( !PopNode(&search->deques[worker->id], worker->node) &&
+			 !StealNode(search, worker->id, worker->node) )
+		{
+			// Nothing to do, but someone else may be about to push more //
+			if (AtomicLoad(&search->pending) == 0)
+				break;
+			SDL_Delay(1);
+			continue;
+		}
+
+		if ( worker->node->bound >= AtomicLoad(&search->best_ticks) )
+			AtomicAdd(&search->pruned, 1);
+		else if ( AtomicAdd(&search->expanded, 1) > search->max_nodes )
+			AtomicStore(&search->stopped, 1);
+		else
+			ExpandNode(worker);
+
+		AtomicAdd(&search->pending, -1);
+	}
+
+	return 0;
+}
+
+void SolveParTime(const LevelLayout* layout, int max_nodes, ParSolution* solution)
+{
+	memset(solution, 0, sizeof(ParSolution));
+	Uint64 start = GetMicroseconds();
+
+	static ParSearch search;
+	memset(&search, 0, sizeof(search));
+	search.layout     = layout;
+	search.max_nodes  = max_nodes;
+	search.best       = solution;
+	search.best_ticks = ESTIMATOR_MAX_TICKS;
+	search.best_lock  = SDL_CreateMutex();
+	search.table      = new SolverEntry[SOLVER_TABLE_SIZE];
+	memset(search.table, 0, SOLVER_TABLE_SIZE * sizeof(SolverEntry));
+	for (int i=0; i < SOLVER_TABLE_LOCKS; i++)
+		search.table_locks[i] = SDL_CreateMutex();
+
+	SolverWorker workers[NUM_WORKER_THREADS];
+	for (int i=0; i < NUM_WORKER_THREADS; i++)
+	{
+		search.deques[i].lock  = SDL_CreateMutex();
+		search.deques[i].nodes = new SolverNode[SOLVER_DEQUE_SIZE];
+
+		workers[i].search   = &search;
+		workers[i].id       = i;
+		workers[i].node     = new SolverNode;
+		workers[i].children = new SolverNode[SOLVER_MAX_CHOICES];
+	}
+
+	// The masks are loaded the first time, which has to happen before the threads start //
+	SolverNode* root = workers[0].node;
+	InitGameState(&root->state, layout, 1, 1);
+	root->num_hits = 0;
+
+	// Launch straight away, then wait for the ball to come down //
+	StepSimulation(&root->state, INPUT_LAUNCH);
+	root->last_hit = root->state.ticks;
+
+	int advance = AdvanceToPaddle(&root->state, search.best_ticks);
+	if (advance == ADVANCE_CLEARED)
+		ReportSolution(&search, root);
+	else if (advance == ADVANCE_AT_PADDLE)
+	{
+		root->bound = GetLowerBound(&root->state);
+		PushNode(&search, 0, root);
+	}
+
+	SDL_Thread* threads[NUM_WORKER_THREADS];
+	for (int i=0; i < NUM_WORKER_THREADS; i++)
+		threads[i] = SDL_CreateThread(SolverThread, &workers[i]);
+
+	for (int i=0; i < NUM_WORKER_THREADS; i++)
+	{
+		// Do a thread's share here if it couldn't be started //
+		if (threads[i])
+			SDL_WaitThread(threads[i], NULL);
+		else
+			SolverThread(&workers[i]);
+	}
+
+	solution->proven       = !search.stopped && search.dropped == 0;
+	solution->nodes        = search.expanded < max_nodes ? search.expanded : max_nodes;
+	solution->duplicates   = search.duplicates;
+	solution->pruned       = search.pruned;
+	solution->steals       = search.steals;
+	solution->dropped      = search.dropped;
+	solution->microseconds = GetMicroseconds() - start;
+
+	for (int i=0; i < NUM_WORKER_THREADS; i++)
+	{
+		SDL_DestroyMutex(search.deques[i].lock);
+		delete [] search.deques[i].nodes;
+		delete workers[i].node;
+		delete [] workers[i].children;
+	}
+	for (int i=0; i < SOLVER_TABLE_LOCKS; i++)
+		SDL_DestroyMutex(search.table_locks[i]);
+	delete [] search.table;
+	SDL_DestroyMutex(search.best_lock);
+}
+
+int GetParInputs(const ParSolution* solution, int* inputs, int max_inputs)
+{
+	int count = solution->ticks < max_inputs ? solution->ticks : max_inputs;
+	int x     = WINDOW_WIDTH / 2 - PADDLE_WIDTH / 2;
+	int hit   = 0;
+
+	for (int tick=0; tick < count; tick++)
+	{
+		// The paddle heads for the next hit as soon as the last one is over //
+		while (hit < solution->num_hits && solution->hits[hit].tick < tick)
+			hit++;
+
+		int input = INPUT_NONE;
+		if (tick == 0)
+			input = INPUT_LAUNCH;
+		else if (hit < solution->num_hits && x < solution->hits[hit].paddle_x)
+		{
+			input = INPUT_RIGHT;
+			x += PLAYER_SPEED;
+		}
+		else if (hit < solution->num_hits && x > solution->hits[hit].paddle_x)
+		{
+			input = INPUT_LEFT;
+			x -= PLAYER_SPEED;
+		}
+
+		inputs[tick] = input;
+	}
+
+	return count;
+}
+
+bool CheckParSolution(const LevelLayout* layout, const ParSolution* solution)
+{
+	if (solution->ticks == 0)
+		return false;
+
+	int* inputs = new int[solution->ticks];
+	int  count  = GetParInputs(solution, inputs, solution->ticks);
+
+	GameState state;
+	InitGameState(&state, layout, 1, 1);
+	for (int tick=0; tick < count && state.result == RESULT_PLAYING; tick++)
+		StepSimulation(&state, inputs[tick]);
+
+	delete [] inputs;
+
+	return state.result == RESULT_WON && state.ticks == solution->ticks;
+}
+
+void PrintParSolution(const char* name, const ParSolution* solution)
+{
+	if (solution->ticks == 0)
+		printf("%s: no way to clear it found", name);
+	else
+		printf("%s: par %d ticks (%.1f seconds), %s", name, solution->ticks,
+		       (double)solution->ticks / FRAMES_PER_SECOND, solution->proven ? "the best there is" :
+		       "only an upper bound, the search ran out before it could rule out faster clears");
+	printf(" after %d hits searched in %.2f s; %d duplicates, %d cut, %d stolen, %d dropped\n",
+	       solution->nodes, solution->microseconds / 1000000.0, solution->duplicates, solution->pruned,
+	       solution->steals, solution->dropped);
+
+	if (solution->ticks == 0)
+		return;
+
+	printf("  hits (tick paddle_x x_speed):");
+	for (int i=0; i < solution->num_hits; i++)
+	{
+		if (i % 6 == 0)
+			printf("\n   ");
+		printf(" %5d %3d %3d,", solution->hits[i].tick, solution->hits[i].paddle_x, solution->hits[i].x_speed);
+	}
+	printf("\n");
+
+	// The inputs in runs: ticks then S(pace), L(eft), R(ight) or - for nothing //
+	int* inputs = new int[solution->ticks];
+	int  count  = GetParInputs(solution, inputs, solution->ticks);
+
+	printf("  inputs:");
+	int runs = 0;
+	for (int tick=0; tick < count; )
+	{
+		int length = 1;
+		while (tick + length < count && inputs[tick + length] == inputs[tick])
+			length++;
+
+		char key = '-';
+		if (inputs[tick] & INPUT_LAUNCH)
+			key = 'S';
+		else if (inputs[tick] & INPUT_LEFT)
+			key = 'L';
+		else if (inputs[tick] & INPUT_RIGHT)
+			key = 'R';
+
+		if (runs++ % 12 == 0)
+			printf("\n   ");
+		printf(" %d%c", length, key);
+
+		tick += length;
+	}
+	printf("\n");
+
+	delete [] inputs;
+}
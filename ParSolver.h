@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////////////
+// ParSolver.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h"    // For Sint16 and Uint64
+#include "Defines.h"    // Our defines header
+#include "Simulation.h" // For LevelLayout
+
+// One paddle hit of a solution //
+struct ParHit
+{
+	int    tick;       // the tick the ball hit the paddle on
+	Sint16 paddle_x;   // where the paddle was
+	Sint16 x_speed;    // what that gave the ball
+};
+
+// The fastest way found to clear a level, and what finding it took //
+struct ParSolution
+{
+	int    ticks;      // ticks to clear the level, 0 if no way was found
+	int    num_hits;
+	ParHit hits[SOLVER_MAX_HITS];
+	bool   proven;     // every choice was searched, so there's nothing faster
+
+	int    nodes;      // paddle hits searched from
+	int    duplicates; // got to a state already reached as fast or faster
+	int    pruned;     // couldn't beat the best so far
+	int    steals;     // nodes taken from another thread's deque
+	int    dropped;    // nodes there was no room for, which makes the search incomplete
+	Uint64 microseconds;
+};
+
+// Searches for the fewest ticks to clear a layout with the game's own physics. //
+// Each time the ball comes down to the paddle, the search branches on where  //
+// the paddle meets it, which sets the ball's x_speed. Only spots the paddle  //
+// can get to from the last hit count, each x_speed is tried once with the    //
+// paddle as near the middle as gives it, and the ball is always caught the   //
+// first tick it's low enough. States reached before are dropped through a    //
+// hashed transposition table, branches that can't beat the best so far are  //
+// cut, and NUM_WORKER_THREADS threads share the work by stealing from each   //
+// other's deques. The search gives up after max_nodes paddle hits.           //
+void SolveParTime(const LevelLayout* layout, int max_nodes, ParSolution* solution);
+
+// Turns a solution into one InputFlags value per tick, and returns how many //
+int  GetParInputs(const ParSolution* solution, int* inputs, int max_inputs);
+
+// Plays a solution's inputs from the start. Returns true if they clear the //
+// level in exactly solution->ticks ticks.                                  //
+bool CheckParSolution(const LevelLayout* layout, const ParSolution* solution);
+
+// Prints the par time, the hits and the inputs that get it //
+void PrintParSolution(const char* name, const ParSolution* solution);
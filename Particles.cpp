@@ -0,0 +1,207 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Particles.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "Particles.h"
+#include "LevelGen.h" // For NextRandom()
+
+// SSE is there on every x86 machine we run on, and always on x64 //
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define PARTICLES_SSE
+#include <xmmintrin.h>
+#endif
+
+void ClearParticles(ParticlePool* pool, Uint32 seed)
+{
+	pool->count       = 0;
+	pool->random_seed = seed ? seed : 1;
+}
+
+void SpawnParticle(ParticlePool* pool, float x, float y, float x_speed, float y_speed, float life, Uint32 color)
+{
+	if (pool->count == MAX_PARTICLES)
+		return;
+
+	int i = pool->count++;
+	pool->x[i]       = x;
+	pool->y[i]       = y;
+	pool->x_speed[i] = x_speed;
+	pool->y_speed[i] = y_speed;
+	pool->life[i]    = life;
+	pool->color[i]   = color;
+}
+
+// Returns a random number from 0 to 1 //
+static float RandomFloat(ParticlePool* pool)
+{
+	return (NextRandom(&pool->random_seed) & 0xFFFF) / 65535.0f;
+}
+
+void SpawnBurst(ParticlePool* pool, const SDL_Rect* rect, int count, float speed,
+                const Uint32* colors, int num_colors)
+{
+	for (int i=0; i < count; i++)
+	{
+		float x = rect->x + RandomFloat(pool) * rect->w;
+		float y = rect->y + RandomFloat(pool) * rect->h;
+
+		// Mostly outwards and up, gravity brings them back down //
+		float x_speed = (RandomFloat(pool) * 2.0f - 1.0f) * speed;
+		float y_speed = (RandomFloat(pool) * 1.5f - 1.0f) * speed;
+		float life    = PARTICLE_LIFE * (0.5f + 0.5f * RandomFloat(pool));
+
+		SpawnParticle(pool, x, y, x_speed, y_speed, life,
+		              colors[NextRandom(&pool->random_seed) % num_colors]);
+	}
+}
+
+// Replaces each dead particle with the one at the end. Going through the //
+// list from the back means the one we move in has already been checked.  //
+static void RetireParticles(ParticlePool* pool, int num_dead)
+{
+	for (int k = num_dead - 1; k >= 0; k--)
+	{
+		int i    = pool->dead[k];
+		int last = --pool->count;
+
+		if (i != last)
+		{
+			pool->x[i]       = pool->x[last];
+			pool->y[i]       = pool->y[last];
+			pool->x_speed[i] = pool->x_speed[last];
+			pool->y_speed[i] = pool->y_speed[last];
+			pool->life[i]    = pool->life[last];
+			pool->color[i]   = pool->color[last];
+		}
+	}
+}
+
+void UpdateParticlesScalar(ParticlePool* pool)
+{
+	int num_dead = 0;
+
+	for (int i=0; i < pool->count; i++)
+	{
+		pool->y_speed[i] += PARTICLE_GRAVITY;
+		pool->x[i]       += pool->x_speed[i];
+		pool->y[i]       += pool->y_speed[i];
+		pool->life[i]    -= 1.0f;
+
+		// Particles die of old age or by leaving the screen (they can come back from the top) //
+		if ( pool->life[i] <= 0.0f || pool->y[i] >= WINDOW_HEIGHT ||
+			 pool->x[i] < 0.0f || pool->x[i] >= WINDOW_WIDTH )
+			pool->dead[num_dead++] = i;
+	}
+
+	RetireParticles(pool, num_dead);
+}
+
+void UpdateParticles(ParticlePool* pool)
+{
+#ifdef PARTICLES_SSE
+	const __m128 gravity = _mm_set1_ps(PARTICLE_GRAVITY);
+	const __m128 one     = _mm_set1_ps(1.0f);
+	const __m128 zero    = _mm_setzero_ps();
+	const __m128 right   = _mm_set1_ps((float)WINDOW_WIDTH);
+	const __m128 bottom  = _mm_set1_ps((float)WINDOW_HEIGHT);
+
+	int num_dead = 0;
+
+	// The last group can run past count, into particles that are already dead. //
+	// MAX_PARTICLES is a multiple of 4, so it never runs off the arrays.       //
+	for (int i=0; i < pool->count; i += 4)
+	{
+		__m128 y_speed = _mm_add_ps(_mm_loadu_ps(pool->y_speed + i), gravity);
+		__m128 x       = _mm_add_ps(_mm_loadu_ps(pool->x + i), _mm_loadu_ps(pool->x_speed + i));
+		__m128 y       = _mm_add_ps(_mm_loadu_ps(pool->y + i), y_speed);
+		__m128 life    = _mm_sub_ps(_mm_loadu_ps(pool->life + i), one);
+
+		_mm_storeu_ps(pool->y_speed + i, y_speed);
+		_mm_storeu_ps(pool->x + i, x);
+		_mm_storeu_ps(pool->y + i, y);
+		_mm_storeu_ps(pool->life + i, life);
+
+		__m128 dead = _mm_or_ps( _mm_or_ps(_mm_cmple_ps(life, zero), _mm_cmpge_ps(y, bottom)),
+		                         _mm_or_ps(_mm_cmplt_ps(x, zero),    _mm_cmpge_ps(x, right)) );
+
+		int mask = _mm_movemask_ps(dead);
+		for (int lane=0; mask != 0; lane++, mask >>= 1)
+		{
+			if ( (mask & 1) && i + lane < pool->count )
+				pool->dead[num_dead++] = i + lane;
+		}
+	}
+
+	RetireParticles(pool, num_dead);
+#else
+	UpdateParticlesScalar(pool);
+#endif
+}
+
+void DrawParticles(const ParticlePool* pool, SDL_Surface* surface, const Viewport* viewport)
+{
+	if (pool->count == 0)
+		return;
+
+	if ( SDL_MUSTLOCK(surface) )
+		SDL_LockSurface(surface);
+
+	SDL_Rect everything = { 0, 0, (Uint16)surface->w, (Uint16)surface->h };
+	PlotParticles(pool, surface, viewport, everything);
+
+	if ( SDL_MUSTLOCK(surface) )
+		SDL_UnlockSurface(surface);
+}
+
+void PlotParticles(const ParticlePool* pool, SDL_Surface* surface, const Viewport* viewport,
+                   const SDL_Rect& clip)
+{
+	int size = ScaleSize(viewport, PARTICLE_SIZE);
+	if (size < 1)
+		size = 1;
+
+	int    bytes_per_pixel = surface->format->BytesPerPixel;
+	int    max_x           = surface->w - size;
+	int    max_y           = surface->h - size;
+	Uint8* pixels          = (Uint8*)surface->pixels;
+
+	int clip_right  = clip.x + clip.w;
+	int clip_bottom = clip.y + clip.h;
+
+	for (int i=0; i < pool->count; i++)
+	{
+		int x = ScaleX(viewport, (int)pool->x[i]);
+		int y = ScaleY(viewport, (int)pool->y[i]);
+
+		// Particles partly off the surface aren't drawn at all, whatever the clip //
+		if (x < 0 || y < 0 || x > max_x || y > max_y)
+			continue;
+
+		int left   = x < clip.x ? clip.x : x;
+		int top    = y < clip.y ? clip.y : y;
+		int right  = x + size > clip_right  ? clip_right  : x + size;
+		int bottom = y + size > clip_bottom ? clip_bottom : y + size;
+		if (left >= right || top >= bottom)
+			continue;
+
+		Uint32 color = pool->color[i];
+
+		for (int row=top; row < bottom; row++)
+		{
+			Uint8* pixel = pixels + row * surface->pitch + left * bytes_per_pixel;
+
+			for (int col=left; col < right; col++, pixel += bytes_per_pixel)
+			{
+				switch (bytes_per_pixel)
+				{
+				case 4:  *(Uint32*)pixel = color;        break;
+				case 2:  *(Uint16*)pixel = (Uint16)color; break;
+				case 1:  *pixel          = (Uint8)color;  break;
+				default: memcpy(pixel, &color, 3);        break;  // little endian
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,50 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Particles.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Surface and SDL_Rect
+#include "Defines.h" // Our defines header
+#include "Viewport.h" // For scaling to the window
+
+// Debris and sparks from blocks being hit. Particles are only for show and //
+// live outside of GameState, so they never affect the game or its hashes.  //
+// Each field has its own array so updates can work on four at a time, and //
+// the live particles are always the first count entries: spawning adds to //
+// the end and a dead particle is replaced by the last one.                //
+struct ParticlePool
+{
+	float  x[MAX_PARTICLES];
+	float  y[MAX_PARTICLES];
+	float  x_speed[MAX_PARTICLES];
+	float  y_speed[MAX_PARTICLES];
+	float  life[MAX_PARTICLES];    // frames left
+	Uint32 color[MAX_PARTICLES];   // already mapped to the surface's format
+	int    count;
+
+	int    dead[MAX_PARTICLES];    // scratch list for UpdateParticles()
+	Uint32 random_seed;
+};
+
+void ClearParticles(ParticlePool* pool, Uint32 seed);
+
+// Does nothing if the pool is full //
+void SpawnParticle(ParticlePool* pool, float x, float y, float x_speed, float y_speed, float life, Uint32 color);
+
+// Bursts count particles out of a rect, each a random one of the given colors //
+void SpawnBurst(ParticlePool* pool, const SDL_Rect* rect, int count, float speed,
+                const Uint32* colors, int num_colors);
+
+// Moves every particle one frame along and retires the ones that died. //
+// UpdateParticlesScalar() is the plain version, for comparison.        //
+void UpdateParticles(ParticlePool* pool);
+void UpdateParticlesScalar(ParticlePool* pool);
+
+// Plots every particle straight into the surface under a single lock //
+void DrawParticles(const ParticlePool* pool, SDL_Surface* surface, const Viewport* viewport);
+
+// Plots the parts of particles that fall inside clip, for drawing a surface //
+// in pieces. The surface must already be locked. //
+void PlotParticles(const ParticlePool* pool, SDL_Surface* surface, const Viewport* viewport,
+                   const SDL_Rect& clip);
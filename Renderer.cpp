@@ -0,0 +1,550 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Renderer.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "Renderer.h"
+#include "Atomic.h"   // For handing out tiles
+
+void ClearDrawList(DrawList* list, SDL_Surface* target)
+{
+	for (int i=0; i < list->num_temporaries; i++)
+		SDL_FreeSurface(list->temporaries[i]);
+
+	list->target           = target;
+	list->count            = 0;
+	list->tileable         = true;
+	list->num_temporaries  = 0;
+	list->num_palette_maps = 0;
+}
+
+// Returns the next free command, or NULL if the list is full //
+static DrawCommand* NewCommand(DrawList* list, int type)
+{
+	if (list->count == MAX_DRAW_COMMANDS)
+		return NULL;
+
+	DrawCommand* command = &list->commands[list->count++];
+	memset(command, 0, sizeof(DrawCommand));
+	command->type = type;
+	return command;
+}
+
+void AddFill(DrawList* list, const SDL_Rect* rect, Uint32 color)
+{
+	// Clip to the target like SDL_FillRect() does //
+	const SDL_Rect& clip = list->target->clip_rect;
+	int left   = clip.x;
+	int top    = clip.y;
+	int right  = clip.x + clip.w;
+	int bottom = clip.y + clip.h;
+
+	if (rect)
+	{
+		if (rect->x > left)                 left   = rect->x;
+		if (rect->y > top)                  top    = rect->y;
+		if (rect->x + rect->w < right)      right  = rect->x + rect->w;
+		if (rect->y + rect->h < bottom)     bottom = rect->y + rect->h;
+	}
+
+	if (left >= right || top >= bottom)
+		return;
+
+	DrawCommand* command = NewCommand(list, DRAW_FILL);
+	if (!command)
+		return;
+
+	command->destination.x = (Sint16)left;
+	command->destination.y = (Sint16)top;
+	command->destination.w = (Uint16)(right - left);
+	command->destination.h = (Uint16)(bottom - top);
+	command->color         = color;
+}
+
+// Works out how the source's pixels turn into the target's, and whether the //
+// tiles can do it themselves. Returns false if only SDL's blitter can.       //
+static bool MapBlitFormat(DrawList* list, DrawCommand* command)
+{
+	SDL_PixelFormat* from = command->source->format;
+	SDL_PixelFormat* to   = list->target->format;
+
+	if (command->source->flags & SDL_SRCALPHA)
+		return false;
+
+	if (from->BytesPerPixel == 1 && from->palette)
+	{
+		// 8-bit onto 8-bit is a straight copy if the palettes agree. If they //
+		// don't, mapping each color to the target's nearest is what SDL does. //
+		if ( to->BytesPerPixel == 1 && to->palette && to->palette->ncolors == from->palette->ncolors &&
+			 memcmp(to->palette->colors, from->palette->colors,
+			        from->palette->ncolors * sizeof(SDL_Color)) == 0 )
+			return true;
+
+		// The same text is often drawn more than once a frame //
+		for (int i = list->count - 2; i >= 0; i--)
+		{
+			if (list->commands[i].source == command->source && list->commands[i].palette_map)
+			{
+				command->palette_map = list->commands[i].palette_map;
+				return true;
+			}
+		}
+
+		if (list->num_palette_maps == MAX_PALETTE_MAPS)
+			return false;
+
+		Uint32* map = list->palette_maps[list->num_palette_maps++];
+		for (int i=0; i < from->palette->ncolors; i++)
+		{
+			const SDL_Color& color = from->palette->colors[i];
+			map[i] = SDL_MapRGB(to, color.r, color.g, color.b);
+		}
+
+		command->palette_map = map;
+		return true;
+	}
+
+	return from->BytesPerPixel == to->BytesPerPixel && !from->palette &&
+	       from->Rmask == to->Rmask && from->Gmask == to->Gmask && from->Bmask == to->Bmask;
+}
+
+void AddBlit(DrawList* list, SDL_Surface* source, const SDL_Rect* source_rect, const SDL_Rect& destination)
+{
+	int source_x = 0, source_y = 0, w = source->w, h = source->h;
+	int x = destination.x, y = destination.y;
+
+	// Clip to the source, then to the target, the way SDL_BlitSurface() does //
+	if (source_rect)
+	{
+		source_x = source_rect->x;
+		source_y = source_rect->y;
+		w        = source_rect->w;
+		h        = source_rect->h;
+
+		if (source_x < 0) { w += source_x; x -= source_x; source_x = 0; }
+		if (source_y < 0) { h += source_y; y -= source_y; source_y = 0; }
+		if (source->w - source_x < w) w = source->w - source_x;
+		if (source->h - source_y < h) h = source->h - source_y;
+	}
+
+	const SDL_Rect& clip = list->target->clip_rect;
+	int dx = clip.x - x;
+	if (dx > 0) { w -= dx; x += dx; source_x += dx; }
+	dx = x + w - clip.x - clip.w;
+	if (dx > 0) w -= dx;
+
+	int dy = clip.y - y;
+	if (dy > 0) { h -= dy; y += dy; source_y += dy; }
+	dy = y + h - clip.y - clip.h;
+	if (dy > 0) h -= dy;
+
+	if (w <= 0 || h <= 0)
+		return;
+
+	DrawCommand* command = NewCommand(list, DRAW_BLIT);
+	if (!command)
+		return;
+
+	command->source        = source;
+	command->source_rect.x = (Sint16)source_x;
+	command->source_rect.y = (Sint16)source_y;
+	command->source_rect.w = (Uint16)w;
+	command->source_rect.h = (Uint16)h;
+	command->destination.x = (Sint16)x;
+	command->destination.y = (Sint16)y;
+	command->destination.w = (Uint16)w;
+	command->destination.h = (Uint16)h;
+
+	if ( !MapBlitFormat(list, command) )
+		list->tileable = false;
+}
+
+void AddParticles(DrawList* list, const ParticlePool* particles, const Viewport* viewport)
+{
+	if (particles->count == 0)
+		return;
+
+	DrawCommand* command = NewCommand(list, DRAW_PARTICLES);
+	if (!command)
+		return;
+
+	command->destination.w = (Uint16)list->target->w;
+	command->destination.h = (Uint16)list->target->h;
+	command->particles     = particles;
+	command->viewport      = viewport;
+}
+
+bool AddTemporary(DrawList* list, SDL_Surface* surface)
+{
+	if (list->num_temporaries < MAX_DRAW_TEMPORARIES)
+	{
+		list->temporaries[list->num_temporaries++] = surface;
+		return true;
+	}
+
+	if (list->count > 0 && list->commands[list->count - 1].source == surface)
+		list->count--;
+
+	SDL_FreeSurface(surface);
+	return false;
+}
+
+// Draws the list in order with SDL, the way the game always drew //
+static void RenderSerial(DrawList* list)
+{
+	for (int i=0; i < list->count; i++)
+	{
+		DrawCommand& command = list->commands[i];
+
+		// SDL changes the rects it's given //
+		SDL_Rect source      = command.source_rect;
+		SDL_Rect destination = command.destination;
+
+		switch (command.type)
+		{
+		case DRAW_FILL:
+			SDL_FillRect(list->target, &destination, command.color);
+			break;
+		case DRAW_BLIT:
+			SDL_BlitSurface(command.source, &source, list->target, &destination);
+			break;
+		case DRAW_PARTICLES:
+			DrawParticles(command.particles, list->target, command.viewport);
+			break;
+		}
+	}
+}
+
+// Returns false if the rects don't overlap //
+static bool IntersectRects(const SDL_Rect& a, const SDL_Rect& b, SDL_Rect* result)
+{
+	int left   = a.x > b.x ? a.x : b.x;
+	int top    = a.y > b.y ? a.y : b.y;
+	int right  = a.x + a.w < b.x + b.w ? a.x + a.w : b.x + b.w;
+	int bottom = a.y + a.h < b.y + b.h ? a.y + a.h : b.y + b.h;
+
+	if (left >= right || top >= bottom)
+		return false;
+
+	result->x = (Sint16)left;
+	result->y = (Sint16)top;
+	result->w = (Uint16)(right - left);
+	result->h = (Uint16)(bottom - top);
+	return true;
+}
+
+static inline Uint32 ReadPixel(const Uint8* pixel, int bytes_per_pixel)
+{
+	switch (bytes_per_pixel)
+	{
+	case 1:  return *pixel;
+	case 2:  return *(const Uint16*)pixel;
+	case 3:  return pixel[0] | (pixel[1] << 8) | (pixel[2] << 16);  // little endian
+	default: return *(const Uint32*)pixel;
+	}
+}
+
+static inline void WritePixel(Uint8* pixel, int bytes_per_pixel, Uint32 color)
+{
+	switch (bytes_per_pixel)
+	{
+	case 1:  *pixel          = (Uint8)color;  break;
+	case 2:  *(Uint16*)pixel = (Uint16)color; break;
+	case 3:  memcpy(pixel, &color, 3);        break;  // little endian
+	default: *(Uint32*)pixel = color;         break;
+	}
+}
+
+static void FillArea(SDL_Surface* target, const SDL_Rect& area, Uint32 color)
+{
+	int bytes_per_pixel = target->format->BytesPerPixel;
+
+	for (int y=0; y < area.h; y++)
+	{
+		Uint8* pixel = (Uint8*)target->pixels + (area.y + y) * target->pitch + area.x * bytes_per_pixel;
+
+		if (bytes_per_pixel == 4)
+		{
+			Uint32* pixels = (Uint32*)pixel;
+			for (int x=0; x < area.w; x++)
+				pixels[x] = color;
+		}
+		else
+		{
+			for (int x=0; x < area.w; x++, pixel += bytes_per_pixel)
+				WritePixel(pixel, bytes_per_pixel, color);
+		}
+	}
+}
+
+// Copies the part of a blit inside area. Pixels matching a colorkey are //
+// skipped; SDL ignores the alpha bits when it compares them.            //
+static void BlitArea(SDL_Surface* target, const DrawCommand& command, const SDL_Rect& area)
+{
+	SDL_Surface*     source = command.source;
+	SDL_PixelFormat* format = source->format;
+
+	int source_x = command.source_rect.x + area.x - command.destination.x;
+	int source_y = command.source_rect.y + area.y - command.destination.y;
+
+	int  source_bpp = format->BytesPerPixel;
+	int  target_bpp = target->format->BytesPerPixel;
+	bool keyed      = (source->flags & SDL_SRCCOLORKEY) != 0;
+	Uint32 rgb_mask = format->palette ? 0xFFFFFFFF : ~format->Amask;
+	Uint32 key      = format->colorkey & rgb_mask;
+
+	for (int y=0; y < area.h; y++)
+	{
+		const Uint8* from = (const Uint8*)source->pixels + (source_y + y) * source->pitch + source_x * source_bpp;
+		Uint8*       to   = (Uint8*)target->pixels + (area.y + y) * target->pitch + area.x * target_bpp;
+
+		if (command.palette_map)
+		{
+			for (int x=0; x < area.w; x++, to += target_bpp)
+			{
+				if (!keyed || from[x] != key)
+					WritePixel(to, target_bpp, command.palette_map[from[x]]);
+			}
+		}
+		else if (!keyed)
+		{
+			memcpy(to, from, area.w * source_bpp);
+		}
+		else
+		{
+			for (int x=0; x < area.w; x++, from += source_bpp, to += target_bpp)
+			{
+				if ( (ReadPixel(from, source_bpp) & rgb_mask) != key )
+					memcpy(to, from, source_bpp);
+			}
+		}
+	}
+}
+
+static void DrawTile(RenderPool* pool, int tile)
+{
+	const DrawList* list   = pool->list;
+	SDL_Surface*    target = list->target;
+	const SDL_Rect& clip   = pool->tiles[tile];
+
+	for (int i=0; i < pool->bin_counts[tile]; i++)
+	{
+		const DrawCommand& command = list->commands[pool->bins[tile][i]];
+
+		SDL_Rect area;
+		if ( !IntersectRects(command.destination, clip, &area) )
+			continue;
+
+		switch (command.type)
+		{
+		case DRAW_FILL:
+			FillArea(target, area, command.color);
+			break;
+		case DRAW_BLIT:
+			BlitArea(target, command, area);
+			break;
+		case DRAW_PARTICLES:
+			PlotParticles(command.particles, target, command.viewport, area);
+			break;
+		}
+	}
+}
+
+// Takes tiles until there are none left //
+static void DrawTiles(RenderPool* pool)
+{
+	for (;;)
+	{
+		int tile = AtomicAdd(&pool->next_tile, 1) - 1;
+		if (tile >= RENDER_TILES)
+			return;
+
+		DrawTile(pool, tile);
+	}
+}
+
+static int RenderWorkerThread(void* data)
+{
+	RenderPool* pool = (RenderPool*)data;
+
+	for (;;)
+	{
+		SDL_SemWait(pool->start);
+		if ( !AtomicLoad(&pool->running) )
+			return 0;
+
+		DrawTiles(pool);
+
+		SDL_SemPost(pool->done);
+	}
+}
+
+void StartRenderPool(RenderPool* pool, int num_threads)
+{
+	memset(pool, 0, sizeof(RenderPool));
+
+	if (num_threads > MAX_RENDER_THREADS)
+		num_threads = MAX_RENDER_THREADS;
+	if (num_threads < 0)
+		num_threads = 0;
+
+	pool->num_threads = num_threads;
+	if (num_threads <= 1)
+		return;
+
+	pool->start   = SDL_CreateSemaphore(0);
+	pool->done    = SDL_CreateSemaphore(0);
+	pool->running = 1;
+
+	if (!pool->start || !pool->done)
+		return;
+
+	for (int i=0; i < num_threads - 1; i++)
+	{
+		SDL_Thread* worker = SDL_CreateThread(RenderWorkerThread, pool);
+		if (!worker)
+			break;
+		pool->workers[pool->num_workers++] = worker;
+	}
+
+	// Whatever we got, this thread makes one more //
+	pool->num_threads = pool->num_workers + 1;
+}
+
+void StopRenderPool(RenderPool* pool)
+{
+	AtomicStore(&pool->running, 0);
+
+	for (int i=0; i < pool->num_workers; i++)
+		SDL_SemPost(pool->start);
+	for (int i=0; i < pool->num_workers; i++)
+		SDL_WaitThread(pool->workers[i], NULL);
+
+	if (pool->start)
+		SDL_DestroySemaphore(pool->start);
+	if (pool->done)
+		SDL_DestroySemaphore(pool->done);
+
+	pool->start       = NULL;
+	pool->done        = NULL;
+	pool->num_workers = 0;
+	pool->num_threads = 0;
+}
+
+// Cuts the target into tiles and lists, for each tile, the commands that //
+// touch it. Commands keep their order, so overlaps come out the same.    //
+static void BinCommands(RenderPool* pool, const DrawList* list)
+{
+	int width  = list->target->w;
+	int height = list->target->h;
+
+	for (int row=0; row < RENDER_TILE_ROWS; row++)
+	{
+		for (int column=0; column < RENDER_TILE_COLUMNS; column++)
+		{
+			SDL_Rect& tile = pool->tiles[column + row * RENDER_TILE_COLUMNS];
+			tile.x = (Sint16)(column * width / RENDER_TILE_COLUMNS);
+			tile.y = (Sint16)(row * height / RENDER_TILE_ROWS);
+			tile.w = (Uint16)((column + 1) * width / RENDER_TILE_COLUMNS - tile.x);
+			tile.h = (Uint16)((row + 1) * height / RENDER_TILE_ROWS - tile.y);
+		}
+	}
+
+	memset(pool->bin_counts, 0, sizeof(pool->bin_counts));
+
+	for (int i=0; i < list->count; i++)
+	{
+		const SDL_Rect& rect = list->commands[i].destination;
+
+		for (int tile=0; tile < RENDER_TILES; tile++)
+		{
+			SDL_Rect area;
+			if ( IntersectRects(rect, pool->tiles[tile], &area) )
+				pool->bins[tile][pool->bin_counts[tile]++] = (Uint16)i;
+		}
+	}
+}
+
+// Adds up the bytes of pixels the list reads and writes //
+static Uint64 CountBytesDrawn(const DrawList* list)
+{
+	int    target_bpp = list->target->format->BytesPerPixel;
+	Uint64 bytes      = 0;
+
+	for (int i=0; i < list->count; i++)
+	{
+		const DrawCommand& command = list->commands[i];
+		Uint64 pixels = (Uint64)command.destination.w * command.destination.h;
+
+		switch (command.type)
+		{
+		case DRAW_FILL:
+			bytes += pixels * target_bpp;
+			break;
+		case DRAW_BLIT:
+			bytes += pixels * (command.source->format->BytesPerPixel + target_bpp);
+			break;
+		case DRAW_PARTICLES:
+		{
+			Uint64 size = ScaleSize(command.viewport, PARTICLE_SIZE);
+			bytes += command.particles->count * size * size * target_bpp;
+		} break;
+		}
+	}
+
+	return bytes;
+}
+
+// Surfaces SDL keeps RLE encoded or in video memory only have pixels to read //
+// while locked. Locks nest, so a source used twice is locked twice.         //
+static void LockSources(DrawList* list, bool lock)
+{
+	for (int i=0; i < list->count; i++)
+	{
+		SDL_Surface* source = list->commands[i].source;
+		if ( list->commands[i].type != DRAW_BLIT || !SDL_MUSTLOCK(source) )
+			continue;
+
+		if (lock)
+			SDL_LockSurface(source);
+		else
+			SDL_UnlockSurface(source);
+	}
+}
+
+void RenderDrawList(DrawList* list, RenderPool* pool)
+{
+	SDL_Surface* target = list->target;
+
+	list->bytes_drawn += CountBytesDrawn(list);
+
+	if (!pool || pool->num_threads == 0 || !list->tileable)
+	{
+		RenderSerial(list);
+	}
+	else
+	{
+		if ( SDL_MUSTLOCK(target) )
+			SDL_LockSurface(target);
+		LockSources(list, true);
+
+		BinCommands(pool, list);
+		pool->list = list;
+		AtomicStore(&pool->next_tile, 0);
+
+		for (int i=0; i < pool->num_workers; i++)
+			SDL_SemPost(pool->start);
+
+		DrawTiles(pool);
+
+		for (int i=0; i < pool->num_workers; i++)
+			SDL_SemWait(pool->done);
+
+		LockSources(list, false);
+		if ( SDL_MUSTLOCK(target) )
+			SDL_UnlockSurface(target);
+	}
+
+	ClearDrawList(list, target);
+}
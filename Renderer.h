@@ -0,0 +1,86 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Renderer.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h"     // For SDL_Surface and SDL_Thread
+#include "Defines.h"     // Our defines header
+#include "Enums.h"       // For DrawCommandType
+#include "Particles.h"   // For ParticlePool
+#include "Viewport.h"    // For drawing particles
+
+// One thing to draw. Rects are clipped to the target when the command is //
+// added, the same way SDL_FillRect() and SDL_BlitSurface() clip them.    //
+struct DrawCommand
+{
+	int           type;          // DrawCommandType
+	SDL_Rect      destination;
+	Uint32        color;         // DRAW_FILL
+	SDL_Surface*  source;        // DRAW_BLIT
+	SDL_Rect      source_rect;   // DRAW_BLIT, the same size as destination
+	const Uint32* palette_map;   // DRAW_BLIT from an 8-bit surface, its colors in the target's format
+	const ParticlePool* particles;  // DRAW_PARTICLES
+	const Viewport*     viewport;
+};
+
+// A frame's worth of drawing, kept until RenderDrawList() puts it on the target //
+struct DrawList
+{
+	SDL_Surface* target;
+	DrawCommand  commands[MAX_DRAW_COMMANDS];
+	int          count;
+
+	// Cleared when a draw needs something only SDL's blitter does, //
+	// like alpha blending; the whole frame is then drawn by SDL.   //
+	bool         tileable;
+
+	SDL_Surface* temporaries[MAX_DRAW_TEMPORARIES];
+	int          num_temporaries;
+	Uint32       palette_maps[MAX_PALETTE_MAPS][256];
+	int          num_palette_maps;
+
+	// Bytes of pixels read and written by every list drawn so far. //
+	// ClearDrawList() leaves it alone, so it adds up over frames.  //
+	Uint64       bytes_drawn;
+};
+
+// Empties the list, freeing its temporary surfaces, and sets what it draws on //
+void ClearDrawList(DrawList* list, SDL_Surface* target);
+
+// Records a fill or a blit. A NULL rect means the whole surface. //
+void AddFill(DrawList* list, const SDL_Rect* rect, Uint32 color);
+void AddBlit(DrawList* list, SDL_Surface* source, const SDL_Rect* source_rect, const SDL_Rect& destination);
+void AddParticles(DrawList* list, const ParticlePool* particles, const Viewport* viewport);
+
+// Hands a surface to the list to free once it's drawn, after it's been //
+// passed to AddBlit(). Returns false, having freed it, if there's no   //
+// room, and the blit is taken back out of the list.                    //
+bool AddTemporary(DrawList* list, SDL_Surface* surface);
+
+// The threads that draw a list's tiles. The thread drawing the list works on //
+// tiles too, so num_threads counts it; with 0, SDL draws the list in order.  //
+struct RenderPool
+{
+	int          num_threads;
+	SDL_Thread*  workers[MAX_RENDER_THREADS];
+	int          num_workers;
+	SDL_sem*     start;          // posted once for each worker to draw a frame
+	SDL_sem*     done;           // posted by each worker when it runs out of tiles
+	volatile int running;
+	volatile int next_tile;      // the next tile nobody has taken yet
+
+	// The frame being drawn //
+	const DrawList* list;
+	SDL_Rect        tiles[RENDER_TILES];
+	Uint16          bins[RENDER_TILES][MAX_DRAW_COMMANDS];  // commands touching each tile, in order
+	int             bin_counts[RENDER_TILES];
+};
+
+// Starts num_threads - 1 workers. Falls back to fewer if threads can't be made. //
+void StartRenderPool(RenderPool* pool, int num_threads);
+void StopRenderPool(RenderPool* pool);
+
+// Draws the list onto its target and empties it. Tiles are drawn straight into //
+// the target's pixels and come out the same as SDL would draw the list.        //
+void RenderDrawList(DrawList* list, RenderPool* pool);
@@ -0,0 +1,389 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Rollback.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "Rollback.h"
+#include "LevelGen.h" // For NextRandom()
+
+// Every packet starts with this, followed by the newest input's frame, the //
+// frame and hash of our newest confirmed state, and then the inputs.       //
+#define NET_PACKET_MAGIC  0xBB01
+#define NET_HEADER_SIZE   15
+
+static void WriteInt(Uint8* data, Uint32 value)
+{
+	data[0] = (Uint8)(value);
+	data[1] = (Uint8)(value >> 8);
+	data[2] = (Uint8)(value >> 16);
+	data[3] = (Uint8)(value >> 24);
+}
+
+static Uint32 ReadInt(const Uint8* data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((Uint32)data[3] << 24);
+}
+
+bool StartRollbackSession(RollbackSession* session, const LevelLayout* levels, int num_levels,
+                          int local_player, int input_delay,
+                          int local_port, const char* remote_host, int remote_port)
+{
+	memset(session, 0, sizeof(RollbackSession));
+
+	if ( !NetOpen(&session->socket, local_port, remote_host, remote_port) )
+		return false;
+
+	session->local_player = local_player;
+	session->input_delay  = input_delay;
+
+	InitGameState(&session->state, levels, num_levels, MAX_PLAYERS);
+
+	for (int i=0; i < INPUT_HISTORY; i++)
+	{
+		session->remote_input_frames[i] = -1;
+		session->local_hash_frames[i]   = -1;
+		session->remote_hash_frames[i]  = -1;
+	}
+
+	// Nobody presses anything during the first input_delay frames //
+	for (int frame=0; frame < input_delay; frame++)
+	{
+		session->remote_input_frames[frame] = frame;
+	}
+
+	session->newest_local     = input_delay - 1;
+	session->confirmed_remote = input_delay - 1;
+	session->last_hashed      = -1;
+	session->last_compared    = -1;
+	session->rollback_frame   = -1;
+	session->result_frame     = -1;
+	session->remote_hashed    = -1;
+	session->first_desync     = -1;
+
+	return true;
+}
+
+void StopRollbackSession(RollbackSession* session)
+{
+	NetClose(&session->socket);
+}
+
+// Checks our hash of a frame against the remote's, once we have both //
+static void CompareHashes(RollbackSession* session, int frame)
+{
+	int slot = frame % INPUT_HISTORY;
+
+	if ( frame <= session->last_compared ||
+		 session->local_hash_frames[slot] != frame || session->remote_hash_frames[slot] != frame )
+		return;
+
+	if (session->local_hashes[slot] != session->remote_hashes[slot])
+	{
+		if (session->first_desync < 0)
+			session->first_desync = frame;
+		session->desyncs++;
+	}
+
+	session->last_compared = frame;
+}
+
+static void ReceivePackets(RollbackSession* session)
+{
+	Uint8 packet[NET_MAX_PACKET];
+	int   size;
+
+	while ( (size = NetReceive(&session->socket, packet, sizeof(packet))) > 0 )
+	{
+		if (size < NET_HEADER_SIZE || (packet[0] | (packet[1] << 8)) != NET_PACKET_MAGIC)
+			continue;
+
+		int count      = packet[2];
+		int newest     = (int)ReadInt(packet + 3);
+		int hash_frame = (int)ReadInt(packet + 7);
+		Uint32 hash    = ReadInt(packet + 11);
+
+		if (count > NET_INPUT_REDUNDANCY || size < NET_HEADER_SIZE + count)
+			continue;
+
+		for (int i=0; i < count; i++)
+		{
+			int frame = newest - count + 1 + i;
+
+			// Skip inputs we already have, or that are too far ahead to store //
+			if ( frame <= session->confirmed_remote ||
+				 frame >= session->confirmed_remote + INPUT_HISTORY )
+				continue;
+
+			int slot = frame % INPUT_HISTORY;
+			if (session->remote_input_frames[slot] == frame)
+				continue;
+
+			session->remote_inputs[slot]       = packet[NET_HEADER_SIZE + i];
+			session->remote_input_frames[slot] = frame;
+
+			// If we already played this frame with a different guess, it needs redoing //
+			if ( frame < session->current_frame &&
+				 session->remote_inputs[slot] != session->used_remote_inputs[slot] &&
+				 (session->rollback_frame < 0 || frame < session->rollback_frame) )
+			{
+				session->rollback_frame = frame;
+			}
+		}
+
+		while ( session->remote_input_frames[(session->confirmed_remote + 1) % INPUT_HISTORY] ==
+				session->confirmed_remote + 1 )
+		{
+			session->confirmed_remote++;
+		}
+
+		if (hash_frame > session->remote_hashed)
+			session->remote_hashed = hash_frame;
+
+		if (hash_frame >= 0)
+		{
+			int slot = hash_frame % INPUT_HISTORY;
+			session->remote_hashes[slot]      = hash;
+			session->remote_hash_frames[slot] = hash_frame;
+			CompareHashes(session, hash_frame);
+		}
+	}
+}
+
+// Saves a snapshot and plays one frame, guessing the remote input if we don't have it //
+static void SimulateFrame(RollbackSession* session, int frame)
+{
+	int slot = frame % INPUT_HISTORY;
+
+	session->snapshots[frame % ROLLBACK_WINDOW] = session->state;
+
+	int remote = 0;
+	if (session->remote_input_frames[slot] == frame)
+		remote = session->remote_inputs[slot];
+	else if (session->confirmed_remote >= 0)
+		remote = session->remote_inputs[session->confirmed_remote % INPUT_HISTORY];
+	session->used_remote_inputs[slot] = remote;
+
+	int local = session->local_inputs[slot];
+
+	if (session->local_player == 0)
+		StepSimulation(&session->state, local | (remote << INPUT_PLAYER_SHIFT));
+	else
+		StepSimulation(&session->state, remote | (local << INPUT_PLAYER_SHIFT));
+}
+
+// Hashes every frame we now know both inputs for //
+static void HashConfirmedFrames(RollbackSession* session)
+{
+	int limit = session->confirmed_remote;
+	if (limit > session->current_frame - 1)
+		limit = session->current_frame - 1;
+
+	while (session->last_hashed < limit)
+	{
+		int frame = ++session->last_hashed;
+		int slot  = frame % INPUT_HISTORY;
+
+		// The game after this frame is the snapshot taken before the next one //
+		const GameState* after = (frame + 1 == session->current_frame) ?
+			&session->state : &session->snapshots[(frame + 1) % ROLLBACK_WINDOW];
+
+		session->local_hashes[slot]      = HashGameState(after);
+		session->local_hash_frames[slot] = frame;
+
+		CompareHashes(session, frame);
+
+		// No rollback can change how this game ends now //
+		if (session->result_frame < 0 && after->result != RESULT_PLAYING)
+			session->result_frame = frame;
+	}
+}
+
+// Sends our last few inputs, so a lost packet doesn't lose an input //
+static void SendInputs(RollbackSession* session, Uint32 now)
+{
+	Uint8 packet[NET_HEADER_SIZE + NET_INPUT_REDUNDANCY];
+
+	// Once the game is over we stop making inputs, so resend the ones after //
+	// the newest frame the remote has, in case that's where it's stuck       //
+	int newest = session->newest_local;
+	if (session->result_frame >= 0 && session->remote_hashed + NET_INPUT_REDUNDANCY < newest)
+		newest = session->remote_hashed + NET_INPUT_REDUNDANCY;
+
+	int count = newest + 1;
+	if (count > NET_INPUT_REDUNDANCY)
+		count = NET_INPUT_REDUNDANCY;
+
+	int    hash_frame = session->last_hashed;
+	Uint32 hash       = hash_frame >= 0 ? session->local_hashes[hash_frame % INPUT_HISTORY] : 0;
+
+	packet[0] = (Uint8)(NET_PACKET_MAGIC);
+	packet[1] = (Uint8)(NET_PACKET_MAGIC >> 8);
+	packet[2] = (Uint8)count;
+	WriteInt(packet + 3,  (Uint32)newest);
+	WriteInt(packet + 7,  (Uint32)hash_frame);
+	WriteInt(packet + 11, hash);
+
+	for (int i=0; i < count; i++)
+	{
+		int frame = newest - count + 1 + i;
+		packet[NET_HEADER_SIZE + i] = session->local_inputs[frame % INPUT_HISTORY];
+	}
+
+	NetSend(&session->socket, packet, NET_HEADER_SIZE + count, now);
+}
+
+bool RollbackTick(RollbackSession* session, int local_input, Uint32 now)
+{
+	NetFlush(&session->socket, now);
+	ReceivePackets(session);
+
+	// After the end there's nothing to play, only the remote to keep up to date //
+	if (session->result_frame >= 0)
+	{
+		SendInputs(session, now);
+		return true;
+	}
+
+	// If we've guessed too many frames ahead, wait for the other player to catch up //
+	bool stalled = (session->current_frame - session->confirmed_remote >= ROLLBACK_WINDOW - 1);
+
+	if (!stalled)
+	{
+		session->newest_local++;
+		session->local_inputs[session->newest_local % INPUT_HISTORY] = local_input & INPUT_PLAYER_MASK;
+	}
+
+	// Go back and replay any frames we guessed wrong //
+	if (session->rollback_frame >= 0)
+	{
+		session->state = session->snapshots[session->rollback_frame % ROLLBACK_WINDOW];
+
+		for (int frame = session->rollback_frame; frame < session->current_frame; frame++)
+		{
+			SimulateFrame(session, frame);
+			session->resimulated_frames++;
+		}
+
+		session->rollbacks++;
+		session->rollback_frame = -1;
+	}
+
+	if (!stalled)
+	{
+		SimulateFrame(session, session->current_frame);
+		session->current_frame++;
+	}
+	else
+	{
+		session->stalls++;
+	}
+
+	HashConfirmedFrames(session);
+
+	// Keep sending while stalled too, in case our last packets were lost //
+	SendInputs(session, now);
+
+	return !stalled;
+}
+
+bool IsRollbackFinished(const RollbackSession* session)
+{
+	return session->result_frame >= 0 && session->remote_hashed >= session->result_frame;
+}
+
+int RunNetTest(const LevelLayout* levels, int num_levels, int latency, int jitter, int loss_percent)
+{
+	static RollbackSession sessions[MAX_PLAYERS];
+	static Uint8           inputs[MAX_PLAYERS][NET_TEST_TICKS + NET_INPUT_DELAY];
+
+	for (int p=0; p < MAX_PLAYERS; p++)
+	{
+		if ( !StartRollbackSession(&sessions[p], levels, num_levels, p, NET_INPUT_DELAY,
+		                           NET_TEST_PORT + p, "127.0.0.1", NET_TEST_PORT + 1 - p) )
+		{
+			printf("couldn't open UDP port %d\n", NET_TEST_PORT + p);
+			return 1;
+		}
+		NetSetConditions(&sessions[p].socket, latency, jitter, loss_percent);
+	}
+
+	memset(inputs, 0, sizeof(inputs));
+
+	// Each player chases the ball as they see it, but now and then holds random //
+	// keys for a few frames so the other side's guesses keep going wrong. Time  //
+	// is faked, so the test runs as fast as the machine can go.                 //
+	Uint32 seeds[MAX_PLAYERS]  = { 1, 2 };
+	int    random[MAX_PLAYERS] = { -1, -1 };
+
+	for (int tick=0; tick < NET_TEST_TICKS; tick++)
+	{
+		Uint32 now = tick * (FRAME_RATE);
+
+		for (int p=0; p < MAX_PLAYERS; p++)
+		{
+			if (tick % 8 == 0)
+			{
+				Uint32 roll = NextRandom(&seeds[p]);
+				random[p] = (roll % 4 == 0) ? (int)((roll >> 8) % 8) : -1;
+			}
+
+			const GameState& seen = sessions[p].state;
+			int paddle_center = seen.players[p].screen_location.x + seen.players[p].screen_location.w / 2;
+			int ball_center   = seen.ball.screen_location.x + seen.ball.screen_location.w / 2;
+
+			int input = INPUT_LAUNCH;
+			if (random[p] >= 0)
+				input = random[p];
+			else if (ball_center < paddle_center - PADDLE_WIDTH / 4)
+				input |= INPUT_LEFT;
+			else if (ball_center > paddle_center + PADDLE_WIDTH / 4)
+				input |= INPUT_RIGHT;
+
+			if ( RollbackTick(&sessions[p], input, now) )
+				inputs[p][sessions[p].newest_local] = (Uint8)input;
+		}
+	}
+
+	// Replay the game from the recorded inputs, without any guessing //
+	int check_frame = sessions[0].last_hashed;
+	if (sessions[1].last_hashed < check_frame)
+		check_frame = sessions[1].last_hashed;
+
+	GameState reference;
+	InitGameState(&reference, levels, num_levels, MAX_PLAYERS);
+	for (int frame=0; frame <= check_frame; frame++)
+	{
+		StepSimulation(&reference, inputs[0][frame] | (inputs[1][frame] << INPUT_PLAYER_SHIFT));
+	}
+	Uint32 reference_hash = HashGameState(&reference);
+
+	bool passed = (check_frame >= 0);
+
+	for (int p=0; p < MAX_PLAYERS; p++)
+	{
+		RollbackSession& session = sessions[p];
+		int slot = check_frame % INPUT_HISTORY;
+
+		bool matches = (session.local_hash_frames[slot] == check_frame &&
+		                session.local_hashes[slot] == reference_hash);
+		if (!matches || session.desyncs > 0)
+			passed = false;
+
+		printf("player %d: %d frames, %d rollbacks, %d frames resimulated, %d stalls, %d desyncs, "
+		       "%d packets sent, %d dropped, %d received, %s the replay\n",
+		       p + 1, session.current_frame, session.rollbacks, session.resimulated_frames,
+		       session.stalls, session.desyncs, session.socket.packets_sent,
+		       session.socket.packets_dropped, session.socket.packets_received,
+		       matches ? "matches" : "DOESN'T match");
+		if (session.desyncs > 0)
+			printf("player %d: first out of sync at frame %d\n", p + 1, session.first_desync);
+
+		StopRollbackSession(&session);
+	}
+
+	printf("%s: checked frame %d\n", passed ? "PASSED" : "FAILED", check_frame);
+
+	return passed ? 0 : 1;
+}
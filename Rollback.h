@@ -0,0 +1,66 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Rollback.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "Simulation.h" // For GameState
+#include "Net.h"        // For NetSocket
+
+// A two player game over the network. We never wait for the other player's //
+// input: we guess it (they're still doing what they did last), and when the //
+// real input turns out different we go back to a snapshot from before the  //
+// bad guess and simulate forward again. Both machines hash every frame once //
+// both inputs are known and swap hashes to catch the games drifting apart.  //
+struct RollbackSession
+{
+	NetSocket socket;
+	int       local_player;   // 0 or 1
+	int       input_delay;    // frames local input is held back
+
+	GameState state;                       // the game as of current_frame
+	GameState snapshots[ROLLBACK_WINDOW];  // the game at the start of recent frames
+
+	Uint8  local_inputs[INPUT_HISTORY];
+	Uint8  remote_inputs[INPUT_HISTORY];
+	int    remote_input_frames[INPUT_HISTORY];  // frame each remote input is for, -1 if none
+	Uint8  used_remote_inputs[INPUT_HISTORY];   // remote input each frame was simulated with
+
+	Uint32 local_hashes[INPUT_HISTORY];
+	int    local_hash_frames[INPUT_HISTORY];
+	Uint32 remote_hashes[INPUT_HISTORY];
+	int    remote_hash_frames[INPUT_HISTORY];
+
+	int current_frame;     // next frame to simulate
+	int newest_local;      // newest frame we have local input for
+	int confirmed_remote;  // we have the remote input for every frame up to this one
+	int last_hashed;       // newest frame hashed with confirmed inputs
+	int last_compared;     // newest frame whose hash we've checked against the remote's
+	int rollback_frame;    // earliest frame simulated with a wrong guess, or -1
+	int result_frame;      // the game ended on this frame with both inputs known, or -1
+	int remote_hashed;     // newest frame the remote has both inputs for, as far as we've heard
+
+	// Counters //
+	int rollbacks;
+	int resimulated_frames;
+	int stalls;
+	int desyncs;
+	int first_desync;      // -1 until the games drift apart
+};
+
+bool StartRollbackSession(RollbackSession* session, const LevelLayout* levels, int num_levels,
+                          int local_player, int input_delay,
+                          int local_port, const char* remote_host, int remote_port);
+void StopRollbackSession(RollbackSession* session);
+
+// Sends our input, reads the remote's and advances the game one frame. Returns //
+// false if we had to wait because we're too far ahead of the other player.     //
+bool RollbackTick(RollbackSession* session, int local_input, Uint32 now);
+
+// True once the remote has also played up to result_frame, so nothing more we //
+// send can matter to it. Until then, keep calling RollbackTick().             //
+bool IsRollbackFinished(const RollbackSession* session);
+
+// Plays two sessions against each other over loopback with the given network //
+// conditions, then checks they agree with a replay of the same inputs.        //
+int  RunNetTest(const LevelLayout* levels, int num_levels, int latency, int jitter, int loss_percent);
@@ -0,0 +1,795 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Simulation.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+// The game logic lives here, apart from any drawing or input code, so it can //
+// be run without a window (for example by the level difficulty estimator).   //
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Simulation.h"
+#include "LevelGen.h" // For NextRandom()
+
+// This function reads in the number of hits for each block from a level file. //
+// Anything after the blocks is the level's script, a line for each mover:     //
+//   slide <row> <x range> <y range> <period> <phase>                         //
+//   orbit <row> <col> <x range> <y range> <period> <phase>                   //
+// The ranges are in pixels either side of the grid, the others in ticks.     //
+bool LoadLevelFile(const char* file_name, LevelLayout* layout)
+{
+	// Open the file for input.
+	FILE* inFile = fopen(file_name, "r");
+
+	if (!inFile)
+		return false;
+
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		// Treat anything we can't read as an empty cell //
+		if (fscanf(inFile, "%d", &layout->hits[i]) != 1)
+			layout->hits[i] = 0;
+	}
+
+	layout->num_moves = 0;
+
+	char keyword[16];
+	while ( layout->num_moves < MAX_LEVEL_MOVES && fscanf(inFile, "%15s", keyword) == 1 )
+	{
+		MoverScript& move = layout->moves[layout->num_moves];
+		move.col = 0;
+
+		bool read = false;
+		if (strcmp(keyword, "slide") == 0)
+		{
+			move.type = MOVER_SLIDE;
+			read = fscanf(inFile, "%d %d %d %d %d", &move.row, &move.x_range, &move.y_range,
+			              &move.period, &move.phase) == 5;
+		}
+		else if (strcmp(keyword, "orbit") == 0)
+		{
+			move.type = MOVER_ORBIT;
+			read = fscanf(inFile, "%d %d %d %d %d %d", &move.row, &move.col, &move.x_range, &move.y_range,
+			              &move.period, &move.phase) == 6;
+		}
+
+		// The rest of the script can't be trusted after a line we don't understand //
+		if (!read)
+			break;
+
+		// Lines that don't fit the level are left out //
+		if ( move.row < 0 || move.row >= NUM_ROWS || move.col < 0 || move.col >= NUM_COLS ||
+			 move.period <= 0 || abs(move.x_range) > WINDOW_WIDTH || abs(move.y_range) > WINDOW_HEIGHT )
+			continue;
+
+		move.phase %= move.period;
+		if (move.phase < 0)
+			move.phase += move.period;
+
+		layout->num_moves++;
+	}
+
+	fclose(inFile);
+
+	return true;
+}
+
+// This function puts the paddle, ball, lives and level back to where a new game starts. //
+void InitGameState(GameState* state, const LevelLayout* levels, int num_levels, int num_players)
+{
+	state->levels      = levels;
+	state->num_levels  = num_levels;
+	state->masks       = LoadCollisionMasks();
+	state->num_players = num_players;
+	state->last_hit    = -1;   // nobody has hit the ball yet
+
+	// Initialize the players' data //
+	for (int i=0; i < MAX_PLAYERS; i++)
+	{
+		Paddle& player = state->players[i];
+
+		// screen locations
+		player.screen_location.x = (WINDOW_WIDTH / 2) - (PADDLE_WIDTH / 2);   // center screen
+		player.screen_location.y = PLAYER_Y;
+		player.screen_location.w = PADDLE_WIDTH;
+		player.screen_location.h = PADDLE_HEIGHT;
+		// image location
+		player.bitmap_location.x = PADDLE_BITMAP_X;
+		player.bitmap_location.y = PADDLE_BITMAP_Y;
+		player.bitmap_location.w = PADDLE_WIDTH;
+		player.bitmap_location.h = PADDLE_HEIGHT;
+		// player speed
+		player.x_speed = PLAYER_SPEED;
+
+		state->scores[i] = 0;
+	}
+
+	// In versus mode each player starts on their own half of the screen //
+	if (num_players > 1)
+	{
+		state->players[0].screen_location.x -= WINDOW_WIDTH / 4;
+		state->players[1].screen_location.x += WINDOW_WIDTH / 4;
+	}
+
+	// lives
+	state->lives = NUM_LIVES;
+
+	// No power-ups yet, and the same drops every game //
+	ClearEntities(&state->entities);
+	state->random_seed = 0x2545F491;
+
+	state->num_events       = 0;
+	state->collision_checks = 0;
+	state->mover_steps      = 0;
+
+	// Initialize the ball's data //
+	state->ball.screen_location.w = BALL_DIAMETER;
+	state->ball.screen_location.h = BALL_DIAMETER;
+	// image location
+	state->ball.bitmap_location.x = BALL_BITMAP_X;
+	state->ball.bitmap_location.y = BALL_BITMAP_Y;
+	state->ball.bitmap_location.w = BALL_DIAMETER;
+	state->ball.bitmap_location.h = BALL_DIAMETER;
+	// center screen, not moving
+	ResetBall(state);
+
+	state->level  = 1;
+	state->result = RESULT_PLAYING;
+	state->ticks  = 0;
+
+	// We'll need to initialize our blocks for each level, so we have a separate function handle it //
+	InitBlocks(state);
+}
+
+// This function iterates through the block structure, setting up the blocks //
+// according to the layout of the current level. //
+void InitBlocks(GameState* state)
+{
+	const LevelLayout& layout = state->levels[state->level - 1];
+
+	int index = 0; // used to index blocks in the blocks array
+
+	state->num_blocks = 0;
+
+	// Iterate through each row and column of blocks //
+	for (int row=0; row<NUM_ROWS; row++)
+	{
+		for (int col=0; col<NUM_COLS; col++)
+		{
+			Block& block = state->blocks[index];
+
+			// A block is only created for num_hits = 1-4, 0 means skip that block //
+			block.num_hits = layout.hits[index];
+
+			// We set the location of the block according to what row and column   //
+			// we're on in our loop. Notice that we use BLOCK_SCREEN_BUFFER to set //
+			// the blocks away from the sides of the screen. //
+			block.screen_location.x = col*BLOCK_WIDTH + BLOCK_WIDTH - BLOCK_SCREEN_BUFFER;
+			block.screen_location.y = row*BLOCK_HEIGHT + BLOCK_HEIGHT + BLOCK_SCREEN_BUFFER;
+			block.screen_location.w = BLOCK_WIDTH;
+			block.screen_location.h = BLOCK_HEIGHT;
+			block.bitmap_location.w = BLOCK_WIDTH;
+			block.bitmap_location.h = BLOCK_HEIGHT;
+
+			// Now we set the bitmap location rect according to num_hits //
+			switch (block.num_hits)
+			{
+				case 1:
+				{
+					block.bitmap_location.x = RED_X;
+					block.bitmap_location.y = RED_Y;
+				} break;
+				case 2:
+				{
+					block.bitmap_location.x = YELLOW_X;
+					block.bitmap_location.y = YELLOW_Y;
+				} break;
+				case 3:
+				{
+					block.bitmap_location.x = GREEN_X;
+					block.bitmap_location.y = GREEN_Y;
+				} break;
+				case 4:
+				{
+					block.bitmap_location.x = BLUE_X;
+					block.bitmap_location.y = BLUE_Y;
+				} break;
+			}
+
+			// Keep track of how many blocks have to be broken to clear the level. //
+			if (block.num_hits > 0)
+				state->num_blocks++;
+
+			index++;	// move to next block
+		}
+	}
+
+	// Put the moving blocks where the script starts them, then file them all //
+	InitMovers(&state->movers, &layout, state->blocks, state->ticks);
+
+	ClearBlockGrid(&state->grid);
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		if (state->blocks[i].num_hits > 0)
+			InsertGridBlock(&state->grid, i, state->blocks[i].screen_location);
+	}
+}
+
+// This function applies the player's input and then moves the ball. //
+void StepSimulation(GameState* state, int input)
+{
+	if (state->result != RESULT_PLAYING)
+		return;
+
+	state->num_events       = 0;
+	state->collision_checks = 0;
+
+	for (int i=0; i < state->num_players; i++)
+	{
+		Paddle& player       = state->players[i];
+		int     player_input = (input >> (i * INPUT_PLAYER_SHIFT)) & INPUT_PLAYER_MASK;
+
+		// Player can hit 'space' to make the ball move at start //
+		if (player_input & INPUT_LAUNCH)
+		{
+			if (state->ball.y_speed == 0)
+				state->ball.y_speed = BALL_SPEED_Y;
+		}
+
+		// This is where we actually move the paddle //
+		if (player_input & INPUT_LEFT)
+		{
+			if ( (player.screen_location.x - PLAYER_SPEED) >= 0 )
+			{
+				player.screen_location.x -= PLAYER_SPEED;
+			}
+		}
+		if (player_input & INPUT_RIGHT)
+		{
+			if ( (player.screen_location.x + PLAYER_SPEED) <= WINDOW_WIDTH )
+			{
+				player.screen_location.x += PLAYER_SPEED;
+			}
+		}
+	}
+
+	// The blocks move before the ball, so it sees them where they're drawn //
+	state->mover_steps = StepMovers(&state->movers, state->ticks, state->blocks, &state->grid);
+
+	HandleBall(state);
+
+	// Now that the ball is done moving, act on everything it hit //
+	ApplyGameEvents(state);
+
+	if (state->result == RESULT_PLAYING)
+		UpdatePowerUps(state);
+
+	state->ticks++;
+}
+
+// FNV-1a, one value at a time //
+static Uint32 HashValue(Uint32 hash, int value)
+{
+	for (int i=0; i < 4; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xFF;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static Uint32 HashRect(Uint32 hash, const SDL_Rect& rect)
+{
+	hash = HashValue(hash, rect.x);
+	hash = HashValue(hash, rect.y);
+	hash = HashValue(hash, rect.w);
+	return HashValue(hash, rect.h);
+}
+
+// The level pointer is left out on purpose, it differs between machines //
+Uint32 HashGameState(const GameState* state)
+{
+	Uint32 hash = 2166136261u;
+
+	for (int i=0; i < state->num_players; i++)
+	{
+		hash = HashRect(hash, state->players[i].screen_location);
+		hash = HashValue(hash, state->scores[i]);
+	}
+
+	hash = HashRect(hash, state->ball.screen_location);
+	hash = HashValue(hash, state->ball.x_speed);
+	hash = HashValue(hash, state->ball.y_speed);
+
+	hash = HashValue(hash, state->last_hit);
+	hash = HashValue(hash, state->lives);
+	hash = HashValue(hash, state->level);
+	hash = HashValue(hash, state->num_blocks);
+	hash = HashValue(hash, state->result);
+	hash = HashValue(hash, state->ticks);
+
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		hash = HashValue(hash, state->blocks[i].num_hits);
+		hash = HashValue(hash, state->blocks[i].screen_location.x);
+		hash = HashValue(hash, state->blocks[i].screen_location.y);
+	}
+
+	const EntityStore& entities = state->entities;
+	for (int i=0; i < MAX_ENTITIES; i++)
+	{
+		if (!entities.alive[i])
+			continue;
+		hash = HashValue(hash, i);
+		hash = HashValue(hash, entities.generations[i]);
+		hash = HashValue(hash, entities.components[i]);
+		hash = HashRect(hash, entities.positions[i]);
+		hash = HashValue(hash, entities.powerup_types[i]);
+	}
+	hash = HashValue(hash, state->random_seed);
+
+	return hash;
+}
+
+void PushGameEvent(GameState* state, int type, int index)
+{
+	// Can't happen with MAX_GAME_EVENTS big enough for a tick //
+	if (state->num_events == MAX_GAME_EVENTS)
+		return;
+
+	GameEvent& event = state->events[state->num_events++];
+	event.type  = type;
+	event.index = index;
+}
+
+// Applying an event can push more, such as a destroyed block clearing the //
+// level. Those go on the end and are applied later in the same loop, so a //
+// level change always comes after everything else that happened.          //
+void ApplyGameEvents(GameState* state)
+{
+	for (int i=0; i < state->num_events; i++)
+	{
+		const GameEvent& event = state->events[i];
+
+		switch (event.type)
+		{
+			case EVENT_PADDLE_HIT:
+			{
+				state->last_hit = event.index;
+			} break;
+			case EVENT_BLOCK_HIT:
+			{
+				HandleBlockCollision(state, event.index);
+			} break;
+			case EVENT_BLOCK_DESTROYED:
+			{
+				state->num_blocks--;
+				if (state->last_hit >= 0)
+					state->scores[state->last_hit]++;
+
+				if (NextRandom(&state->random_seed) % POWERUP_CHANCE == 0)
+					SpawnPowerUp(state, state->blocks[event.index].screen_location);
+
+				// Check to see if it's time to change the level //
+				if (state->num_blocks == 0)
+					PushGameEvent(state, EVENT_LEVEL_CLEARED, state->level);
+			} break;
+			case EVENT_LEVEL_CLEARED:
+			{
+				ChangeLevel(state);
+			} break;
+			case EVENT_LIFE_LOST:
+			{
+				state->lives--;
+
+				ResetBall(state);
+
+				if (state->lives == 0)
+				{
+					state->result = RESULT_LOST;
+				}
+			} break;
+		}
+	}
+}
+
+// Check to see if the ball is going to hit one of the paddles //
+int CheckBallCollisions(GameState* state)
+{
+	// Temporary values to keep things tidy //
+	int ball_x      = state->ball.screen_location.x;
+	int ball_y      = state->ball.screen_location.y;
+	int ball_width  = state->ball.screen_location.w;
+	int ball_height = state->ball.screen_location.h;
+	int ball_speed  = state->ball.y_speed;
+
+	const CollisionMasks* masks = state->masks;
+
+	for (int i=0; i < state->num_players; i++)
+	{
+		int paddle_x      = state->players[i].screen_location.x;
+		int paddle_y      = state->players[i].screen_location.y;
+		int paddle_width  = state->players[i].screen_location.w;
+		int paddle_height = state->players[i].screen_location.h;
+
+		// Check to see if ball is in Y range of the player's paddle. //
+		// We check its speed to see if it's even moving towards the player's paddle. //
+		if ( (ball_speed > 0) && (ball_y + ball_height >= paddle_y) &&
+			 (ball_y + ball_height <= paddle_y + paddle_height) )        // side hit
+		{
+			// If ball is in the X range of the paddle and their pixels //
+			// overlap, this is the one. Rounded ends can miss.           //
+			if ( (ball_x <= paddle_x + paddle_width) && (ball_x + ball_width >= paddle_x) &&
+				 CheckMasksOverlap(masks->sprites[SPRITE_BALL], ball_x, ball_y,
+				                   masks->sprites[SPRITE_PADDLE], paddle_x, paddle_y, NULL) )
+			{
+				return i;
+			}
+		}
+	}
+
+	return -1;
+}
+
+// This function checks to see if the ball has hit one of the blocks. It also checks  //
+// what part of the ball hit the block so we can adjust the ball's speed acoordingly. //
+// Only pixels count: the ball's corners are empty, and so are any in the blocks.     //
+// The grid finds the blocks near the ball, wherever they've moved to.              //
+void CheckBlockCollisions(GameState* state)
+{
+	Ball& ball = state->ball;
+
+	int ball_x = ball.screen_location.x;
+	int ball_y = ball.screen_location.y;
+	int ball_center_x = ball_x + ball.screen_location.w/2;
+	int ball_center_y = ball_y + ball.screen_location.h/2;
+
+	const CollisionMasks* masks = state->masks;
+
+	bool top = false;
+	bool bottom = false;
+	bool left = false;
+	bool right = false;
+
+	// Find the blocks the ball's box could be touching. These include blocks //
+	// that only share an edge with it, which the masks then rule out. They   //
+	// come back in order, so the hits are too. //
+	int found[GRID_MAX_FOUND];
+	int num_found = QueryBlockGrid(&state->grid, ball.screen_location, found, GRID_MAX_FOUND);
+	state->collision_checks += num_found;
+
+	for (int f=0; f < num_found; f++)
+	{
+		int block = found[f];
+		int num_hits = state->blocks[block].num_hits;
+		if (num_hits == 0)
+			continue;
+
+		// Blocks look like the color of the hits they have left, red for one //
+		const CollisionMask& block_mask = masks->sprites[SPRITE_RED + (num_hits > 4 ? 4 : num_hits) - 1];
+		const SDL_Rect&      location   = state->blocks[block].screen_location;
+
+		SDL_Rect contact;
+		if ( !CheckMasksOverlap(masks->sprites[SPRITE_BALL], ball_x, ball_y,
+		                        block_mask, location.x, location.y, &contact) )
+			continue;
+
+		// A contact wider than it is tall is on the ball's top or bottom, //
+		// otherwise it's on a side. Which one is whichever the middle of  //
+		// the contact is closer to. //
+		int contact_x = contact.x + contact.w/2;
+		int contact_y = contact.y + contact.h/2;
+
+		if (contact.w >= contact.h)
+		{
+			if (contact_y < ball_center_y)
+				top = true;
+			else
+				bottom = true;
+		}
+		else
+		{
+			if (contact_x < ball_center_x)
+				left = true;
+			else
+				right = true;
+		}
+
+		// However much of the ball touches it, a block only takes one hit a tick //
+		PushGameEvent(state, EVENT_BLOCK_HIT, block);
+	}
+
+	if (top)
+	{
+		ball.y_speed = -ball.y_speed;
+		ball.screen_location.y += BALL_DIAMETER;
+	}
+	if (bottom)
+	{
+		ball.y_speed = -ball.y_speed;
+		ball.screen_location.y -= BALL_DIAMETER;
+	}
+	if (left)
+	{
+		ball.x_speed = -ball.x_speed;
+		ball.screen_location.x += BALL_DIAMETER;
+	}
+	if (right)
+	{
+		ball.x_speed = -ball.x_speed;
+		ball.screen_location.x -= BALL_DIAMETER;
+	}
+}
+
+// This function changes the block's hit count. We also need it to change   //
+// the color of the block and check to see if the hit count reached zero.   //
+// It's only called from ApplyGameEvents(), never while checking collisions. //
+void HandleBlockCollision(GameState* state, int index)
+{
+	Block& block = state->blocks[index];
+
+	if (block.num_hits == 0)
+		return;
+
+	block.num_hits--;
+
+	// If num_hits is 0, the block needs to be erased //
+	if (block.num_hits == 0)
+	{
+		RemoveGridBlock(&state->grid, index);
+		PushGameEvent(state, EVENT_BLOCK_DESTROYED, index);
+	}
+	// If the hit count hasn't reached zero, we need to change the block's color //
+	else
+	{
+		switch (block.num_hits)
+		{
+			case 1:
+			{
+				block.bitmap_location.x = RED_X;
+				block.bitmap_location.y = RED_Y;
+			} break;
+			case 2:
+			{
+				block.bitmap_location.x = YELLOW_X;
+				block.bitmap_location.y = YELLOW_Y;
+			} break;
+			case 3:
+			{
+				block.bitmap_location.x = GREEN_X;
+				block.bitmap_location.y = GREEN_Y;
+			} break;
+		}
+	}
+}
+
+// Check to see if a point is within a rectangle //
+bool CheckPointInRect(int x, int y, SDL_Rect rect)
+{
+	if ( (x >= rect.x) && (x <= rect.x + rect.w) &&
+		 (y >= rect.y) && (y <= rect.y + rect.h) )
+	{
+		return true;
+	}
+
+	return false;
+}
+
+// Put the ball back in the center of the screen, not moving //
+void ResetBall(GameState* state)
+{
+	state->ball.x_speed = 0;
+	state->ball.y_speed = 0;
+
+	state->ball.screen_location.x = WINDOW_WIDTH/2 - state->ball.screen_location.w/2;
+	state->ball.screen_location.y = WINDOW_HEIGHT/2 - state->ball.screen_location.h/2;
+}
+
+void ChangeLevel(GameState* state)
+{
+	// Check to see if the player has won //
+	if (state->level >= state->num_levels)
+	{
+		state->result = RESULT_WON;
+		return;
+	}
+
+	state->level++;
+
+	// Reset the ball //
+	ResetBall(state);
+
+	InitBlocks(state); // InitBlocks() will load the proper level
+}
+
+void HandleBall(GameState* state)
+{
+	// Start by moving the ball. If it got away there's nothing left for it to hit. //
+	if ( !MoveBall(state) )
+		return;
+
+	int hit = CheckBallCollisions(state);
+	if (hit >= 0)
+	{
+		Paddle& player = state->players[hit];
+		PushGameEvent(state, EVENT_PADDLE_HIT, hit);
+
+		// Get center location of paddle //
+	    int paddle_center = player.screen_location.x + player.screen_location.w / 2;
+		int ball_center = state->ball.screen_location.x + state->ball.screen_location.w / 2;
+
+		// Find the location on the paddle that the ball hit //
+		int paddle_location = ball_center - paddle_center;
+
+		// Increase X speed according to distance from center of paddle. //
+		// Use bit shifting, multiplication, and pre-compile division to avoid
+		// runtime division, which can be expensive on embedded systems.
+		state->ball.x_speed =
+			(paddle_location * ((1 << BALL_SPEED_MODIFIER_SHIFT) /
+				BALL_SPEED_MODIFIER)) >> BALL_SPEED_MODIFIER_SHIFT;
+		state->ball.y_speed = -state->ball.y_speed;
+	}
+
+	// Check for collisions with blocks //
+	CheckBlockCollisions(state);
+}
+
+bool MoveBall(GameState* state)
+{
+	Ball& ball = state->ball;
+
+	ball.screen_location.x += ball.x_speed;
+	ball.screen_location.y += ball.y_speed;
+
+	// If the ball is moving left, we see if it hits the wall. If does, //
+	// we change its direction. We do the same thing if it's moving right. //
+	if ( ( (ball.x_speed < 0) && (ball.screen_location.x <= 0)  ) ||
+		 ( (ball.x_speed > 0) &&
+		   (ball.screen_location.x + ball.screen_location.w >= WINDOW_WIDTH) ) )
+	{
+		ball.x_speed = -ball.x_speed;
+	}
+
+	// If the ball is moving up, we should check to see if it hits the 'roof' //
+	if ( (ball.y_speed < 0) && (ball.screen_location.y <= 0) )
+	{
+		ball.y_speed = -ball.y_speed;
+	}
+
+	// Check to see if ball has passed the player //
+	if ( ball.screen_location.y  >= WINDOW_HEIGHT )
+	{
+		PushGameEvent(state, EVENT_LIFE_LOST, 0);
+		return false;
+	}
+
+	return true;
+}
+
+bool IsBallAboveBlocks(const GameState* state)
+{
+	const Ball& ball = state->ball;
+
+	// Once it turns it's on the way down to the blocks //
+	if (state->result != RESULT_PLAYING || ball.y_speed >= 0)
+		return false;
+
+	// A falling power-up can still be caught or missed //
+	const EntityStore&   entities  = state->entities;
+	int                  catchable = COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_POWERUP);
+	const ComponentList* list      = GetSystemList(&entities, catchable);
+
+	for (int i=0; i < list->count; i++)
+	{
+		if ( HasComponents(&entities, list->entities[i], catchable) )
+			return false;
+	}
+
+	// Blocks that move can end up above the rows before them, so check them all //
+	bool any = false;
+	int  top = 0;
+	for (int i=0; i < NUM_ROWS * NUM_COLS; i++)
+	{
+		const Block& block = state->blocks[i];
+		if ( block.num_hits > 0 && (!any || block.screen_location.y < top) )
+		{
+			top = block.screen_location.y;
+			any = true;
+		}
+	}
+
+	return any && ball.screen_location.y + ball.screen_location.h <= top;
+}
+
+void SpawnPowerUp(GameState* state, const SDL_Rect& where)
+{
+	EntityStore& entities = state->entities;
+
+	// If there are too many falling already, this one just doesn't drop //
+	EntityHandle powerup = CreateEntity(&entities);
+	if (powerup == NULL_ENTITY)
+		return;
+
+	AddComponent(&entities, powerup, COMPONENT_POSITION);
+	AddComponent(&entities, powerup, COMPONENT_VELOCITY);
+	AddComponent(&entities, powerup, COMPONENT_POWERUP);
+
+	int slot = EntitySlot(powerup);
+
+	// It falls out of the middle of the block //
+	entities.positions[slot].x   = where.x + where.w/2 - POWERUP_SIZE/2;
+	entities.positions[slot].y   = where.y + where.h/2 - POWERUP_SIZE/2;
+	entities.positions[slot].w   = POWERUP_SIZE;
+	entities.positions[slot].h   = POWERUP_SIZE;
+	entities.x_speeds[slot]      = 0;
+	entities.y_speeds[slot]      = POWERUP_SPEED;
+	entities.powerup_types[slot] = NextRandom(&state->random_seed) % NUM_POWERUP_TYPES;
+}
+
+// Checks if two rectangles overlap //
+static bool CheckRectsOverlap(const SDL_Rect& a, const SDL_Rect& b)
+{
+	return (a.x < b.x + b.w) && (b.x < a.x + a.w) &&
+	       (a.y < b.y + b.h) && (b.y < a.y + a.h);
+}
+
+void UpdatePowerUps(GameState* state)
+{
+	EntityStore& entities = state->entities;
+
+	// Move everything that moves //
+	int moving = COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_VELOCITY);
+	const ComponentList* list = GetSystemList(&entities, moving);
+
+	for (int i=0; i < list->count; i++)
+	{
+		int slot = list->entities[i];
+		if ( !HasComponents(&entities, slot, moving) )
+			continue;
+
+		entities.positions[slot].x += entities.x_speeds[slot];
+		entities.positions[slot].y += entities.y_speeds[slot];
+	}
+
+	// Catch power-ups that touch a paddle, and lose the ones that fall off the screen. //
+	// Going backwards, since destroying one moves the end of the list into its place. //
+	int catchable = COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_POWERUP);
+	list = GetSystemList(&entities, catchable);
+
+	for (int i = list->count - 1; i >= 0; i--)
+	{
+		int slot = list->entities[i];
+		if ( !HasComponents(&entities, slot, catchable) )
+			continue;
+
+		EntityHandle powerup = GetEntityHandle(&entities, slot);
+
+		if (entities.positions[slot].y >= WINDOW_HEIGHT)
+		{
+			DestroyEntity(&entities, powerup);
+			continue;
+		}
+
+		for (int p=0; p < state->num_players; p++)
+		{
+			if ( !CheckRectsOverlap(entities.positions[slot], state->players[p].screen_location) )
+				continue;
+
+			switch (entities.powerup_types[slot])
+			{
+				case POWERUP_EXTRA_LIFE:
+				{
+					state->lives++;
+				} break;
+				case POWERUP_BONUS:
+				{
+					state->scores[p] += POWERUP_BONUS_POINTS;
+				} break;
+			}
+
+			DestroyEntity(&entities, powerup);
+			break;
+		}
+	}
+}
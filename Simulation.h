@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Simulation.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Rect
+#include "Defines.h" // Our defines header
+#include "Enums.h"   // Our enums header
+#include "Entities.h" // For EntityStore
+#include "Collision.h" // For CollisionMasks
+#include "BlockGrid.h" // For BlockGrid
+#include "Movers.h"    // For MoverScript and MoverSchedule
+
+// The block just stores it's location and the amount of times it can be hit (health) //
+struct Block
+{
+	SDL_Rect screen_location;  // location on screen
+	SDL_Rect bitmap_location;  // location of image in bitmap
+
+	int num_hits;   // health
+};
+
+// The paddle only moves horizontally so there's no need for a y_speed variable //
+struct Paddle
+{
+	SDL_Rect screen_location;  // location on screen
+	SDL_Rect bitmap_location;  // location of image in bitmap
+
+	int x_speed;
+};
+
+// The ball moves in any direction so we need to have two speed variables //
+struct Ball
+{
+	SDL_Rect screen_location;  // location on screen
+	SDL_Rect bitmap_location;  // location of image in bitmap
+
+	int x_speed;
+	int y_speed;
+};
+
+// The block layout of a single level, one hit count per cell (0 = no block), //
+// and the script that moves them                                             //
+struct LevelLayout
+{
+	int hits[NUM_ROWS * NUM_COLS];
+
+	MoverScript moves[MAX_LEVEL_MOVES];
+	int         num_moves;
+};
+
+// Something that happened during a tick. Collisions only record what they //
+// found; StepSimulation() applies the whole batch after the ball has moved, //
+// so nothing changes the blocks while they're still being checked.         //
+struct GameEvent
+{
+	int type;    // GameEventType
+	int index;   // what it happened to, see GameEventType
+};
+
+// Everything the game logic needs to advance one tick. It holds no pointers   //
+// into itself, so a plain copy is a complete snapshot of the game in progress. //
+struct GameState
+{
+	Paddle players[MAX_PLAYERS]; // The players' paddles
+	int    num_players;          // 2 in versus mode
+	int    last_hit;             // Player whose paddle last hit the ball, -1 before anyone has
+	int    scores[MAX_PLAYERS];  // Blocks broken by each player
+	Ball   ball;                 // The game ball
+	int    lives;                // Player's lives
+	int    level;                // Current level (starts at 1)
+	int    num_blocks;           // Number of blocks left in the level
+	Block  blocks[MAX_BLOCKS];   // The blocks we're breaking
+	BlockGrid     grid;          // Where they are, for finding the ones near the ball
+	MoverSchedule movers;        // The ones the level's script moves
+	EntityStore entities;        // Falling power-ups
+	Uint32 random_seed;          // For power-up drops, part of the state so replays match
+	int    result;               // GameResult, set when the game is over
+	int    ticks;                // Number of ticks simulated so far
+	GameEvent events[MAX_GAME_EVENTS]; // What happened in the last tick, for effects and stats
+	int       num_events;
+	int       collision_checks;  // Blocks the ball was tested against in the last tick
+	int       mover_steps;       // Blocks the level's script moved in the last tick
+
+	const LevelLayout* levels;   // Level layouts to play through (not owned)
+	int                num_levels;
+	const CollisionMasks* masks; // The sprites' shapes, for pixel-accurate collisions (not owned)
+};
+
+// Reads a level in the "Data/levelN.txt" format, and its script if it has //
+// one. Returns false on failure.                                          //
+bool LoadLevelFile(const char* file_name, LevelLayout* layout);
+
+// Sets up a new game for one or two players starting at the first of the given levels //
+void InitGameState(GameState* state, const LevelLayout* levels, int num_levels, int num_players);
+void InitBlocks(GameState* state);
+
+// Advances the game by one tick. Each player's InputFlags are shifted //
+// INPUT_PLAYER_SHIFT bits further along than the previous player's.   //
+void StepSimulation(GameState* state, int input);
+
+// Hashes everything that affects how the game plays out, for spotting desyncs //
+Uint32 HashGameState(const GameState* state);
+
+// Adds an event to this tick's batch, and applies the batch in order //
+void PushGameEvent(GameState* state, int type, int index);
+void ApplyGameEvents(GameState* state);
+
+// Returns which player's paddle the ball overlaps, or -1 //
+int  CheckBallCollisions(GameState* state);
+void CheckBlockCollisions(GameState* state);
+void HandleBlockCollision(GameState* state, int index);
+bool CheckPointInRect(int x, int y, SDL_Rect rect);
+void HandleBall(GameState* state);
+// Returns false if the ball got past the paddles //
+bool MoveBall(GameState* state);
+void ResetBall(GameState* state);
+void ChangeLevel(GameState* state);
+
+// Returns true while the ball is moving up, wholly above every block left, //
+// and no power-up is falling. Nothing can happen until it turns around.    //
+bool IsBallAboveBlocks(const GameState* state);
+
+// Drops a power-up from a destroyed block, and moves and catches the ones falling //
+void SpawnPowerUp(GameState* state, const SDL_Rect& where);
+void UpdatePowerUps(GameState* state);
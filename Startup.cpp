@@ -0,0 +1,132 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Startup.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include "Startup.h"
+#include "Timing.h"   // For GetMicroseconds()
+#include "Atomic.h"   // For AtomicAdd()
+
+void StartTimeline(StartupTimeline* timeline)
+{
+	memset(timeline, 0, sizeof(StartupTimeline));
+	timeline->origin = GetMicroseconds();
+}
+
+static Uint32 GetTimelineTime(const StartupTimeline* timeline)
+{
+	return (Uint32)(GetMicroseconds() - timeline->origin);
+}
+
+int BeginStartupStage(StartupTimeline* timeline, const char* name, const char* thread)
+{
+	int stage = AtomicAdd(&timeline->num_stages, 1) - 1;
+	if (stage >= MAX_STARTUP_STAGES)
+		return -1;
+
+	timeline->stages[stage].name   = name;
+	timeline->stages[stage].thread = thread;
+	timeline->stages[stage].start  = GetTimelineTime(timeline);
+	timeline->stages[stage].end    = timeline->stages[stage].start;
+	return stage;
+}
+
+void EndStartupStage(StartupTimeline* timeline, int stage)
+{
+	if (stage >= 0)
+		timeline->stages[stage].end = GetTimelineTime(timeline);
+}
+
+void MarkFirstFrame(StartupTimeline* timeline)
+{
+	if (timeline->first_frame == 0)
+		timeline->first_frame = GetTimelineTime(timeline);
+}
+
+static int RunStartupJob(void* data)
+{
+	StartupJob* job = (StartupJob*)data;
+
+	int stage = BeginStartupStage(job->timeline, job->name, job->on_thread ? job->name : "main");
+	job->result = job->function(job->data);
+	EndStartupStage(job->timeline, stage);
+
+	return job->result;
+}
+
+void StartStartupJob(StartupJob* job, StartupTimeline* timeline, const char* name,
+                     int (*function)(void* data), void* data, bool parallel)
+{
+	job->timeline = timeline;
+	job->name     = name;
+	job->function = function;
+	job->data     = data;
+	job->thread   = NULL;
+	job->result   = 0;
+
+	job->on_thread = parallel;
+	if (parallel)
+		job->thread = SDL_CreateThread(RunStartupJob, job);
+
+	if (!job->thread)
+	{
+		job->on_thread = false;
+		RunStartupJob(job);
+	}
+}
+
+int FinishStartupJob(StartupJob* job)
+{
+	if (job->thread)
+		SDL_WaitThread(job->thread, NULL);
+	job->thread = NULL;
+
+	return job->result;
+}
+
+void PrintStartupTimeline(const StartupTimeline* timeline)
+{
+	int num_stages = timeline->num_stages < MAX_STARTUP_STAGES ? timeline->num_stages : MAX_STARTUP_STAGES;
+	if (num_stages == 0)
+		return;
+
+	// Stages from other threads can be added out of order //
+	int order[MAX_STARTUP_STAGES];
+	for (int i=0; i < num_stages; i++)
+	{
+		int j = i;
+		for (; j > 0 && timeline->stages[order[j - 1]].start > timeline->stages[i].start; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	Uint32 total = timeline->first_frame;
+	for (int i=0; i < num_stages; i++)
+	{
+		if (timeline->stages[i].end > total)
+			total = timeline->stages[i].end;
+	}
+	if (total == 0)
+		total = 1;
+
+	printf("startup:  %-12s %-8s %8s %8s\n", "stage", "thread", "start ms", "took ms");
+	for (int i=0; i < num_stages; i++)
+	{
+		const StartupStage& stage = timeline->stages[order[i]];
+
+		char bar[TIMELINE_BAR_WIDTH + 1];
+		int  from = (int)((Uint64)stage.start * TIMELINE_BAR_WIDTH / total);
+		int  to   = (int)((Uint64)stage.end * TIMELINE_BAR_WIDTH / total);
+		for (int c=0; c < TIMELINE_BAR_WIDTH; c++)
+			bar[c] = (c >= from && (c < to || c == from)) ? '#' : '.';
+		bar[TIMELINE_BAR_WIDTH] = '\0';
+
+		printf("startup:  %-12s %-8s %8.1f %8.1f %s\n", stage.name, stage.thread,
+		       stage.start / 1000.0, (stage.end - stage.start) / 1000.0, bar);
+	}
+
+	if (timeline->first_frame)
+		printf("startup:  first frame after %.1f ms\n", timeline->first_frame / 1000.0);
+}
@@ -0,0 +1,61 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Startup.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For Uint64 and SDL_Thread
+#include "Defines.h" // Our defines header
+
+// One step of starting up, in microseconds since the timeline started //
+struct StartupStage
+{
+	const char* name;
+	const char* thread;   // what ran it
+	Uint32      start;
+	Uint32      end;
+};
+
+// What starting the game took, stage by stage, up to the first frame shown. //
+// Stages can be added from any thread.                                     //
+struct StartupTimeline
+{
+	Uint64       origin;
+	StartupStage stages[MAX_STARTUP_STAGES];
+	volatile int num_stages;
+	Uint32       first_frame;   // 0 until a frame has been shown
+};
+
+// Something loaded while the rest of startup carries on //
+struct StartupJob
+{
+	StartupTimeline* timeline;
+	const char*      name;
+	int            (*function)(void* data);
+	void*            data;
+	SDL_Thread*      thread;
+	bool             on_thread;   // set before the thread starts, for naming its stage
+	int              result;
+};
+
+// Forgets any stages and starts the clock //
+void   StartTimeline(StartupTimeline* timeline);
+
+// A stage starts when it's begun and ends when it's ended, given what the //
+// begin returned. Stages past MAX_STARTUP_STAGES aren't kept.            //
+int    BeginStartupStage(StartupTimeline* timeline, const char* name, const char* thread);
+void   EndStartupStage(StartupTimeline* timeline, int stage);
+
+// Notes the first frame shown. Later ones are ignored. //
+void   MarkFirstFrame(StartupTimeline* timeline);
+
+// Runs function(data) as a stage of the timeline, on a thread of its own if //
+// parallel is true and one can be made, otherwise before returning. Finish  //
+// waits for it and returns what it returned.                                //
+void   StartStartupJob(StartupJob* job, StartupTimeline* timeline, const char* name,
+                       int (*function)(void* data), void* data, bool parallel);
+int    FinishStartupJob(StartupJob* job);
+
+// Prints the stages in the order they started, with a bar for each showing //
+// when it ran, and the time to the first frame //
+void   PrintStartupTimeline(const StartupTimeline* timeline);
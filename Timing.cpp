@@ -0,0 +1,32 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Timing.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "Timing.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+Uint64 GetMicroseconds()
+{
+#ifdef _WIN32
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+
+	return (Uint64)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+	       (Uint64)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (Uint64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
@@ -0,0 +1,11 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Timing.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For Uint64
+
+// SDL_GetTicks() only counts milliseconds, which is too coarse for timing //
+// the parts of a frame. This returns microseconds from an arbitrary start. //
+Uint64 GetMicroseconds();
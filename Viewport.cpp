@@ -0,0 +1,158 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Project: Block Breaker (Breakout)
+// File:    Viewport.cpp
+//////////////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "Viewport.h"
+
+void SetViewport(Viewport* viewport, int width, int height)
+{
+	viewport->width  = width;
+	viewport->height = height;
+
+	// Scale by whichever side runs out of room first //
+	if (width * WINDOW_HEIGHT <= height * WINDOW_WIDTH)
+	{
+		viewport->scale_num = width;
+		viewport->scale_den = WINDOW_WIDTH;
+	}
+	else
+	{
+		viewport->scale_num = height;
+		viewport->scale_den = WINDOW_HEIGHT;
+	}
+
+	viewport->offset_x = (width  - WINDOW_WIDTH  * viewport->scale_num / viewport->scale_den) / 2;
+	viewport->offset_y = (height - WINDOW_HEIGHT * viewport->scale_num / viewport->scale_den) / 2;
+}
+
+SDL_Rect ScaleRect(const Viewport* viewport, const SDL_Rect& rect)
+{
+	SDL_Rect scaled;
+	scaled.x = (Sint16)ScaleX(viewport, rect.x);
+	scaled.y = (Sint16)ScaleY(viewport, rect.y);
+	scaled.w = (Uint16)ScaleSize(viewport, rect.w);
+	scaled.h = (Uint16)ScaleSize(viewport, rect.h);
+	return scaled;
+}
+
+SDL_Rect GetSpriteLocation(int sprite)
+{
+	SDL_Rect location = { 0, 0, BLOCK_WIDTH, BLOCK_HEIGHT };
+
+	switch (sprite)
+	{
+	case SPRITE_PADDLE:
+		location.x = PADDLE_BITMAP_X;  location.y = PADDLE_BITMAP_Y;
+		location.w = PADDLE_WIDTH;     location.h = PADDLE_HEIGHT;
+		break;
+	case SPRITE_BALL:
+		location.x = BALL_BITMAP_X;    location.y = BALL_BITMAP_Y;
+		location.w = BALL_DIAMETER;    location.h = BALL_DIAMETER;
+		break;
+	case SPRITE_RED:     location.x = RED_X;     location.y = RED_Y;     break;
+	case SPRITE_YELLOW:  location.x = YELLOW_X;  location.y = YELLOW_Y;  break;
+	case SPRITE_GREEN:   location.x = GREEN_X;   location.y = GREEN_Y;   break;
+	case SPRITE_BLUE:    location.x = BLUE_X;    location.y = BLUE_Y;    break;
+	}
+
+	return location;
+}
+
+// Cuts a sprite out of the bitmap at a new size, taking the nearest pixel. //
+// Nearest keeps the transparent color exact, where blending would smear it. //
+static SDL_Surface* ScaleSprite(SDL_Surface* bitmap, const SDL_Rect& source, int width, int height,
+                                SDL_PixelFormat* target)
+{
+	SDL_PixelFormat* format = bitmap->format;
+
+	if (width < 1)
+		width = 1;
+	if (height < 1)
+		height = 1;
+
+	SDL_Surface* scaled = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, format->BitsPerPixel,
+	                                           format->Rmask, format->Gmask, format->Bmask, format->Amask);
+	if (!scaled)
+		return NULL;
+
+	if (format->palette)
+		SDL_SetColors(scaled, format->palette->colors, 0, format->palette->ncolors);
+
+	SDL_LockSurface(bitmap);
+	SDL_LockSurface(scaled);
+
+	int bytes_per_pixel = format->BytesPerPixel;
+
+	for (int y=0; y < height; y++)
+	{
+		const Uint8* source_row = (const Uint8*)bitmap->pixels +
+		                          (source.y + y * source.h / height) * bitmap->pitch;
+		Uint8* row = (Uint8*)scaled->pixels + y * scaled->pitch;
+
+		for (int x=0; x < width; x++)
+		{
+			memcpy(row + x * bytes_per_pixel,
+			       source_row + (source.x + x * source.w / width) * bytes_per_pixel, bytes_per_pixel);
+		}
+	}
+
+	SDL_UnlockSurface(scaled);
+	SDL_UnlockSurface(bitmap);
+
+	if (bitmap->flags & SDL_SRCCOLORKEY)
+		SDL_SetColorKey(scaled, SDL_SRCCOLORKEY, format->colorkey);
+
+	// Convert to the format we draw in now, so blits don't have to every frame. //
+	// An 8-bit format gets each color's nearest match in its palette.          //
+	SDL_Surface* converted = SDL_ConvertSurface(scaled, target, SDL_SWSURFACE);
+	SDL_FreeSurface(scaled);
+
+	// No SDL_RLEACCEL: SDL would free the raw pixels the render threads read //
+	// after the first serial blit, and decoding them again costs every frame. //
+	return converted;
+}
+
+bool BuildSpriteCache(SpriteCache* cache, SDL_Surface* bitmap, const Viewport* viewport,
+                      SDL_PixelFormat* target)
+{
+	FreeSpriteCache(cache);
+
+	bool built = true;
+
+	for (int i=0; i < NUM_SPRITES; i++)
+	{
+		cache->source[i]  = GetSpriteLocation(i);
+		cache->sprites[i] = ScaleSprite(bitmap, cache->source[i],
+		                                ScaleSize(viewport, cache->source[i].w),
+		                                ScaleSize(viewport, cache->source[i].h), target);
+		if (!cache->sprites[i])
+			built = false;
+	}
+
+	return built;
+}
+
+void FreeSpriteCache(SpriteCache* cache)
+{
+	for (int i=0; i < NUM_SPRITES; i++)
+	{
+		if (cache->sprites[i])
+			SDL_FreeSurface(cache->sprites[i]);
+		cache->sprites[i] = NULL;
+	}
+}
+
+SDL_Surface* GetSprite(const SpriteCache* cache, const SDL_Rect& bitmap_location)
+{
+	for (int i=0; i < NUM_SPRITES; i++)
+	{
+		const SDL_Rect& source = cache->source[i];
+		if ( source.x == bitmap_location.x && source.y == bitmap_location.y &&
+			 source.w == bitmap_location.w && source.h == bitmap_location.h )
+			return cache->sprites[i];
+	}
+
+	return NULL;
+}
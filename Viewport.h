@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////////////////////
+// Viewport.h
+//////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SDL/SDL.h" // For SDL_Surface and SDL_Rect
+#include "Defines.h" // Our defines header
+#include "Enums.h"   // For Sprite
+
+// Maps the game's WINDOW_WIDTH x WINDOW_HEIGHT coordinates onto a window of //
+// any size. The game is scaled by scale_num / scale_den, the same both ways, //
+// and centered, leaving black bars on the sides that don't fit exactly.      //
+struct Viewport
+{
+	int width;      // size of the window
+	int height;
+	int scale_num;
+	int scale_den;
+	int offset_x;   // where the game's top left corner goes
+	int offset_y;
+};
+
+void SetViewport(Viewport* viewport, int width, int height);
+
+// Converts from game coordinates to the window. Sizes are rounded, positions //
+// aren't, so things the same size in the game stay the same size on screen.  //
+inline int ScaleSize(const Viewport* viewport, int size)
+{
+	return (size * viewport->scale_num + viewport->scale_den / 2) / viewport->scale_den;
+}
+
+inline int ScaleX(const Viewport* viewport, int x)
+{
+	return viewport->offset_x + x * viewport->scale_num / viewport->scale_den;
+}
+
+inline int ScaleY(const Viewport* viewport, int y)
+{
+	return viewport->offset_y + y * viewport->scale_num / viewport->scale_den;
+}
+
+SDL_Rect ScaleRect(const Viewport* viewport, const SDL_Rect& rect);
+
+// Where a Sprite is in our bitmap //
+SDL_Rect GetSpriteLocation(int sprite);
+
+// Every sprite cut out of our bitmap and scaled to the viewport, in the   //
+// format frames are drawn in, so drawing one is a plain copy with no     //
+// scaling.                                                               //
+struct SpriteCache
+{
+	SDL_Rect     source[NUM_SPRITES];   // where each sprite is in the bitmap
+	SDL_Surface* sprites[NUM_SPRITES];
+};
+
+// Scales the sprites and converts them to target. Call again whenever the //
+// viewport or the format changes. //
+bool BuildSpriteCache(SpriteCache* cache, SDL_Surface* bitmap, const Viewport* viewport,
+                      SDL_PixelFormat* target);
+void FreeSpriteCache(SpriteCache* cache);
+
+// Returns the scaled sprite cut from the given part of the bitmap, or NULL //
+SDL_Surface* GetSprite(const SpriteCache* cache, const SDL_Rect& bitmap_location);